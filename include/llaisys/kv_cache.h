@@ -0,0 +1,67 @@
+#ifndef LLAISYS_KV_CACHE_H
+#define LLAISYS_KV_CACHE_H
+
+#include "tensor.h"
+
+// Paged KV cache: every layer's K and V live in pools of `num_blocks` blocks of
+// `block_size` tokens ([num_blocks, block_size, nkvh, dh] tensors) shared by all
+// sequences. A sequence only holds the blocks its tokens occupy, so memory is
+// spent on generated tokens rather than reserved up to maxseq per session.
+// Block sizes that are multiples of 64 keep the CPU prefill tiles whole.
+//
+// `dtype` is that of k, v and q; `kv_dtype` is either the same or, on CPU,
+// LLAISYS_DTYPE_I8 / LLAISYS_DTYPE_F8 (E4M3) to store K/V as codes with one
+// scale per token and head, dequantized on the fly by attention.
+__C {
+    typedef struct LlaisysKVCache *llaisysKVCache_t;
+
+    __export llaisysKVCache_t llaisysKVCacheCreate(llaisysDataType_t dtype, llaisysDataType_t kv_dtype,
+                                                   size_t nlayer, size_t nkvh, size_t dh,
+                                                   size_t block_size, size_t num_blocks,
+                                                   llaisysDeviceType_t device, int device_id);
+    __export void llaisysKVCacheDestroy(llaisysKVCache_t cache);
+
+    __export size_t llaisysKVCacheBlockSize(llaisysKVCache_t cache);
+    __export size_t llaisysKVCacheNumFreeBlocks(llaisysKVCache_t cache);
+    // The layer's K/V pool tensors; destroy the returned handles with tensorDestroy.
+    __export llaisysTensor_t llaisysKVCacheKeys(llaisysKVCache_t cache, size_t layer);
+    __export llaisysTensor_t llaisysKVCacheValues(llaisysKVCache_t cache, size_t layer);
+
+    __export int64_t llaisysKVCacheAddSequence(llaisysKVCache_t cache);
+    // A sequence keeping its first `sink` tokens and a sliding window of recent ones (multiples of the
+    // block size) for unbounded generation in constant memory. Keys are stored after RoPE with base
+    // `theta` and re-based as older tokens are evicted; rotate new tokens at the position Extend returns.
+    __export int64_t llaisysKVCacheAddStreamingSequence(llaisysKVCache_t cache, size_t sink, size_t window,
+                                                        float theta);
+    // Prefix cache: a radix tree over token ids of full blocks computed by earlier sequences. Starts a
+    // sequence on the longest cached prefix of token_ids (always leaving the last token) and sets
+    // *cached to its length; prefill only token_ids[*cached:]. When the pool runs short, Extend evicts
+    // least recently used prefixes no sequence is using.
+    __export int64_t llaisysKVCacheAddSequenceWithPrefix(llaisysKVCache_t cache, const int64_t *token_ids,
+                                                         size_t ntoken, size_t *cached);
+    // Publishes the full blocks holding the sequence's first `ntoken` tokens, once all layers are stored.
+    __export void llaisysKVCacheCommitPrefix(llaisysKVCache_t cache, int64_t seq, const int64_t *token_ids,
+                                             size_t ntoken);
+    // Blocks held by the prefix cache.
+    __export size_t llaisysKVCachePrefixBlocks(llaisysKVCache_t cache);
+    __export void llaisysKVCacheRemoveSequence(llaisysKVCache_t cache, int64_t seq);
+    __export size_t llaisysKVCacheLength(llaisysKVCache_t cache, int64_t seq);
+    // Tokens a streaming sequence has evicted so far.
+    __export size_t llaisysKVCacheEvicted(llaisysKVCache_t cache, int64_t seq);
+    // The sequence's block table as an I32 tensor; destroy the handle with tensorDestroy.
+    __export llaisysTensor_t llaisysKVCacheBlockTable(llaisysKVCache_t cache, int64_t seq);
+    // Grows the sequence by `ntoken` positions and returns the first new one. A streaming sequence
+    // first evicts old window tokens to make room.
+    __export size_t llaisysKVCacheExtend(llaisysKVCache_t cache, int64_t seq, size_t ntoken);
+    // Rolls a sequence back to its first `length` tokens, releasing the blocks past them (tokens a
+    // streaming sequence evicted stay dropped).
+    __export void llaisysKVCacheTruncate(llaisysKVCache_t cache, int64_t seq, size_t length);
+    // Writes k, v [n, nkvh, dh] at positions [pos, pos + n) of `layer`.
+    __export void llaisysKVCacheStore(llaisysKVCache_t cache, int64_t seq, size_t layer, size_t pos,
+                                      llaisysTensor_t k, llaisysTensor_t v);
+    // Causal attention of q [seqlen, nh, dh] over all of the sequence's tokens in `layer`.
+    __export void llaisysKVCacheAttention(llaisysKVCache_t cache, int64_t seq, size_t layer,
+                                          llaisysTensor_t attn_val, llaisysTensor_t q, float scale);
+}
+
+#endif // LLAISYS_KV_CACHE_H
@@ -1,6 +1,8 @@
 #ifndef LLAISYS_MODELS_QWEN2_H
 #define LLAISYS_MODELS_QWEN2_H
 
+#include "../ops.h"
+#include "../runtime.h"
 #include "../tensor.h"
 
 __C {
@@ -29,14 +31,102 @@ __C {
         llaisysTensor_t *mlp_down_w;
     };
 
+    // How the projections and the LM head are stored once the weights are prepared (CPU only for
+    // INT8 and Q4); the embedding and norm weights keep meta->dtype.
+    typedef enum {
+        LLAISYS_QWEN2_WEIGHTS_DENSE = 0, // meta->dtype, repacked for the GEMM kernels
+        LLAISYS_QWEN2_WEIGHTS_INT8 = 1,  // llaisysLinearQuantizeInt8
+        LLAISYS_QWEN2_WEIGHTS_Q4 = 2,    // llaisysLinearQuantizeQ4 with q4_group_size and q4_mode
+    } llaisysQwen2WeightFormat_t;
+
+    struct LlaisysQwen2Options {
+        llaisysQwen2WeightFormat_t weight_format;
+        size_t q4_group_size; // divides hs, nh * dh and di
+        llaisysQ4Mode_t q4_mode;
+        llaisysPrecision_t precision; // the model's forwards run under it
+        llaisysDataType_t kv_dtype;   // K/V stored in meta->dtype, or quantized to LLAISYS_DTYPE_I8/F8 (CPU only)
+        // window > 0: every sequence streams, keeping its first `sink` tokens and a sliding window of the
+        // last `window` or fewer, so it is not bounded by maxseq (both multiples of 16, sink + window <
+        // maxseq, unquantized K/V). Streamed sequences do not share the prefix cache.
+        size_t sink, window;
+    };
+
     struct LlaisysQwen2Model;
 
     __export struct LlaisysQwen2Model *llaisysQwen2ModelCreate(const LlaisysQwen2Meta *meta, llaisysDeviceType_t device, int *device_ids, int ndevice);
 
     __export void llaisysQwen2ModelDestroy(struct LlaisysQwen2Model * model);
 
+    // Weight tensors allocated by the model, in meta->dtype, to be filled with tensorLoad before the
+    // first infer. That call fuses and repacks them once and releases these tensors.
     __export struct LlaisysQwen2Weights *llaisysQwen2ModelWeights(struct LlaisysQwen2Model * model);
 
+    // Load-time options, before the first infer/step prepares the weights. The default is
+    // {LLAISYS_QWEN2_WEIGHTS_DENSE, 128, LLAISYS_Q4_SYMMETRIC, LLAISYS_PRECISION_F32, meta->dtype, 0, 0}.
+    __export void llaisysQwen2ModelSetOptions(struct LlaisysQwen2Model * model,
+                                              const struct LlaisysQwen2Options *options);
+
+    // Greedy next token after token_ids[0, ntoken), the whole sequence so far. Only the tokens
+    // extending the previous call's sequence are run; a sequence that diverges from it is rolled
+    // back to the common part, or starts over on the longest prefix still in the model's prefix cache.
+    // A streamed session takes sequences of any length and starts over whenever they diverge.
     __export int64_t llaisysQwen2ModelInfer(struct LlaisysQwen2Model * model, int64_t * token_ids, size_t ntoken);
+
+    // How llaisysQwen2ModelInfer picks tokens from now on: sampled from softmax(logits / temperature)
+    // over the top_k most likely (0: all) cut to top_p of their mass, from a generator seeded with
+    // `seed`. top_k == 1 or temperature <= 0 is greedy, the default.
+    __export void llaisysQwen2ModelSetSampling(struct LlaisysQwen2Model * model, size_t top_k, float top_p,
+                                               float temperature, uint64_t seed);
+
+    // Continuous batching: enqueued requests are admitted and retired at token granularity, and each
+    // step runs one forward over all running ones (their decode tokens stacked into one activation).
+    struct LlaisysQwen2BatchStats {
+        size_t steps;
+        size_t prefill_tokens;   // prompt tokens run, i.e. not found in the prefix cache
+        size_t generated_tokens;
+        double seconds;          // spent in llaisysQwen2ModelStep
+        double tokens_per_second; // generated_tokens / seconds
+    };
+
+    // A request generating up to max_new_tokens (> 0, capped at maxseq - ntoken unless streaming) greedy
+    // tokens after token_ids[0, ntoken); it reserves the KV cache for all of them, or for the sink and
+    // window of a streamed sequence. Returns its id.
+    __export int64_t llaisysQwen2ModelEnqueue(struct LlaisysQwen2Model * model, const int64_t *token_ids,
+                                              size_t ntoken, size_t max_new_tokens);
+
+    // One batched forward step. Returns the number of requests not finished yet. Fails if nothing is
+    // running and the next request still does not fit in the KV cache.
+    __export size_t llaisysQwen2ModelStep(struct LlaisysQwen2Model * model);
+
+    // Copies up to `capacity` of the tokens generated so far for `request` into token_ids and returns
+    // how many there are; *done is set to 1 once it has finished (end token or max_new_tokens). A
+    // finished request is forgotten once all its tokens have been copied.
+    __export size_t llaisysQwen2ModelPoll(struct LlaisysQwen2Model * model, int64_t request, int64_t *token_ids,
+                                          size_t capacity, uint8_t *done);
+
+    __export void llaisysQwen2ModelBatchStats(struct LlaisysQwen2Model * model, struct LlaisysQwen2BatchStats *stats);
+
+    // Speculative decoding: each target forward verifies up to num_speculative proposed tokens at
+    // once and keeps the longest prefix greedy decoding agrees with, plus the target's own next token.
+    struct LlaisysQwen2SpecStats {
+        size_t steps;             // target forwards, the prompt's included
+        size_t proposed;
+        size_t accepted;
+        size_t generated;
+        double seconds;
+        double acceptance_rate;   // accepted / proposed
+        double tokens_per_step;   // generated / steps: the speedup over plain decoding in forwards
+    };
+
+    // Greedy generation of up to max_new_tokens (0: up to maxseq - ntoken, or maxseq when streaming)
+    // after token_ids[0, ntoken) into out_tokens, with the same output as repeated
+    // llaisysQwen2ModelInfer calls, which it continues the session of. Proposals come from draft_model
+    // (same vocabulary, smaller and faster) or, if it is NULL, from n-gram lookup in the sequence so
+    // far. Returns the number of tokens generated; stats may be NULL.
+    __export size_t llaisysQwen2ModelGenerateSpeculative(struct LlaisysQwen2Model * model, const int64_t *token_ids,
+                                                         size_t ntoken, size_t max_new_tokens,
+                                                         struct LlaisysQwen2Model *draft_model,
+                                                         size_t num_speculative, int64_t *out_tokens,
+                                                         struct LlaisysQwen2SpecStats *stats);
 }
 #endif // LLAISYS_MODELS_QWEN2_H
@@ -3,15 +3,78 @@
 
 #include "tensor.h"
 
+// Activations fused into the output of llaisysLinearFused
+typedef enum {
+    LLAISYS_ACTIVATION_NONE = 0,
+    LLAISYS_ACTIVATION_RELU = 1,
+    LLAISYS_ACTIVATION_SILU = 2,
+    LLAISYS_ACTIVATION_GELU = 3,   // tanh approximation
+    LLAISYS_ACTIVATION_SWIGLU = 4, // silu(gate) * up over a weight stacked by llaisysLinearStackGateUp
+} llaisysActivation_t;
+
+// How llaisysLinearQuantizeQ4 maps each group to its 16 levels
+typedef enum {
+    LLAISYS_Q4_SYMMETRIC = 0,  // an fp16 scale only, codes centred on 8
+    LLAISYS_Q4_ZERO_POINT = 1, // an fp16 scale and a U8 zero point
+} llaisysQ4Mode_t;
+
 __C {
     __export void llaisysAdd(llaisysTensor_t c, llaisysTensor_t a, llaisysTensor_t b);
     __export void llaisysArgmax(llaisysTensor_t max_idx, llaisysTensor_t max_val, llaisysTensor_t vals);
     __export void llaisysEmbedding(llaisysTensor_t out, llaisysTensor_t index, llaisysTensor_t weight);
     __export void llaisysLinear(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t bias);
+    // out = activation(in * weight^T + bias) + residual, written once. `bias` and `residual` may be null;
+    // `residual` has the shape of out and may be out itself.
+    __export void llaisysLinearFused(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t bias,
+                                     llaisysTensor_t residual, llaisysActivation_t activation);
+    // Returns the concatenation of `nparts` weights [N_i, K] (or biases [N_i]) along the first dimension,
+    // e.g. Q/K/V projection weights fused into one at load time.
+    __export llaisysTensor_t llaisysLinearConcat(llaisysTensor_t *parts, size_t nparts);
+    // Returns gate [N, K] and up [N, K] weights (or [N] biases) interleaved in blocks of 32 rows, the layout
+    // llaisysLinearSwiGLU consumes. Pack or quantize the result like any other weight.
+    __export llaisysTensor_t llaisysLinearStackGateUp(llaisysTensor_t gate, llaisysTensor_t up);
+    // out [M, N] = silu(in * gate^T) * (in * up^T) in one pass over a stacked `gate_up` [2N, K] weight. `bias` may be null.
+    __export void llaisysLinearSwiGLU(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t gate_up, llaisysTensor_t bias);
+    // Returns a new tensor holding `weight` repacked for llaisysLinear. Call once at load time.
+    __export llaisysTensor_t llaisysLinearPackWeight(llaisysTensor_t weight);
+    // Returns an INT8 per-channel quantized copy of `weight`, usable as the weight of llaisysLinear.
+    __export llaisysTensor_t llaisysLinearQuantizeInt8(llaisysTensor_t weight);
+    // Returns a 4-bit quantized copy of `weight` with one fp16 scale (and, in LLAISYS_Q4_ZERO_POINT mode, a
+    // zero point) per `group_size` inputs. `group_size` must be a multiple of 32 dividing in_features.
+    __export llaisysTensor_t llaisysLinearQuantizeQ4(llaisysTensor_t weight, size_t group_size, llaisysQ4Mode_t mode);
+    // The k largest values of each row of in * weight^T (out_val, F32 [M, k]) and their columns (out_idx,
+    // I64 [M, k]), best first, found without writing the [M, N] product; k == 1 is argmax. `weight` is
+    // anything llaisysLinear takes.
+    __export void llaisysLinearTopK(llaisysTensor_t out_idx, llaisysTensor_t out_val, llaisysTensor_t in,
+                                   llaisysTensor_t weight, size_t k);
     __export void llaisysRearrange(llaisysTensor_t out, llaisysTensor_t in);
     __export void llaisysRmsNorm(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, float eps);
     __export void llaisysROPE(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t pos_ids, float theta);
+    // Re-bases rows of `in` rotated by llaisysROPE at position p to position p + delta. `out` may be `in`.
+    __export void llaisysROPEShift(llaisysTensor_t out, llaisysTensor_t in, int64_t delta, float theta);
+    // Draws max_idx[b] (I64 [batch]) from softmax(logits[b] / temperature) over the top_k largest logits
+    // (0: all) cut to the smallest set holding top_p of their mass. rng_state (host I64 [batch]) is a
+    // generator per row, seeded by the caller and advanced in place. top_k == 1 or temperature <= 0 is greedy.
+    __export void llaisysSample(llaisysTensor_t max_idx, llaisysTensor_t logits, llaisysTensor_t rng_state,
+                                size_t top_k, float top_p, float temperature);
     __export void llaisysSelfAttention(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k, llaisysTensor_t v, float scale);
+    // llaisysSelfAttention over the first `total_len` keys of paged caches [num_blocks, block_size, nkvh, d]:
+    // key t is row t % block_size of block block_table[t / block_size] (I32).
+    __export void llaisysSelfAttentionPaged(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k_cache,
+                                            llaisysTensor_t v_cache, llaisysTensor_t block_table, size_t total_len, float scale);
+    // llaisysSelfAttention of a ragged batch packed without padding: sequence b has queries
+    // q[cu_seqlens_q[b], cu_seqlens_q[b + 1]) and keys k, v[cu_seqlens_k[b], cu_seqlens_k[b + 1]), its
+    // queries being its last keys, each with its own causal mask. cu_seqlens_* are host I32 [batch + 1].
+    __export void llaisysSelfAttentionVarlen(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k,
+                                             llaisysTensor_t v, llaisysTensor_t cu_seqlens_q,
+                                             llaisysTensor_t cu_seqlens_k, float scale);
+    // llaisysSelfAttentionVarlen over a paged KV cache: sequence b has seq_lens_k[b] keys in the
+    // blocks listed by row b of block_tables. cu_seqlens_q [batch + 1], seq_lens_k [batch] and
+    // block_tables [batch, max_blocks] are host I32.
+    __export void llaisysSelfAttentionPagedVarlen(llaisysTensor_t attn_val, llaisysTensor_t q,
+                                                  llaisysTensor_t k_cache, llaisysTensor_t v_cache,
+                                                  llaisysTensor_t cu_seqlens_q, llaisysTensor_t seq_lens_k,
+                                                  llaisysTensor_t block_tables, float scale);
     __export void llaisysSwiGLU(llaisysTensor_t out, llaisysTensor_t gate, llaisysTensor_t up);
 }
 
@@ -3,6 +3,33 @@
 
 #include "../llaisys.h"
 
+// How linear forms products when its weights are stored in BF16. Accumulation
+// is always F32; the policies differ in what is multiplied.
+//
+// LLAISYS_PRECISION_F32 (default): weights and activations are widened to F32
+//   exactly and multiplied with F32 FMAs. The only rounding beyond F32
+//   summation is the final store to the output dtype. With F32 activations
+//   (weights BF16, everything between layers F32) this matches an F32
+//   reference to ~1e-6 relative per dot product.
+// LLAISYS_PRECISION_BF16_DOT: activations are rounded to BF16 (8-bit
+//   mantissa, relative error <= 2^-9 per element) and multiplied natively:
+//   AMX-BF16 tiles for multi-row inputs (prefill) where the OS grants them,
+//   AVX512_BF16 VDPBF16PS otherwise. Both flush subnormal inputs to zero.
+//   Products are exact and summed in F32, so the error of a K-long dot product
+//   grows like 2^-9 * sqrt(K) * |x||w| rather than with K: roughly 1e-3
+//   relative for K = 1536, comparable to storing the output in BF16 at all.
+//   Prefill GEMMs run several times faster on AMX; decode GEMVs are bound by
+//   weight bandwidth and gain little. Packed weights (llaisysLinearPackWeight)
+//   keep the F32 path. On CPUs without AVX512_BF16 (or builds that do not
+//   target it) this behaves exactly like F32.
+//
+// BF16 accumulation is deliberately not offered: summing K = 1536 products in
+// an 8-bit mantissa loses most significant digits.
+typedef enum {
+    LLAISYS_PRECISION_F32 = 0,
+    LLAISYS_PRECISION_BF16_DOT = 1,
+} llaisysPrecision_t;
+
 __C {
     // Runtime API Functions
     // Device
@@ -42,6 +69,10 @@ __C {
 
     // Llaisys API for switching device context
     __export void llaisysSetContextRuntime(llaisysDeviceType_t, int);
+
+    // Llaisys API for the precision policy of ops issued from the calling thread
+    __export void llaisysSetPrecision(llaisysPrecision_t);
+    __export llaisysPrecision_t llaisysGetPrecision();
 }
 
 #endif // LLAISYS_RUNTIME_H
@@ -1,10 +1,14 @@
-from .runtime import RuntimeAPI
+from .runtime import RuntimeAPI, set_precision, get_precision
 from .libllaisys import DeviceType
 from .libllaisys import DataType
 from .libllaisys import MemcpyKind
+from .libllaisys import Activation
+from .libllaisys import Precision
+from .libllaisys import Q4Mode
 from .libllaisys import llaisysStream_t as Stream
 from .tensor import Tensor
 from .ops import Ops
+from .kv_cache import KVCache
 from . import models
 from .models import *
 
@@ -13,8 +17,14 @@ __all__ = [
     "DeviceType",
     "DataType",
     "MemcpyKind",
+    "Activation",
+    "Precision",
+    "set_precision",
+    "get_precision",
+    "Q4Mode",
     "Stream",
     "Tensor",
     "Ops",
+    "KVCache",
     "models",
 ]
@@ -0,0 +1,117 @@
+from .libllaisys import LIB_LLAISYS, DataType, DeviceType, llaisysDataType_t, llaisysDeviceType_t
+from .tensor import Tensor
+from ctypes import byref, c_size_t, c_int, c_int64, c_float
+from typing import Sequence, Tuple
+
+
+class KVCache:
+    """Paged KV cache: per-layer K/V block pools shared by all sequences.
+
+    A sequence only holds the blocks its tokens occupy. Per step:
+    ``pos = cache.extend(seq, n)``, then for each layer ``cache.store(seq, layer, pos, k, v)``
+    and ``cache.attention(seq, layer, out, q, scale)``.
+
+    ``kv_dtype`` ``DataType.I8`` or ``DataType.F8`` stores K/V quantized with
+    one scale per token and head (CPU only); it defaults to ``dtype``.
+    """
+
+    def __init__(
+        self,
+        dtype: DataType,
+        nlayer: int,
+        nkvh: int,
+        dh: int,
+        block_size: int,
+        num_blocks: int,
+        device: DeviceType = DeviceType.CPU,
+        device_id: int = 0,
+        kv_dtype: DataType = None,
+    ):
+        self._cache = LIB_LLAISYS.llaisysKVCacheCreate(
+            llaisysDataType_t(dtype),
+            llaisysDataType_t(dtype if kv_dtype is None else kv_dtype),
+            c_size_t(nlayer),
+            c_size_t(nkvh),
+            c_size_t(dh),
+            c_size_t(block_size),
+            c_size_t(num_blocks),
+            llaisysDeviceType_t(device),
+            c_int(device_id),
+        )
+
+    def __del__(self):
+        if hasattr(self, "_cache") and self._cache is not None:
+            LIB_LLAISYS.llaisysKVCacheDestroy(self._cache)
+            self._cache = None
+
+    def block_size(self) -> int:
+        return LIB_LLAISYS.llaisysKVCacheBlockSize(self._cache)
+
+    def num_free_blocks(self) -> int:
+        return LIB_LLAISYS.llaisysKVCacheNumFreeBlocks(self._cache)
+
+    def keys(self, layer: int) -> Tensor:
+        return Tensor(tensor=LIB_LLAISYS.llaisysKVCacheKeys(self._cache, c_size_t(layer)))
+
+    def values(self, layer: int) -> Tensor:
+        return Tensor(tensor=LIB_LLAISYS.llaisysKVCacheValues(self._cache, c_size_t(layer)))
+
+    def add_sequence(self) -> int:
+        return LIB_LLAISYS.llaisysKVCacheAddSequence(self._cache)
+
+    def add_streaming_sequence(self, sink: int, window: int, theta: float) -> int:
+        """A sequence keeping its first ``sink`` tokens and the last ``window`` or fewer.
+
+        Store keys after RoPE with base ``theta`` at the position ``extend`` returns; older
+        keys are re-based as tokens are evicted, so the session can run indefinitely.
+        """
+        return LIB_LLAISYS.llaisysKVCacheAddStreamingSequence(
+            self._cache, c_size_t(sink), c_size_t(window), c_float(theta)
+        )
+
+    def add_sequence_with_prefix(self, token_ids: Sequence[int]) -> Tuple[int, int]:
+        """A sequence starting on the longest cached prefix of ``token_ids``.
+
+        Returns ``(seq, cached)``: prefill only ``token_ids[cached:]``, then call
+        ``commit_prefix(seq, token_ids)`` so later requests can reuse its blocks.
+        """
+        cached = c_size_t(0)
+        ids = (c_int64 * len(token_ids))(*token_ids)
+        seq = LIB_LLAISYS.llaisysKVCacheAddSequenceWithPrefix(self._cache, ids, c_size_t(len(token_ids)), byref(cached))
+        return seq, cached.value
+
+    def commit_prefix(self, seq: int, token_ids: Sequence[int]):
+        ids = (c_int64 * len(token_ids))(*token_ids)
+        LIB_LLAISYS.llaisysKVCacheCommitPrefix(self._cache, c_int64(seq), ids, c_size_t(len(token_ids)))
+
+    def prefix_blocks(self) -> int:
+        return LIB_LLAISYS.llaisysKVCachePrefixBlocks(self._cache)
+
+    def remove_sequence(self, seq: int):
+        LIB_LLAISYS.llaisysKVCacheRemoveSequence(self._cache, c_int64(seq))
+
+    def length(self, seq: int) -> int:
+        return LIB_LLAISYS.llaisysKVCacheLength(self._cache, c_int64(seq))
+
+    def evicted(self, seq: int) -> int:
+        return LIB_LLAISYS.llaisysKVCacheEvicted(self._cache, c_int64(seq))
+
+    def block_table(self, seq: int) -> Tensor:
+        return Tensor(tensor=LIB_LLAISYS.llaisysKVCacheBlockTable(self._cache, c_int64(seq)))
+
+    def extend(self, seq: int, ntoken: int) -> int:
+        return LIB_LLAISYS.llaisysKVCacheExtend(self._cache, c_int64(seq), c_size_t(ntoken))
+
+    def truncate(self, seq: int, length: int):
+        """Rolls ``seq`` back to its first ``length`` tokens, e.g. after rejected speculative tokens."""
+        LIB_LLAISYS.llaisysKVCacheTruncate(self._cache, c_int64(seq), c_size_t(length))
+
+    def store(self, seq: int, layer: int, pos: int, k: Tensor, v: Tensor):
+        LIB_LLAISYS.llaisysKVCacheStore(
+            self._cache, c_int64(seq), c_size_t(layer), c_size_t(pos), k.lib_tensor(), v.lib_tensor()
+        )
+
+    def attention(self, seq: int, layer: int, attn_val: Tensor, q: Tensor, scale: float):
+        LIB_LLAISYS.llaisysKVCacheAttention(
+            self._cache, c_int64(seq), c_size_t(layer), attn_val.lib_tensor(), q.lib_tensor(), c_float(scale)
+        )
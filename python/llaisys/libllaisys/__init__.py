@@ -8,10 +8,16 @@ from .runtime import LlaisysRuntimeAPI
 from .llaisys_types import llaisysDeviceType_t, DeviceType
 from .llaisys_types import llaisysDataType_t, DataType
 from .llaisys_types import llaisysMemcpyKind_t, MemcpyKind
+from .llaisys_types import llaisysActivation_t, Activation
+from .llaisys_types import llaisysPrecision_t, Precision
+from .llaisys_types import llaisysQ4Mode_t, Q4Mode
 from .llaisys_types import llaisysStream_t
 from .tensor import llaisysTensor_t
 from .tensor import load_tensor
 from .ops import load_ops
+from .kv_cache import load_kv_cache, llaisysKVCache_t
+from .models import load_models, llaisysQwen2Model_t, LlaisysQwen2Meta, LlaisysQwen2Weights, LlaisysQwen2BatchStats
+from .models import LlaisysQwen2SpecStats, LlaisysQwen2Options, llaisysQwen2WeightFormat_t, Qwen2WeightFormat
 
 
 def load_shared_library():
@@ -38,6 +44,8 @@ LIB_LLAISYS = load_shared_library()
 load_runtime(LIB_LLAISYS)
 load_tensor(LIB_LLAISYS)
 load_ops(LIB_LLAISYS)
+load_kv_cache(LIB_LLAISYS)
+load_models(LIB_LLAISYS)
 
 
 __all__ = [
@@ -45,11 +53,26 @@ __all__ = [
     "LlaisysRuntimeAPI",
     "llaisysStream_t",
     "llaisysTensor_t",
+    "llaisysKVCache_t",
+    "llaisysQwen2Model_t",
+    "LlaisysQwen2Meta",
+    "LlaisysQwen2Weights",
+    "LlaisysQwen2BatchStats",
+    "LlaisysQwen2SpecStats",
+    "LlaisysQwen2Options",
+    "llaisysQwen2WeightFormat_t",
+    "Qwen2WeightFormat",
     "llaisysDataType_t",
     "DataType",
     "llaisysDeviceType_t",
     "DeviceType",
     "llaisysMemcpyKind_t",
     "MemcpyKind",
+    "llaisysActivation_t",
+    "Activation",
+    "llaisysPrecision_t",
+    "Precision",
+    "llaisysQ4Mode_t",
+    "Q4Mode",
     "llaisysStream_t",
 ]
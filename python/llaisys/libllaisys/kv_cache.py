@@ -0,0 +1,94 @@
+from ctypes import POINTER, c_void_p, c_size_t, c_int, c_int64, c_float
+from .llaisys_types import llaisysDataType_t, llaisysDeviceType_t
+from .tensor import llaisysTensor_t
+
+# Handle type
+llaisysKVCache_t = c_void_p
+
+
+def load_kv_cache(lib):
+    lib.llaisysKVCacheCreate.argtypes = [
+        llaisysDataType_t,  # dtype
+        llaisysDataType_t,  # kv_dtype
+        c_size_t,  # nlayer
+        c_size_t,  # nkvh
+        c_size_t,  # dh
+        c_size_t,  # block_size
+        c_size_t,  # num_blocks
+        llaisysDeviceType_t,  # device
+        c_int,  # device_id
+    ]
+    lib.llaisysKVCacheCreate.restype = llaisysKVCache_t
+
+    lib.llaisysKVCacheDestroy.argtypes = [llaisysKVCache_t]
+    lib.llaisysKVCacheDestroy.restype = None
+
+    lib.llaisysKVCacheBlockSize.argtypes = [llaisysKVCache_t]
+    lib.llaisysKVCacheBlockSize.restype = c_size_t
+
+    lib.llaisysKVCacheNumFreeBlocks.argtypes = [llaisysKVCache_t]
+    lib.llaisysKVCacheNumFreeBlocks.restype = c_size_t
+
+    lib.llaisysKVCacheKeys.argtypes = [llaisysKVCache_t, c_size_t]
+    lib.llaisysKVCacheKeys.restype = llaisysTensor_t
+
+    lib.llaisysKVCacheValues.argtypes = [llaisysKVCache_t, c_size_t]
+    lib.llaisysKVCacheValues.restype = llaisysTensor_t
+
+    lib.llaisysKVCacheAddSequence.argtypes = [llaisysKVCache_t]
+    lib.llaisysKVCacheAddSequence.restype = c_int64
+
+    lib.llaisysKVCacheAddStreamingSequence.argtypes = [llaisysKVCache_t, c_size_t, c_size_t, c_float]
+    lib.llaisysKVCacheAddStreamingSequence.restype = c_int64
+
+    lib.llaisysKVCacheAddSequenceWithPrefix.argtypes = [
+        llaisysKVCache_t,
+        POINTER(c_int64),  # token_ids
+        c_size_t,  # ntoken
+        POINTER(c_size_t),  # cached
+    ]
+    lib.llaisysKVCacheAddSequenceWithPrefix.restype = c_int64
+
+    lib.llaisysKVCacheCommitPrefix.argtypes = [llaisysKVCache_t, c_int64, POINTER(c_int64), c_size_t]
+    lib.llaisysKVCacheCommitPrefix.restype = None
+
+    lib.llaisysKVCachePrefixBlocks.argtypes = [llaisysKVCache_t]
+    lib.llaisysKVCachePrefixBlocks.restype = c_size_t
+
+    lib.llaisysKVCacheRemoveSequence.argtypes = [llaisysKVCache_t, c_int64]
+    lib.llaisysKVCacheRemoveSequence.restype = None
+
+    lib.llaisysKVCacheLength.argtypes = [llaisysKVCache_t, c_int64]
+    lib.llaisysKVCacheLength.restype = c_size_t
+
+    lib.llaisysKVCacheEvicted.argtypes = [llaisysKVCache_t, c_int64]
+    lib.llaisysKVCacheEvicted.restype = c_size_t
+
+    lib.llaisysKVCacheBlockTable.argtypes = [llaisysKVCache_t, c_int64]
+    lib.llaisysKVCacheBlockTable.restype = llaisysTensor_t
+
+    lib.llaisysKVCacheExtend.argtypes = [llaisysKVCache_t, c_int64, c_size_t]
+    lib.llaisysKVCacheExtend.restype = c_size_t
+
+    lib.llaisysKVCacheTruncate.argtypes = [llaisysKVCache_t, c_int64, c_size_t]
+    lib.llaisysKVCacheTruncate.restype = None
+
+    lib.llaisysKVCacheStore.argtypes = [
+        llaisysKVCache_t,
+        c_int64,  # seq
+        c_size_t,  # layer
+        c_size_t,  # pos
+        llaisysTensor_t,  # k
+        llaisysTensor_t,  # v
+    ]
+    lib.llaisysKVCacheStore.restype = None
+
+    lib.llaisysKVCacheAttention.argtypes = [
+        llaisysKVCache_t,
+        c_int64,  # seq
+        c_size_t,  # layer
+        llaisysTensor_t,  # attn_val
+        llaisysTensor_t,  # q
+        c_float,  # scale
+    ]
+    lib.llaisysKVCacheAttention.restype = None
@@ -49,6 +49,33 @@ class MemcpyKind(IntEnum):
 
 llaisysMemcpyKind_t = ctypes.c_int
 
+# Activation enum, fused into the output of linear
+class Activation(IntEnum):
+    NONE = 0
+    RELU = 1
+    SILU = 2
+    GELU = 3
+    SWIGLU = 4
+
+
+llaisysActivation_t = ctypes.c_int
+
+# Precision policy of linear over BF16 weights, see llaisysPrecision_t
+class Precision(IntEnum):
+    F32 = 0
+    BF16_DOT = 1
+
+
+llaisysPrecision_t = ctypes.c_int
+
+# Q4 weight quantization mode, see llaisysQ4Mode_t
+class Q4Mode(IntEnum):
+    SYMMETRIC = 0
+    ZERO_POINT = 1
+
+
+llaisysQ4Mode_t = ctypes.c_int
+
 # Stream type (opaque pointer)
 llaisysStream_t = ctypes.c_void_p
 
@@ -59,5 +86,11 @@ __all__ = [
     "DataType",
     "llaisysMemcpyKind_t",
     "MemcpyKind",
+    "llaisysActivation_t",
+    "Activation",
+    "llaisysPrecision_t",
+    "Precision",
+    "llaisysQ4Mode_t",
+    "Q4Mode",
     "llaisysStream_t",
 ]
@@ -0,0 +1,154 @@
+from ctypes import POINTER, Structure, c_void_p, c_size_t, c_int, c_int64, c_uint8, c_uint64, c_float, c_double
+from .llaisys_types import llaisysDataType_t, llaisysDeviceType_t, llaisysPrecision_t, llaisysQ4Mode_t
+from enum import IntEnum
+from .tensor import llaisysTensor_t
+
+# Handle type
+llaisysQwen2Model_t = c_void_p
+
+
+# How prepared Qwen2 weights are stored, see llaisysQwen2WeightFormat_t
+class Qwen2WeightFormat(IntEnum):
+    DENSE = 0
+    INT8 = 1
+    Q4 = 2
+
+
+llaisysQwen2WeightFormat_t = c_int
+
+
+class LlaisysQwen2Meta(Structure):
+    _fields_ = [
+        ("dtype", llaisysDataType_t),
+        ("nlayer", c_size_t),
+        ("hs", c_size_t),
+        ("nh", c_size_t),
+        ("nkvh", c_size_t),
+        ("dh", c_size_t),
+        ("di", c_size_t),
+        ("maxseq", c_size_t),
+        ("voc", c_size_t),
+        ("epsilon", c_float),
+        ("theta", c_float),
+        ("end_token", c_int64),
+    ]
+
+
+class LlaisysQwen2Options(Structure):
+    _fields_ = [
+        ("weight_format", llaisysQwen2WeightFormat_t),
+        ("q4_group_size", c_size_t),
+        ("q4_mode", llaisysQ4Mode_t),
+        ("precision", llaisysPrecision_t),
+        ("kv_dtype", llaisysDataType_t),
+        ("sink", c_size_t),
+        ("window", c_size_t),
+    ]
+
+
+class LlaisysQwen2Weights(Structure):
+    _fields_ = [
+        ("in_embed", llaisysTensor_t),
+        ("out_embed", llaisysTensor_t),
+        ("out_norm_w", llaisysTensor_t),
+        ("attn_norm_w", POINTER(llaisysTensor_t)),
+        ("attn_q_w", POINTER(llaisysTensor_t)),
+        ("attn_q_b", POINTER(llaisysTensor_t)),
+        ("attn_k_w", POINTER(llaisysTensor_t)),
+        ("attn_k_b", POINTER(llaisysTensor_t)),
+        ("attn_v_w", POINTER(llaisysTensor_t)),
+        ("attn_v_b", POINTER(llaisysTensor_t)),
+        ("attn_o_w", POINTER(llaisysTensor_t)),
+        ("mlp_norm_w", POINTER(llaisysTensor_t)),
+        ("mlp_gate_w", POINTER(llaisysTensor_t)),
+        ("mlp_up_w", POINTER(llaisysTensor_t)),
+        ("mlp_down_w", POINTER(llaisysTensor_t)),
+    ]
+
+
+class LlaisysQwen2BatchStats(Structure):
+    _fields_ = [
+        ("steps", c_size_t),
+        ("prefill_tokens", c_size_t),
+        ("generated_tokens", c_size_t),
+        ("seconds", c_double),
+        ("tokens_per_second", c_double),
+    ]
+
+
+class LlaisysQwen2SpecStats(Structure):
+    _fields_ = [
+        ("steps", c_size_t),
+        ("proposed", c_size_t),
+        ("accepted", c_size_t),
+        ("generated", c_size_t),
+        ("seconds", c_double),
+        ("acceptance_rate", c_double),
+        ("tokens_per_step", c_double),
+    ]
+
+
+def load_models(lib):
+    lib.llaisysQwen2ModelCreate.argtypes = [
+        POINTER(LlaisysQwen2Meta),
+        llaisysDeviceType_t,
+        POINTER(c_int),  # device_ids
+        c_int,  # ndevice
+    ]
+    lib.llaisysQwen2ModelCreate.restype = llaisysQwen2Model_t
+
+    lib.llaisysQwen2ModelDestroy.argtypes = [llaisysQwen2Model_t]
+    lib.llaisysQwen2ModelDestroy.restype = None
+
+    lib.llaisysQwen2ModelWeights.argtypes = [llaisysQwen2Model_t]
+    lib.llaisysQwen2ModelWeights.restype = POINTER(LlaisysQwen2Weights)
+
+    lib.llaisysQwen2ModelSetOptions.argtypes = [llaisysQwen2Model_t, POINTER(LlaisysQwen2Options)]
+    lib.llaisysQwen2ModelSetOptions.restype = None
+
+    lib.llaisysQwen2ModelInfer.argtypes = [llaisysQwen2Model_t, POINTER(c_int64), c_size_t]
+    lib.llaisysQwen2ModelInfer.restype = c_int64
+
+    lib.llaisysQwen2ModelSetSampling.argtypes = [
+        llaisysQwen2Model_t,
+        c_size_t,  # top_k
+        c_float,  # top_p
+        c_float,  # temperature
+        c_uint64,  # seed
+    ]
+    lib.llaisysQwen2ModelSetSampling.restype = None
+
+    lib.llaisysQwen2ModelEnqueue.argtypes = [
+        llaisysQwen2Model_t,
+        POINTER(c_int64),  # token_ids
+        c_size_t,  # ntoken
+        c_size_t,  # max_new_tokens
+    ]
+    lib.llaisysQwen2ModelEnqueue.restype = c_int64
+
+    lib.llaisysQwen2ModelStep.argtypes = [llaisysQwen2Model_t]
+    lib.llaisysQwen2ModelStep.restype = c_size_t
+
+    lib.llaisysQwen2ModelPoll.argtypes = [
+        llaisysQwen2Model_t,
+        c_int64,  # request
+        POINTER(c_int64),  # token_ids
+        c_size_t,  # capacity
+        POINTER(c_uint8),  # done
+    ]
+    lib.llaisysQwen2ModelPoll.restype = c_size_t
+
+    lib.llaisysQwen2ModelBatchStats.argtypes = [llaisysQwen2Model_t, POINTER(LlaisysQwen2BatchStats)]
+    lib.llaisysQwen2ModelBatchStats.restype = None
+
+    lib.llaisysQwen2ModelGenerateSpeculative.argtypes = [
+        llaisysQwen2Model_t,
+        POINTER(c_int64),  # token_ids
+        c_size_t,  # ntoken
+        c_size_t,  # max_new_tokens
+        llaisysQwen2Model_t,  # draft_model, may be None
+        c_size_t,  # num_speculative
+        POINTER(c_int64),  # out_tokens
+        POINTER(LlaisysQwen2SpecStats),
+    ]
+    lib.llaisysQwen2ModelGenerateSpeculative.restype = c_size_t
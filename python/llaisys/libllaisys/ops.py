@@ -1,5 +1,6 @@
 from .tensor import llaisysTensor_t
-from ctypes import c_float
+from .llaisys_types import llaisysActivation_t, llaisysQ4Mode_t
+from ctypes import POINTER, c_float, c_int64, c_size_t
 
 def load_ops(lib):
     lib.llaisysAdd.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
@@ -14,6 +15,37 @@ def load_ops(lib):
     lib.llaisysLinear.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
     lib.llaisysLinear.restype = None
 
+    lib.llaisysLinearFused.argtypes = [
+        llaisysTensor_t,
+        llaisysTensor_t,
+        llaisysTensor_t,
+        llaisysTensor_t,
+        llaisysTensor_t,
+        llaisysActivation_t,
+    ]
+    lib.llaisysLinearFused.restype = None
+
+    lib.llaisysLinearConcat.argtypes = [POINTER(llaisysTensor_t), c_size_t]
+    lib.llaisysLinearConcat.restype = llaisysTensor_t
+
+    lib.llaisysLinearStackGateUp.argtypes = [llaisysTensor_t, llaisysTensor_t]
+    lib.llaisysLinearStackGateUp.restype = llaisysTensor_t
+
+    lib.llaisysLinearSwiGLU.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
+    lib.llaisysLinearSwiGLU.restype = None
+
+    lib.llaisysLinearPackWeight.argtypes = [llaisysTensor_t]
+    lib.llaisysLinearPackWeight.restype = llaisysTensor_t
+
+    lib.llaisysLinearQuantizeInt8.argtypes = [llaisysTensor_t]
+    lib.llaisysLinearQuantizeInt8.restype = llaisysTensor_t
+
+    lib.llaisysLinearQuantizeQ4.argtypes = [llaisysTensor_t, c_size_t, llaisysQ4Mode_t]
+    lib.llaisysLinearQuantizeQ4.restype = llaisysTensor_t
+
+    lib.llaisysLinearTopK.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, c_size_t]
+    lib.llaisysLinearTopK.restype = None
+
     lib.llaisysRearrange.argtypes = [llaisysTensor_t, llaisysTensor_t]
     lib.llaisysRearrange.restype = None
 
@@ -23,6 +55,19 @@ def load_ops(lib):
     lib.llaisysROPE.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, c_float]
     lib.llaisysROPE.restype = None
 
+    lib.llaisysROPEShift.argtypes = [llaisysTensor_t, llaisysTensor_t, c_int64, c_float]
+    lib.llaisysROPEShift.restype = None
+
+    lib.llaisysSample.argtypes = [
+        llaisysTensor_t,  # max_idx
+        llaisysTensor_t,  # logits
+        llaisysTensor_t,  # rng_state
+        c_size_t,  # top_k
+        c_float,  # top_p
+        c_float,  # temperature
+    ]
+    lib.llaisysSample.restype = None
+
     lib.llaisysSelfAttention.argtypes = [
         llaisysTensor_t,  # attn_val
         llaisysTensor_t,  # q
@@ -32,5 +77,39 @@ def load_ops(lib):
     ]
     lib.llaisysSelfAttention.restype = None
 
+    lib.llaisysSelfAttentionPaged.argtypes = [
+        llaisysTensor_t,  # attn_val
+        llaisysTensor_t,  # q
+        llaisysTensor_t,  # k_cache
+        llaisysTensor_t,  # v_cache
+        llaisysTensor_t,  # block_table
+        c_size_t,  # total_len
+        c_float,  # scale
+    ]
+    lib.llaisysSelfAttentionPaged.restype = None
+
+    lib.llaisysSelfAttentionVarlen.argtypes = [
+        llaisysTensor_t,  # attn_val
+        llaisysTensor_t,  # q
+        llaisysTensor_t,  # k
+        llaisysTensor_t,  # v
+        llaisysTensor_t,  # cu_seqlens_q
+        llaisysTensor_t,  # cu_seqlens_k
+        c_float,  # scale
+    ]
+    lib.llaisysSelfAttentionVarlen.restype = None
+
+    lib.llaisysSelfAttentionPagedVarlen.argtypes = [
+        llaisysTensor_t,  # attn_val
+        llaisysTensor_t,  # q
+        llaisysTensor_t,  # k_cache
+        llaisysTensor_t,  # v_cache
+        llaisysTensor_t,  # cu_seqlens_q
+        llaisysTensor_t,  # seq_lens_k
+        llaisysTensor_t,  # block_tables
+        c_float,  # scale
+    ]
+    lib.llaisysSelfAttentionPagedVarlen.restype = None
+
     lib.llaisysSwiGLU.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
     lib.llaisysSwiGLU.restype = None
@@ -46,3 +46,9 @@ def load_runtime(lib):
 
     lib.llaisysSetContextRuntime.argtypes = [llaisysDeviceType_t, c_int]
     lib.llaisysSetContextRuntime.restype = None
+
+    lib.llaisysSetPrecision.argtypes = [llaisysPrecision_t]
+    lib.llaisysSetPrecision.restype = None
+
+    lib.llaisysGetPrecision.argtypes = []
+    lib.llaisysGetPrecision.restype = llaisysPrecision_t
@@ -1 +1,2 @@
 from .qwen2 import Qwen2
+from ..libllaisys import Qwen2WeightFormat
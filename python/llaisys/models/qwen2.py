@@ -1,23 +1,136 @@
-from typing import Sequence
+from typing import List, Sequence, Tuple
 from ..libllaisys import LIB_LLAISYS
-from ..libllaisys import DeviceType
+from ..libllaisys import DeviceType, DataType, LlaisysQwen2Meta, LlaisysQwen2BatchStats, LlaisysQwen2SpecStats
+from ..libllaisys import LlaisysQwen2Options, Qwen2WeightFormat, Q4Mode, Precision
 
+from ctypes import byref, c_float, c_int, c_int64, c_size_t, c_uint8, c_uint64
 from pathlib import Path
+import json
 import safetensors
 
 
+_DTYPES = {
+    "float32": DataType.F32,
+    "float16": DataType.F16,
+    "bfloat16": DataType.BF16,
+}
+
+# per-layer checkpoint names -> LlaisysQwen2Weights arrays
+_LAYER_WEIGHTS = {
+    "input_layernorm.weight": "attn_norm_w",
+    "self_attn.q_proj.weight": "attn_q_w",
+    "self_attn.q_proj.bias": "attn_q_b",
+    "self_attn.k_proj.weight": "attn_k_w",
+    "self_attn.k_proj.bias": "attn_k_b",
+    "self_attn.v_proj.weight": "attn_v_w",
+    "self_attn.v_proj.bias": "attn_v_b",
+    "self_attn.o_proj.weight": "attn_o_w",
+    "post_attention_layernorm.weight": "mlp_norm_w",
+    "mlp.gate_proj.weight": "mlp_gate_w",
+    "mlp.up_proj.weight": "mlp_up_w",
+    "mlp.down_proj.weight": "mlp_down_w",
+}
+
+
 class Qwen2:
+    """Qwen2 decoder running natively: weights, activations and the KV cache live in C++,
+    and each generated token is one ``llaisysQwen2ModelInfer`` call.
 
-    def __init__(self, model_path, device: DeviceType = DeviceType.CPU):
-        # TODO: Implement model constructor
+    ``weight_format`` stores the projections and the LM head as they are (``DENSE``) or
+    quantized to ``INT8`` or ``Q4`` (groups of ``q4_group_size`` mapped by ``q4_mode``);
+    every forward runs under ``precision``. The KV cache stores K/V in ``kv_dtype`` (the
+    checkpoint's type by default, or ``DataType.I8`` / ``DataType.F8``); a ``window`` > 0 streams
+    every sequence, keeping its first ``sink`` tokens and the last ``window``, past ``maxseq``."""
+
+    def __init__(
+        self,
+        model_path,
+        device: DeviceType = DeviceType.CPU,
+        weight_format: Qwen2WeightFormat = Qwen2WeightFormat.DENSE,
+        q4_group_size: int = 128,
+        q4_mode: Q4Mode = Q4Mode.SYMMETRIC,
+        precision: Precision = Precision.F32,
+        kv_dtype: DataType = None,
+        sink: int = 0,
+        window: int = 0,
+    ):
+        # numpy has no bfloat16: checkpoints are read as torch tensors
+        import torch
 
         model_path = Path(model_path)
+        with open(model_path / "config.json") as f:
+            config = json.load(f)
+        torch_dtype = config.get("torch_dtype", "bfloat16")
+        dtype, self._torch_dtype = _DTYPES[torch_dtype], getattr(torch, torch_dtype)
+        eos = config.get("eos_token_id", -1)
+
+        nh = config["num_attention_heads"]
+        self._meta = LlaisysQwen2Meta(
+            dtype=dtype,
+            nlayer=config["num_hidden_layers"],
+            hs=config["hidden_size"],
+            nh=nh,
+            nkvh=config.get("num_key_value_heads", nh),
+            dh=config["hidden_size"] // nh,
+            di=config["intermediate_size"],
+            maxseq=config["max_position_embeddings"],
+            voc=config["vocab_size"],
+            epsilon=config["rms_norm_eps"],
+            theta=config.get("rope_theta", 10000.0),
+            end_token=eos[0] if isinstance(eos, list) else eos,
+        )
+        device_ids = (c_int * 1)(0)
+        self._model = LIB_LLAISYS.llaisysQwen2ModelCreate(byref(self._meta), device, device_ids, 1)
+        options = LlaisysQwen2Options(
+            weight_format=weight_format,
+            q4_group_size=q4_group_size,
+            q4_mode=q4_mode,
+            precision=precision,
+            kv_dtype=dtype if kv_dtype is None else kv_dtype,
+            sink=sink,
+            window=window,
+        )
+        self._streaming = window > 0
+        LIB_LLAISYS.llaisysQwen2ModelSetOptions(self._model, byref(options))
+        weights = LIB_LLAISYS.llaisysQwen2ModelWeights(self._model).contents
 
+        has_lm_head = False
         for file in sorted(model_path.glob("*.safetensors")):
-            data_ = safetensors.safe_open(file, framework="numpy", device="cpu")
+            data_ = safetensors.safe_open(file, framework="pt", device="cpu")
             for name_ in data_.keys():
-                ## TODO: load the model weights
-                pass
+                handle = self._weight_handle(weights, name_)
+                if handle is None:
+                    continue
+                self._load(handle, data_.get_tensor(name_))
+                if name_ == "model.embed_tokens.weight" and config.get("tie_word_embeddings", False):
+                    self._load(weights.out_embed, data_.get_tensor(name_))
+                has_lm_head = has_lm_head or name_ == "lm_head.weight"
+        if not has_lm_head and not config.get("tie_word_embeddings", False):
+            raise ValueError(f"{model_path} has no lm_head.weight and does not tie embeddings")
+
+    def __del__(self):
+        if hasattr(self, "_model") and self._model is not None:
+            LIB_LLAISYS.llaisysQwen2ModelDestroy(self._model)
+            self._model = None
+
+    @staticmethod
+    def _weight_handle(weights, name):
+        if name == "model.embed_tokens.weight":
+            return weights.in_embed
+        if name == "lm_head.weight":
+            return weights.out_embed
+        if name == "model.norm.weight":
+            return weights.out_norm_w
+        if name.startswith("model.layers."):
+            layer, _, suffix = name[len("model.layers.") :].partition(".")
+            field = _LAYER_WEIGHTS.get(suffix)
+            if field is not None:
+                return getattr(weights, field)[int(layer)]
+        return None
+
+    def _load(self, handle, tensor):
+        tensor = tensor.to(self._torch_dtype).contiguous()
+        LIB_LLAISYS.tensorLoad(handle, tensor.data_ptr())
 
     def generate(
         self,
@@ -26,8 +139,81 @@ class Qwen2:
         top_k: int = 1,
         top_p: float = 0.8,
         temperature: float = 0.8,
+        seed: int = 0,
     ):
+        """Returns ``inputs`` followed by up to ``max_new_tokens`` tokens, stopping after the end
+        token. Tokens are sampled natively under ``top_k`` / ``top_p`` / ``temperature`` from a
+        generator seeded with ``seed``; ``top_k=1`` is greedy."""
+        tokens = list(inputs)
+        if max_new_tokens is None:
+            max_new_tokens = self._meta.maxseq - (0 if self._streaming else len(tokens))
+        LIB_LLAISYS.llaisysQwen2ModelSetSampling(
+            self._model, c_size_t(top_k), c_float(top_p), c_float(temperature), c_uint64(seed)
+        )
+        for _ in range(max_new_tokens):
+            ids = (c_int64 * len(tokens))(*tokens)
+            next_token = LIB_LLAISYS.llaisysQwen2ModelInfer(self._model, ids, c_size_t(len(tokens)))
+            tokens.append(next_token)
+            if next_token == self._meta.end_token:
+                break
+        return tokens
+
+    def enqueue(self, inputs: Sequence[int], max_new_tokens: int = 128) -> int:
+        """Adds a request to the continuous batch; returns its id for ``poll``. The request reserves
+        KV cache for ``max_new_tokens`` tokens, so keep it to what it may really generate."""
+        if max_new_tokens is None or max_new_tokens <= 0:
+            raise ValueError("max_new_tokens must be a positive number of tokens")
+        ids = (c_int64 * len(inputs))(*inputs)
+        return LIB_LLAISYS.llaisysQwen2ModelEnqueue(
+            self._model, ids, c_size_t(len(inputs)), c_size_t(max_new_tokens)
+        )
+
+    def step(self) -> int:
+        """One batched forward over every running request; returns how many are not finished."""
+        return LIB_LLAISYS.llaisysQwen2ModelStep(self._model)
+
+    def poll(self, request: int) -> Tuple[List[int], bool]:
+        """The tokens generated so far for ``request`` and whether it has finished."""
+        done = c_uint8(0)
+        n = LIB_LLAISYS.llaisysQwen2ModelPoll(self._model, c_int64(request), None, c_size_t(0), byref(done))
+        buf = (c_int64 * n)()
+        LIB_LLAISYS.llaisysQwen2ModelPoll(self._model, c_int64(request), buf, c_size_t(n), byref(done))
+        return list(buf), bool(done.value)
 
-        # TODO: Implement generate function
+    def batch_stats(self) -> dict:
+        stats = LlaisysQwen2BatchStats()
+        LIB_LLAISYS.llaisysQwen2ModelBatchStats(self._model, byref(stats))
+        return {name: getattr(stats, name) for name, _ in stats._fields_}
 
-        return []
+    def generate_batch(self, inputs: Sequence[Sequence[int]], max_new_tokens: int = 128) -> List[List[int]]:
+        """Greedy decoding of several prompts at once through the continuous batch."""
+        requests = [self.enqueue(tokens, max_new_tokens) for tokens in inputs]
+        while self.step() > 0:
+            pass
+        return [list(tokens) + self.poll(r)[0] for tokens, r in zip(inputs, requests)]
+
+    def generate_speculative(
+        self,
+        inputs: Sequence[int],
+        max_new_tokens: int = None,
+        num_speculative: int = 4,
+        draft: "Qwen2" = None,
+    ) -> Tuple[List[int], dict]:
+        """Greedy decoding like ``generate``, verifying ``num_speculative`` proposed tokens per forward.
+        Proposals come from ``draft`` (a smaller Qwen2 with the same vocabulary) or, without one, from
+        n-gram lookup in the sequence so far. Returns the tokens and the acceptance statistics."""
+        ids = (c_int64 * len(inputs))(*inputs)
+        capacity = max_new_tokens or self._meta.maxseq - (0 if self._streaming else len(inputs))
+        out = (c_int64 * capacity)()
+        stats = LlaisysQwen2SpecStats()
+        n = LIB_LLAISYS.llaisysQwen2ModelGenerateSpeculative(
+            self._model,
+            ids,
+            c_size_t(len(inputs)),
+            c_size_t(max_new_tokens or 0),
+            draft._model if draft is not None else None,
+            c_size_t(num_speculative),
+            out,
+            byref(stats),
+        )
+        return list(inputs) + out[:n], {name: getattr(stats, name) for name, _ in stats._fields_}
@@ -1,6 +1,6 @@
-from .libllaisys import LIB_LLAISYS
+from .libllaisys import LIB_LLAISYS, llaisysTensor_t, Activation, Q4Mode
 from .tensor import Tensor
-from ctypes import c_float, c_int
+from ctypes import c_float, c_int, c_int64, c_size_t
 
 
 class Ops:
@@ -19,9 +19,67 @@ class Ops:
         )
 
     @staticmethod
-    def linear(out: Tensor, inp: Tensor, weight: Tensor, bias: Tensor):
-        LIB_LLAISYS.llaisysLinear(
-            out.lib_tensor(), inp.lib_tensor(), weight.lib_tensor(), bias.lib_tensor()
+    def linear(
+        out: Tensor,
+        inp: Tensor,
+        weight: Tensor,
+        bias: Tensor = None,
+        residual: Tensor = None,
+        activation: Activation = Activation.NONE,
+    ):
+        """out = activation(inp @ weight.T + bias) + residual; `residual` may be `out` itself."""
+        if residual is None and activation == Activation.NONE:
+            LIB_LLAISYS.llaisysLinear(
+                out.lib_tensor(),
+                inp.lib_tensor(),
+                weight.lib_tensor(),
+                bias.lib_tensor() if bias is not None else None,
+            )
+            return
+        LIB_LLAISYS.llaisysLinearFused(
+            out.lib_tensor(),
+            inp.lib_tensor(),
+            weight.lib_tensor(),
+            bias.lib_tensor() if bias is not None else None,
+            residual.lib_tensor() if residual is not None else None,
+            c_int(activation),
+        )
+
+    @staticmethod
+    def linear_concat(parts) -> Tensor:
+        handles = (llaisysTensor_t * len(parts))(*[p.lib_tensor() for p in parts])
+        return Tensor(tensor=LIB_LLAISYS.llaisysLinearConcat(handles, c_size_t(len(parts))))
+
+    @staticmethod
+    def linear_stack_gate_up(gate: Tensor, up: Tensor) -> Tensor:
+        return Tensor(tensor=LIB_LLAISYS.llaisysLinearStackGateUp(gate.lib_tensor(), up.lib_tensor()))
+
+    @staticmethod
+    def linear_swiglu(out: Tensor, inp: Tensor, gate_up: Tensor, bias: Tensor = None):
+        LIB_LLAISYS.llaisysLinearSwiGLU(
+            out.lib_tensor(),
+            inp.lib_tensor(),
+            gate_up.lib_tensor(),
+            bias.lib_tensor() if bias is not None else None,
+        )
+
+    @staticmethod
+    def linear_pack_weight(weight: Tensor) -> Tensor:
+        return Tensor(tensor=LIB_LLAISYS.llaisysLinearPackWeight(weight.lib_tensor()))
+
+    @staticmethod
+    def linear_quantize_int8(weight: Tensor) -> Tensor:
+        return Tensor(tensor=LIB_LLAISYS.llaisysLinearQuantizeInt8(weight.lib_tensor()))
+
+    @staticmethod
+    def linear_quantize_q4(weight: Tensor, group_size: int = 128, mode: Q4Mode = Q4Mode.SYMMETRIC) -> Tensor:
+        return Tensor(tensor=LIB_LLAISYS.llaisysLinearQuantizeQ4(weight.lib_tensor(), c_size_t(group_size), mode))
+
+    @staticmethod
+    def linear_topk(out_idx: Tensor, out_val: Tensor, inp: Tensor, weight: Tensor, k: int):
+        """Top-k of each row of inp @ weight.T, best first, without materializing the product."""
+        LIB_LLAISYS.llaisysLinearTopK(
+            out_idx.lib_tensor(), out_val.lib_tensor(), inp.lib_tensor(), weight.lib_tensor(), c_size_t(k)
         )
 
     @staticmethod
@@ -40,6 +98,30 @@ class Ops:
             out.lib_tensor(), inp.lib_tensor(), pos_ids.lib_tensor(), c_float(theta)
         )
 
+    @staticmethod
+    def rope_shift(out: Tensor, inp: Tensor, delta: int, theta: float):
+        LIB_LLAISYS.llaisysROPEShift(out.lib_tensor(), inp.lib_tensor(), c_int64(delta), c_float(theta))
+
+    @staticmethod
+    def sample(
+        max_idx: Tensor,
+        logits: Tensor,
+        rng_state: Tensor,
+        top_k: int = 0,
+        top_p: float = 1.0,
+        temperature: float = 1.0,
+    ):
+        """Draws max_idx[b] from row b of logits [batch, voc] under top-k / top-p / temperature; rng_state
+        (host I64 [batch]) holds a generator per row, seeded by the caller and advanced in place."""
+        LIB_LLAISYS.llaisysSample(
+            max_idx.lib_tensor(),
+            logits.lib_tensor(),
+            rng_state.lib_tensor(),
+            c_size_t(top_k),
+            c_float(top_p),
+            c_float(temperature),
+        )
+
     @staticmethod
     def self_attention(attn_val: Tensor, q: Tensor, k: Tensor, v: Tensor, scale: float):
         LIB_LLAISYS.llaisysSelfAttention(
@@ -50,6 +132,74 @@ class Ops:
             c_float(scale),
         )
 
+    @staticmethod
+    def self_attention_paged(
+        attn_val: Tensor,
+        q: Tensor,
+        k_cache: Tensor,
+        v_cache: Tensor,
+        block_table: Tensor,
+        total_len: int,
+        scale: float,
+    ):
+        """self_attention over the first `total_len` keys of [num_blocks, block_size, nkvh, d] block pools;
+        key t is row t % block_size of block block_table[t // block_size]."""
+        LIB_LLAISYS.llaisysSelfAttentionPaged(
+            attn_val.lib_tensor(),
+            q.lib_tensor(),
+            k_cache.lib_tensor(),
+            v_cache.lib_tensor(),
+            block_table.lib_tensor(),
+            c_size_t(total_len),
+            c_float(scale),
+        )
+
+    @staticmethod
+    def self_attention_varlen(
+        attn_val: Tensor,
+        q: Tensor,
+        k: Tensor,
+        v: Tensor,
+        cu_seqlens_q: Tensor,
+        cu_seqlens_k: Tensor,
+        scale: float,
+    ):
+        """self_attention of a packed ragged batch: sequence b has queries q[cu_seqlens_q[b]:cu_seqlens_q[b + 1]]
+        and keys k, v[cu_seqlens_k[b]:cu_seqlens_k[b + 1]], its queries being its last keys (I32 offsets)."""
+        LIB_LLAISYS.llaisysSelfAttentionVarlen(
+            attn_val.lib_tensor(),
+            q.lib_tensor(),
+            k.lib_tensor(),
+            v.lib_tensor(),
+            cu_seqlens_q.lib_tensor(),
+            cu_seqlens_k.lib_tensor(),
+            c_float(scale),
+        )
+
+    @staticmethod
+    def self_attention_paged_varlen(
+        attn_val: Tensor,
+        q: Tensor,
+        k_cache: Tensor,
+        v_cache: Tensor,
+        cu_seqlens_q: Tensor,
+        seq_lens_k: Tensor,
+        block_tables: Tensor,
+        scale: float,
+    ):
+        """self_attention_varlen over block pools: sequence b has seq_lens_k[b] keys in the blocks
+        listed by block_tables[b] (I32 [batch, max_blocks])."""
+        LIB_LLAISYS.llaisysSelfAttentionPagedVarlen(
+            attn_val.lib_tensor(),
+            q.lib_tensor(),
+            k_cache.lib_tensor(),
+            v_cache.lib_tensor(),
+            cu_seqlens_q.lib_tensor(),
+            seq_lens_k.lib_tensor(),
+            block_tables.lib_tensor(),
+            c_float(scale),
+        )
+
     @staticmethod
     def swiglu(out: Tensor, gate: Tensor, up: Tensor):
         LIB_LLAISYS.llaisysSwiGLU(out.lib_tensor(), gate.lib_tensor(), up.lib_tensor())
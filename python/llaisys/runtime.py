@@ -66,3 +66,12 @@ class RuntimeAPI:
         self._api.contents.memcpy_async(
             dst, src, size, libllaisys.llaisysMemcpyKind_t(kind), stream
         )
+
+
+def set_precision(precision: libllaisys.Precision) -> None:
+    """Precision policy for linear over BF16 weights, for ops issued from the calling thread."""
+    LIB_LLAISYS.llaisysSetPrecision(libllaisys.llaisysPrecision_t(precision))
+
+
+def get_precision() -> libllaisys.Precision:
+    return libllaisys.Precision(LIB_LLAISYS.llaisysGetPrecision())
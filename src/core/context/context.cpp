@@ -70,6 +70,15 @@ Runtime &Context::runtime() {
     return *_current_runtime;
 }
 
+llaisysPrecision_t Context::precision() const {
+    return _precision;
+}
+
+void Context::setPrecision(llaisysPrecision_t precision) {
+    CHECK_ARGUMENT(precision == LLAISYS_PRECISION_F32 || precision == LLAISYS_PRECISION_BF16_DOT, "invalid precision policy");
+    _precision = precision;
+}
+
 // Global API to get thread-local context.
 Context &context() {
     thread_local Context thread_context;
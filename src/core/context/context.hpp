@@ -14,6 +14,7 @@ class Context {
 private:
     std::unordered_map<llaisysDeviceType_t, std::vector<Runtime *>> _runtime_map;
     Runtime *_current_runtime;
+    llaisysPrecision_t _precision = LLAISYS_PRECISION_F32;
     Context();
 
 public:
@@ -30,6 +31,10 @@ public:
     void setDevice(llaisysDeviceType_t device_type, int device_id);
     Runtime &runtime();
 
+    // Precision policy for the ops this thread issues (see llaisysPrecision_t).
+    llaisysPrecision_t precision() const;
+    void setPrecision(llaisysPrecision_t precision);
+
     friend Context &context();
 };
 } // namespace llaisys::core
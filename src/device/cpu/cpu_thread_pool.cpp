@@ -0,0 +1,125 @@
+#include "cpu_thread_pool.hpp"
+
+#include <cstdlib>
+#include <string>
+
+namespace llaisys::device::cpu {
+namespace {
+thread_local bool in_parallel_region = false;
+
+// Workers spin this many rounds before sleeping, so back-to-back kernels
+// (e.g. the projections of one decode step) do not pay a wake-up each.
+constexpr size_t SPIN_ROUNDS = 20000;
+} // namespace
+
+ThreadPool::ThreadPool(size_t nthreads)
+    : _fn(nullptr), _ntask(0), _next(0), _generation(0), _pending(0), _stop(false) {
+    for (size_t i = 1; i < nthreads; ++i) {
+        _workers.emplace_back([this] { _workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+        _generation.fetch_add(1);
+    }
+    _wake_cv.notify_all();
+    for (auto &worker : _workers) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::size() const {
+    return _workers.size() + 1;
+}
+
+void ThreadPool::_work() {
+    in_parallel_region = true;
+    for (size_t i = _next.fetch_add(1); i < _ntask; i = _next.fetch_add(1)) {
+        try {
+            (*_fn)(i);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_error) {
+                _error = std::current_exception();
+            }
+        }
+    }
+    in_parallel_region = false;
+}
+
+void ThreadPool::_workerLoop() {
+    size_t seen = 0;
+    while (true) {
+        for (size_t spin = 0; spin < SPIN_ROUNDS && _generation.load() == seen; ++spin) {
+            std::this_thread::yield();
+        }
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake_cv.wait(lock, [&] { return _generation.load() != seen; });
+            seen = _generation.load();
+            if (_stop) {
+                return;
+            }
+        }
+        _work();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (--_pending == 0) {
+                _done_cv.notify_one();
+            }
+        }
+    }
+}
+
+void ThreadPool::run(size_t ntask, const std::function<void(size_t)> &fn) {
+    if (ntask == 0) {
+        return;
+    }
+    std::unique_lock<std::mutex> run_lock(_run_mutex, std::defer_lock);
+    if (ntask == 1 || _workers.empty() || in_parallel_region || !run_lock.try_lock()) {
+        for (size_t i = 0; i < ntask; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _fn = &fn;
+        _ntask = ntask;
+        _next.store(0);
+        _pending = _workers.size();
+        _error = nullptr;
+        _generation.fetch_add(1);
+    }
+    _wake_cv.notify_all();
+
+    _work();
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done_cv.wait(lock, [&] { return _pending == 0; });
+        _fn = nullptr;
+        error = _error;
+        _error = nullptr;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+ThreadPool &threadPool() {
+    static ThreadPool pool([] {
+        size_t n = std::thread::hardware_concurrency();
+        if (const char *env = std::getenv("LLAISYS_NUM_THREADS")) {
+            n = std::strtoul(env, nullptr, 10);
+        }
+        return n == 0 ? size_t(1) : n;
+    }());
+    return pool;
+}
+} // namespace llaisys::device::cpu
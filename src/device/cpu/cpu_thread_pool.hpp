@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace llaisys::device::cpu {
+// Fixed-size pool of worker threads used by the CPU kernels.
+//
+// `run(ntask, fn)` calls fn(i) for every i in [0, ntask) and returns once all
+// of them are done. Tasks are handed out dynamically from a shared counter, so
+// uneven tasks balance themselves. The calling thread works too. Calls made
+// from inside a task, or while another thread owns the pool, run serially
+// instead of deadlocking.
+class ThreadPool {
+private:
+    std::vector<std::thread> _workers;
+
+    std::mutex _run_mutex; // one parallel region at a time
+    std::mutex _mutex;
+    std::condition_variable _wake_cv;
+    std::condition_variable _done_cv;
+
+    const std::function<void(size_t)> *_fn;
+    size_t _ntask;
+    std::atomic<size_t> _next;
+    std::atomic<size_t> _generation;
+    size_t _pending;
+    bool _stop;
+    std::exception_ptr _error;
+
+    void _work();
+    void _workerLoop();
+
+public:
+    explicit ThreadPool(size_t nthreads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Number of threads that execute tasks, including the caller.
+    size_t size() const;
+
+    void run(size_t ntask, const std::function<void(size_t)> &fn);
+};
+
+// Process-wide pool. Sized from the LLAISYS_NUM_THREADS environment variable,
+// or the number of hardware threads when it is not set.
+ThreadPool &threadPool();
+
+// Splits [begin, end) into at most threadPool().size() contiguous ranges of at
+// least `grain` items and calls fn(lo, hi) on each of them in parallel.
+template <typename F>
+void parallelFor(size_t begin, size_t end, size_t grain, F &&fn) {
+    if (end <= begin) {
+        return;
+    }
+    size_t total = end - begin;
+    grain = grain == 0 ? 1 : grain;
+    size_t nchunk = std::min(threadPool().size(), (total + grain - 1) / grain);
+    if (nchunk <= 1) {
+        fn(begin, end);
+        return;
+    }
+    size_t chunk = (total + nchunk - 1) / nchunk;
+    threadPool().run(nchunk, [&](size_t i) {
+        size_t lo = begin + i * chunk;
+        size_t hi = std::min(end, lo + chunk);
+        if (lo < hi) {
+            fn(lo, hi);
+        }
+    });
+}
+} // namespace llaisys::device::cpu
@@ -0,0 +1,308 @@
+#include "paged_kv_cache.hpp"
+
+#include "../ops/rope/op.hpp"
+#include "../ops/self_attention/cpu/self_attention_cpu.hpp"
+#include "../ops/self_attention/op.hpp"
+#include "../utils.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace llaisys::kv_cache {
+BlockAllocator::BlockAllocator(size_t num_blocks) : _refs(num_blocks, 0) {
+    CHECK_ARGUMENT(num_blocks <= static_cast<size_t>(INT32_MAX), "BlockAllocator: too many blocks.");
+    _free.reserve(num_blocks);
+    // popped from the back: block 0 goes first
+    for (size_t b = num_blocks; b-- > 0;) {
+        _free.push_back(static_cast<int32_t>(b));
+    }
+}
+
+size_t BlockAllocator::numBlocks() const {
+    return _refs.size();
+}
+
+size_t BlockAllocator::numFree() const {
+    return _free.size();
+}
+
+int32_t BlockAllocator::allocate() {
+    if (_free.empty()) {
+        throw std::runtime_error("BlockAllocator: out of KV cache blocks");
+    }
+    const int32_t block = _free.back();
+    _free.pop_back();
+    _refs[block] = 1;
+    return block;
+}
+
+void BlockAllocator::retain(int32_t block) {
+    CHECK_ARGUMENT(block >= 0 && static_cast<size_t>(block) < _refs.size() && _refs[block] > 0,
+                   "BlockAllocator: retain of a free block.");
+    ++_refs[block];
+}
+
+void BlockAllocator::release(int32_t block) {
+    CHECK_ARGUMENT(block >= 0 && static_cast<size_t>(block) < _refs.size() && _refs[block] > 0,
+                   "BlockAllocator: release of a free block.");
+    if (--_refs[block] == 0) {
+        _free.push_back(block);
+    }
+}
+
+uint32_t BlockAllocator::refs(int32_t block) const {
+    CHECK_ARGUMENT(block >= 0 && static_cast<size_t>(block) < _refs.size(), "BlockAllocator: block id out of range.");
+    return _refs[block];
+}
+
+PagedKVCache::PagedKVCache(llaisysDataType_t dtype, llaisysDataType_t kv_dtype, size_t nlayer, size_t nkvh, size_t dh,
+                           size_t block_size, size_t num_blocks,
+                           llaisysDeviceType_t device_type, int device_id)
+    : _dtype(dtype), _kv_dtype(kv_dtype), _nlayer(nlayer), _nkvh(nkvh), _dh(dh), _block_size(block_size),
+      _device_type(device_type), _device_id(device_id), _blocks(num_blocks) {
+    CHECK_ARGUMENT(nlayer > 0 && nkvh > 0 && dh > 0 && block_size > 0 && num_blocks > 0,
+                   "PagedKVCache: all sizes must be positive.");
+    CHECK_ARGUMENT(kv_dtype == dtype || kv_dtype == LLAISYS_DTYPE_I8 || kv_dtype == LLAISYS_DTYPE_F8,
+                   "PagedKVCache: K/V are stored in the model type, I8 or F8.");
+    const auto pool = [&]() {
+        tensor_t codes = Tensor::create({num_blocks, block_size, nkvh, dh}, kv_dtype, device_type, device_id);
+        if (!isQuantized()) {
+            return codes;
+        }
+        ASSERT(device_type == LLAISYS_DEVICE_CPU, "PagedKVCache: quantized caches are CPU only.");
+        TensorQuant quant;
+        quant.scheme = QuantScheme::ROW_SCALE;
+        quant.scales = Tensor::create({num_blocks, block_size, nkvh}, LLAISYS_DTYPE_F32, device_type, device_id);
+        return codes->withQuant(std::move(quant));
+    };
+    _k.reserve(nlayer);
+    _v.reserve(nlayer);
+    for (size_t l = 0; l < nlayer; ++l) {
+        _k.push_back(pool());
+        _v.push_back(pool());
+    }
+}
+
+llaisysDataType_t PagedKVCache::dtype() const {
+    return _dtype;
+}
+
+llaisysDataType_t PagedKVCache::kvDtype() const {
+    return _kv_dtype;
+}
+
+bool PagedKVCache::isQuantized() const {
+    return _kv_dtype != _dtype;
+}
+
+size_t PagedKVCache::blockSize() const {
+    return _block_size;
+}
+
+size_t PagedKVCache::numBlocks() const {
+    return _blocks.numBlocks();
+}
+
+size_t PagedKVCache::numFreeBlocks() const {
+    return _blocks.numFree();
+}
+
+tensor_t PagedKVCache::keys(size_t layer) const {
+    CHECK_ARGUMENT(layer < _nlayer, "PagedKVCache: layer out of range.");
+    return _k[layer];
+}
+
+tensor_t PagedKVCache::values(size_t layer) const {
+    CHECK_ARGUMENT(layer < _nlayer, "PagedKVCache: layer out of range.");
+    return _v[layer];
+}
+
+BlockAllocator &PagedKVCache::blocks() {
+    return _blocks;
+}
+
+const BlockAllocator &PagedKVCache::blocks() const {
+    return _blocks;
+}
+
+PagedKVCache::Sequence &PagedKVCache::sequence(int64_t seq) {
+    auto it = _seqs.find(seq);
+    CHECK_ARGUMENT(it != _seqs.end(), "PagedKVCache: unknown sequence.");
+    return it->second;
+}
+
+const PagedKVCache::Sequence &PagedKVCache::sequence(int64_t seq) const {
+    auto it = _seqs.find(seq);
+    CHECK_ARGUMENT(it != _seqs.end(), "PagedKVCache: unknown sequence.");
+    return it->second;
+}
+
+int64_t PagedKVCache::addSequence() {
+    const int64_t seq = _next_seq++;
+    _seqs.emplace(seq, Sequence{});
+    return seq;
+}
+
+int64_t PagedKVCache::addSequence(const std::vector<int32_t> &prefix) {
+    const int64_t seq = addSequence();
+    Sequence &s = _seqs.at(seq);
+    for (int32_t b : prefix) {
+        _blocks.retain(b);
+    }
+    s.blocks = prefix;
+    s.length = prefix.size() * _block_size;
+    return seq;
+}
+
+int64_t PagedKVCache::addStreamingSequence(size_t sink, size_t window, float theta) {
+    CHECK_ARGUMENT(window > 0 && sink % _block_size == 0 && window % _block_size == 0,
+                   "PagedKVCache: sink and window must be multiples of the block size.");
+    CHECK_ARGUMENT(!isQuantized(), "PagedKVCache: streaming re-bases keys and needs an unquantized cache.");
+    const int64_t seq = addSequence();
+    Sequence &s = _seqs.at(seq);
+    s.sink = sink;
+    s.window = window;
+    s.theta = theta;
+    return seq;
+}
+
+void PagedKVCache::removeSequence(int64_t seq) {
+    Sequence &s = sequence(seq);
+    for (int32_t b : s.blocks) {
+        _blocks.release(b);
+    }
+    _seqs.erase(seq);
+}
+
+size_t PagedKVCache::length(int64_t seq) const {
+    return sequence(seq).length;
+}
+
+size_t PagedKVCache::evicted(int64_t seq) const {
+    return sequence(seq).evicted;
+}
+
+const std::vector<int32_t> &PagedKVCache::blockIds(int64_t seq) const {
+    return sequence(seq).blocks;
+}
+
+tensor_t PagedKVCache::blockTable(int64_t seq) {
+    Sequence &s = sequence(seq);
+    if (!s.table || s.table->shape()[0] != s.blocks.size()) {
+        s.table = Tensor::create({s.blocks.size()}, LLAISYS_DTYPE_I32);
+        s.table->load(s.blocks.data());
+    }
+    return s.table;
+}
+
+void PagedKVCache::evict(Sequence &s, size_t ntoken) {
+    // whole blocks, unless the whole window (ending in a partial block) goes
+    const size_t first = s.sink / _block_size;
+    const size_t nblock = (ntoken + _block_size - 1) / _block_size;
+    for (size_t i = first; i < first + nblock; ++i) {
+        _blocks.release(s.blocks[i]);
+    }
+    s.blocks.erase(s.blocks.begin() + first, s.blocks.begin() + first + nblock);
+    s.table = nullptr;
+    s.length -= ntoken;
+    s.evicted += ntoken;
+
+    // the window keys now sit ntoken positions earlier
+    for (size_t layer = 0; layer < _nlayer; ++layer) {
+        for (size_t p = s.sink; p < s.length; p += _block_size) {
+            const size_t b = s.blocks[p / _block_size];
+            tensor_t keys = _k[layer]->slice(0, b, b + 1)->view({_block_size, _nkvh, _dh});
+            keys = keys->slice(0, 0, std::min(_block_size, s.length - p));
+            ops::rope_shift(keys, keys, -static_cast<int64_t>(ntoken), s.theta);
+        }
+    }
+}
+
+size_t PagedKVCache::extend(int64_t seq, size_t ntoken) {
+    Sequence &s = sequence(seq);
+    if (s.window > 0) {
+        CHECK_ARGUMENT(ntoken <= s.window, "PagedKVCache: a streaming step adds at most window tokens.");
+        if (s.length + ntoken > s.sink + s.window) {
+            const size_t over = s.length + ntoken - s.sink - s.window;
+            evict(s, std::min((over + _block_size - 1) / _block_size * _block_size, s.length - s.sink));
+        }
+    }
+    const size_t pos = s.length;
+    const size_t need = (pos + ntoken + _block_size - 1) / _block_size;
+    if (need > s.blocks.size() + _blocks.numFree()) {
+        throw std::runtime_error("PagedKVCache: out of KV cache blocks");
+    }
+    while (s.blocks.size() < need) {
+        s.blocks.push_back(_blocks.allocate());
+    }
+    s.length += ntoken;
+    return pos;
+}
+
+void PagedKVCache::truncate(int64_t seq, size_t length) {
+    Sequence &s = sequence(seq);
+    CHECK_ARGUMENT(length <= s.length, "PagedKVCache: truncate past the sequence length.");
+    const size_t keep = (length + _block_size - 1) / _block_size;
+    for (size_t i = keep; i < s.blocks.size(); ++i) {
+        _blocks.release(s.blocks[i]);
+    }
+    s.blocks.resize(keep);
+    s.table = nullptr;
+    s.length = length;
+}
+
+void PagedKVCache::store(int64_t seq, size_t layer, size_t pos, tensor_t k, tensor_t v) {
+    const Sequence &s = sequence(seq);
+    CHECK_ARGUMENT(layer < _nlayer, "PagedKVCache: layer out of range.");
+    CHECK_SAME_DEVICE(_k[layer], k, v);
+    CHECK_SAME_DTYPE(_dtype, k->dtype(), v->dtype());
+    CHECK_SAME_SHAPE(k->shape(), v->shape());
+    CHECK_ARGUMENT(k->ndim() == 3 && k->shape()[1] == _nkvh && k->shape()[2] == _dh,
+                   "PagedKVCache: k and v must be [n, nkvh, dh].");
+    // rows may be strided, e.g. K/V heads sliced out of a fused QKV output
+    for (const auto &t : {k, v}) {
+        ASSERT(t->strides()[2] == 1 && t->strides()[1] == static_cast<ptrdiff_t>(_dh),
+               "PagedKVCache: the heads of each k and v row must be contiguous.");
+    }
+    const size_t n = k->shape()[0];
+    CHECK_ARGUMENT(pos + n <= s.length, "PagedKVCache: store past the sequence length; extend first.");
+
+    core::context().setDevice(_device_type, _device_id);
+    const auto *api = core::context().runtime().api();
+    const size_t row = _nkvh * _dh * k->elementSize();
+    const size_t pool_row = _nkvh * _dh * utils::dsize(_kv_dtype);
+    const size_t k_stride = k->strides()[0] * k->elementSize(), v_stride = v->strides()[0] * v->elementSize();
+    // tokens of one block are contiguous in the pool, and in the source unless strided
+    const auto copy = [&](const tensor_t &pool, const tensor_t &src, size_t stride, size_t slot, size_t t, size_t run) {
+        const size_t nrun = stride == row ? 1 : run;
+        const size_t ntok = stride == row ? run : 1;
+        for (size_t i = 0; i < nrun; ++i) {
+            std::byte *dst = pool->data() + (slot + i) * pool_row;
+            const std::byte *from = src->data() + (t + i) * stride;
+            if (isQuantized()) {
+                float *scales = reinterpret_cast<float *>(pool->quant().scales->data());
+                ops::cpu::quantize_kv_rows(dst, scales + (slot + i) * _nkvh, from, _dtype, _kv_dtype, ntok * _nkvh, _dh);
+            } else {
+                api->memcpy_sync(dst, from, ntok * row, LLAISYS_MEMCPY_D2D);
+            }
+        }
+    };
+    for (size_t t = 0; t < n;) {
+        const size_t p = pos + t;
+        const size_t run = std::min(n - t, _block_size - p % _block_size);
+        // pool row index of position p
+        const int32_t block = s.blocks[p / _block_size];
+        CHECK_ARGUMENT(_blocks.refs(block) == 1, "PagedKVCache: store into a shared block.");
+        const size_t slot = block * _block_size + p % _block_size;
+        copy(_k[layer], k, k_stride, slot, t, run);
+        copy(_v[layer], v, v_stride, slot, t, run);
+        t += run;
+    }
+}
+
+void PagedKVCache::attention(int64_t seq, size_t layer, tensor_t attn_val, tensor_t q, float scale) {
+    CHECK_ARGUMENT(layer < _nlayer, "PagedKVCache: layer out of range.");
+    const size_t len = length(seq);
+    ops::self_attention_paged(attn_val, q, _k[layer], _v[layer], blockTable(seq), len, scale);
+}
+} // namespace llaisys::kv_cache
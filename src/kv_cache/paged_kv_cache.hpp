@@ -0,0 +1,140 @@
+#pragma once
+
+#include "../tensor/tensor.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace llaisys::kv_cache {
+// Fixed-size KV blocks handed out from a LIFO free list. Blocks are reference
+// counted so that several sequences can share one (e.g. a common prompt
+// prefix); a block returns to the free list when its last reference goes.
+class BlockAllocator {
+private:
+    std::vector<int32_t> _free;
+    std::vector<uint32_t> _refs;
+
+public:
+    explicit BlockAllocator(size_t num_blocks);
+
+    size_t numBlocks() const;
+    size_t numFree() const;
+
+    // A block with one reference. Throws when the pool is exhausted.
+    int32_t allocate();
+    void retain(int32_t block);
+    void release(int32_t block);
+    uint32_t refs(int32_t block) const;
+};
+
+// KV cache whose memory is a pool of blocks of `block_size` tokens shared by
+// all sequences, instead of one [maxseq, nkvh, dh] buffer per sequence. Each
+// layer owns a K and a V pool tensor [num_blocks, block_size, nkvh, dh]; a
+// sequence is a block table mapping its token positions to pool blocks, grown
+// one block at a time as tokens arrive.
+//
+// The pools are allocated once but never written before a block is handed
+// out, so host pages are committed by the OS as blocks are first used, and the
+// LIFO free list hands recently released (already resident) blocks out first.
+//
+// K/V are stored in `dtype` (that of k, v and q) or, with kv_dtype I8 or F8,
+// as codes with one F32 scale per token and head (QuantScheme::ROW_SCALE):
+// store() quantizes and attention() dequantizes on the fly, halving the cache
+// of a 16-bit model at the cost of a scale per dh elements.
+//
+// A streaming sequence (addStreamingSequence) keeps its first `sink` tokens
+// plus a sliding window of the most recent ones, so a session of any length
+// runs in constant memory and per-token time. When extend() would overflow
+// sink + window tokens, the oldest window blocks are dropped from the block
+// table and returned to the pool, where the next blocks of the sequence come
+// from, so the table acts as a ring over at most (sink + window) / block_size
+// + 1 blocks. Positions stay those within the cache: the surviving window keys
+// are re-based by ops::rope_shift, and extend() returns the position the new
+// tokens must be rotated (and stored) at. Keys must therefore be stored after
+// RoPE with the model's theta.
+//
+// Usage per step: pos = extend(seq, n); for each layer, store(seq, layer, pos,
+// k, v) then attention(seq, layer, out, q, scale) over all length(seq) tokens.
+class PagedKVCache {
+private:
+    struct Sequence {
+        std::vector<int32_t> blocks;
+        size_t length = 0;
+        tensor_t table; // blocks as an I32 tensor, rebuilt when blocks change
+        // streaming: tokens kept at the front and in the window (0: unbounded),
+        // the RoPE base keys are re-based with, and tokens dropped so far
+        size_t sink = 0, window = 0;
+        float theta = 0.0f;
+        size_t evicted = 0;
+    };
+
+    llaisysDataType_t _dtype, _kv_dtype;
+    size_t _nlayer, _nkvh, _dh, _block_size;
+    llaisysDeviceType_t _device_type;
+    int _device_id;
+    std::vector<tensor_t> _k, _v;
+    BlockAllocator _blocks;
+    std::unordered_map<int64_t, Sequence> _seqs;
+    int64_t _next_seq = 0;
+
+    Sequence &sequence(int64_t seq);
+    const Sequence &sequence(int64_t seq) const;
+    // Drops window tokens [sink, sink + ntoken) and re-bases the rest.
+    void evict(Sequence &s, size_t ntoken);
+
+public:
+    PagedKVCache(llaisysDataType_t dtype, llaisysDataType_t kv_dtype, size_t nlayer, size_t nkvh, size_t dh,
+                 size_t block_size, size_t num_blocks,
+                 llaisysDeviceType_t device_type = LLAISYS_DEVICE_CPU, int device_id = 0);
+
+    llaisysDataType_t dtype() const;
+    llaisysDataType_t kvDtype() const;
+    bool isQuantized() const;
+    size_t blockSize() const;
+    size_t numBlocks() const;
+    size_t numFreeBlocks() const;
+    // pools tagged with their scales when quantized
+    tensor_t keys(size_t layer) const;
+    tensor_t values(size_t layer) const;
+    BlockAllocator &blocks();
+    const BlockAllocator &blocks() const;
+
+    // A new, empty sequence.
+    int64_t addSequence();
+    // A new sequence whose first prefix.size() * block_size tokens are the
+    // (retained, read-only) blocks `prefix`, e.g. a prompt prefix held by
+    // another sequence or a PrefixCache. Its own tokens start past them.
+    int64_t addSequence(const std::vector<int32_t> &prefix);
+    // A new sequence keeping its first `sink` tokens and the last `window` or
+    // fewer (both multiples of the block size, window > 0), its keys rotated
+    // with RoPE base `theta`. Unquantized caches only.
+    int64_t addStreamingSequence(size_t sink, size_t window, float theta);
+    // Releases the sequence and its blocks.
+    void removeSequence(int64_t seq);
+    // Tokens in the cache; for a streaming sequence at most sink + window.
+    size_t length(int64_t seq) const;
+    // Tokens a streaming sequence has dropped: its next token is the
+    // evicted(seq) + length(seq)-th of the session.
+    size_t evicted(int64_t seq) const;
+    const std::vector<int32_t> &blockIds(int64_t seq) const;
+    tensor_t blockTable(int64_t seq);
+
+    // Grows the sequence by `ntoken` positions, allocating blocks as needed,
+    // and returns the first new position. A streaming sequence first evicts
+    // whole window blocks to make room (ntoken <= window). On pool exhaustion
+    // the call throws.
+    size_t extend(int64_t seq, size_t ntoken);
+    // Rolls the sequence back to its first `length` tokens, e.g. dropping
+    // rejected speculative tokens, and releases the blocks past them. Tokens a
+    // streaming sequence evicted stay dropped.
+    void truncate(int64_t seq, size_t length);
+    // Writes k, v [n, nkvh, dh] (each row's heads contiguous, rows may be
+    // strided) at positions [pos, pos + n) of `layer`, which must not fall in
+    // a block shared with another owner.
+    void store(int64_t seq, size_t layer, size_t pos, tensor_t k, tensor_t v);
+    // Causal self_attention of q [seqlen, nh, dh] over the sequence's
+    // length(seq) tokens in `layer`, the queries being the last seqlen.
+    void attention(int64_t seq, size_t layer, tensor_t attn_val, tensor_t q, float scale);
+};
+} // namespace llaisys::kv_cache
@@ -0,0 +1,196 @@
+#include "prefix_cache.hpp"
+
+#include "../utils.hpp"
+
+#include <algorithm>
+
+namespace llaisys::kv_cache {
+namespace {
+std::vector<int64_t> first_block(const int64_t *tokens, size_t block_size) {
+    return std::vector<int64_t>(tokens, tokens + block_size);
+}
+} // namespace
+
+PrefixCache::PrefixCache(PagedKVCache &cache) : _cache(cache) {}
+
+PrefixCache::~PrefixCache() {
+    // the tree's references go back to the pool
+    std::vector<Node *> stack{&_root};
+    while (!stack.empty()) {
+        Node *node = stack.back();
+        stack.pop_back();
+        for (int32_t b : node->blocks) {
+            _cache.blocks().release(b);
+        }
+        for (auto &[key, child] : node->children) {
+            stack.push_back(child.get());
+        }
+    }
+}
+
+PagedKVCache &PrefixCache::cache() {
+    return _cache;
+}
+
+size_t PrefixCache::numBlocks() const {
+    return _nblocks;
+}
+
+size_t PrefixCache::numEvictable() const {
+    // a block another sequence holds keeps every block before it, so the
+    // tree-only blocks are exactly those evict() reaches leaf by leaf
+    const BlockAllocator &alloc = _cache.blocks();
+    size_t n = 0;
+    std::vector<const Node *> stack(1, &_root);
+    while (!stack.empty()) {
+        const Node *node = stack.back();
+        stack.pop_back();
+        for (const auto &[key, child] : node->children) {
+            stack.push_back(child.get());
+        }
+        n += std::count_if(node->blocks.begin(), node->blocks.end(), [&](int32_t b) { return alloc.refs(b) == 1; });
+    }
+    return n;
+}
+
+PrefixCache::Node *PrefixCache::split(Node *node, size_t nblock) {
+    const size_t bs = _cache.blockSize();
+    auto mid = std::make_unique<Node>();
+    mid->tokens.assign(node->tokens.begin(), node->tokens.begin() + nblock * bs);
+    mid->blocks.assign(node->blocks.begin(), node->blocks.begin() + nblock);
+    mid->parent = node->parent;
+    mid->last_use = node->last_use;
+    node->tokens.erase(node->tokens.begin(), node->tokens.begin() + nblock * bs);
+    node->blocks.erase(node->blocks.begin(), node->blocks.begin() + nblock);
+
+    // mid takes node's place under the parent (same first block) and adopts it
+    auto &slot = node->parent->children[first_block(mid->tokens.data(), bs)];
+    Node *m = mid.get();
+    node->parent = m;
+    m->children.emplace(first_block(node->tokens.data(), bs), std::move(slot));
+    slot = std::move(mid);
+    return m;
+}
+
+PrefixCache::Node *PrefixCache::walk(const int64_t *tokens, size_t n, std::vector<int32_t> &blocks, size_t &matched) {
+    const size_t bs = _cache.blockSize();
+    const uint64_t now = ++_clock;
+    Node *node = &_root;
+    matched = 0;
+    size_t i = 0;
+    while (i + bs <= n) {
+        auto it = node->children.find(first_block(tokens + i, bs));
+        if (it == node->children.end()) {
+            break;
+        }
+        // the first block matches by construction
+        Node *child = it->second.get();
+        size_t k = 0;
+        while (k < child->blocks.size() && i + bs <= n
+               && std::equal(tokens + i, tokens + i + bs, child->tokens.begin() + k * bs)) {
+            blocks.push_back(child->blocks[k]);
+            ++k;
+            i += bs;
+        }
+        child->last_use = now;
+        node = child;
+        matched = k;
+        if (k < child->blocks.size()) {
+            break;
+        }
+    }
+    return node;
+}
+
+std::vector<int32_t> PrefixCache::match(const int64_t *tokens, size_t n) {
+    std::vector<int32_t> blocks;
+    size_t matched;
+    walk(tokens, n, blocks, matched);
+    return blocks;
+}
+
+int64_t PrefixCache::addSequence(const int64_t *tokens, size_t n, size_t &cached) {
+    const std::vector<int32_t> prefix = match(tokens, n > 0 ? n - 1 : 0);
+    cached = prefix.size() * _cache.blockSize();
+    return _cache.addSequence(prefix);
+}
+
+void PrefixCache::commit(int64_t seq, const int64_t *tokens, size_t n) {
+    const size_t bs = _cache.blockSize();
+    CHECK_ARGUMENT(n <= _cache.length(seq) && _cache.evicted(seq) == 0,
+                   "PrefixCache: commit beyond the tokens the sequence holds.");
+    const std::vector<int32_t> &ids = _cache.blockIds(seq);
+    const size_t nfull = n / bs;
+
+    std::vector<int32_t> blocks;
+    size_t matched;
+    Node *node = walk(tokens, nfull * bs, blocks, matched);
+    const size_t have = blocks.size();
+    if (have == nfull) {
+        return;
+    }
+    if (matched < node->blocks.size()) {
+        node = split(node, matched);
+    }
+    // the rest becomes a new leaf holding the sequence's own blocks
+    auto leaf = std::make_unique<Node>();
+    leaf->tokens.assign(tokens + have * bs, tokens + nfull * bs);
+    leaf->blocks.assign(ids.begin() + have, ids.begin() + nfull);
+    leaf->parent = node;
+    leaf->last_use = _clock;
+    for (int32_t b : leaf->blocks) {
+        _cache.blocks().retain(b);
+    }
+    _nblocks += leaf->blocks.size();
+    node->children.emplace(first_block(leaf->tokens.data(), bs), std::move(leaf));
+}
+
+size_t PrefixCache::extend(int64_t seq, size_t ntoken) {
+    const size_t bs = _cache.blockSize();
+    const size_t need = (_cache.length(seq) + ntoken + bs - 1) / bs;
+    const size_t have = _cache.blockIds(seq).size();
+    if (need > have) {
+        evict(need - have);
+    }
+    return _cache.extend(seq, ntoken);
+}
+
+size_t PrefixCache::evict(size_t nblocks) {
+    BlockAllocator &alloc = _cache.blocks();
+    const size_t bs = _cache.blockSize();
+    size_t freed = 0;
+    std::vector<Node *> stack;
+    while (alloc.numFree() < nblocks) {
+        // the least recently used leaf whose last block only the tree holds;
+        // a sequence sharing a block shares every block before it
+        Node *lru = nullptr;
+        stack.assign(1, &_root);
+        while (!stack.empty()) {
+            Node *node = stack.back();
+            stack.pop_back();
+            for (auto &[key, child] : node->children) {
+                stack.push_back(child.get());
+            }
+            if (node != &_root && node->children.empty() && alloc.refs(node->blocks.back()) == 1
+                && (!lru || node->last_use < lru->last_use)) {
+                lru = node;
+            }
+        }
+        if (!lru) {
+            break;
+        }
+        std::vector<int64_t> key = first_block(lru->tokens.data(), bs);
+        while (!lru->blocks.empty() && alloc.numFree() < nblocks && alloc.refs(lru->blocks.back()) == 1) {
+            alloc.release(lru->blocks.back());
+            lru->blocks.pop_back();
+            lru->tokens.resize(lru->blocks.size() * bs);
+            --_nblocks;
+            ++freed;
+        }
+        if (lru->blocks.empty()) {
+            lru->parent->children.erase(key);
+        }
+    }
+    return freed;
+}
+} // namespace llaisys::kv_cache
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "paged_kv_cache.hpp"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace llaisys::kv_cache {
+// Cache of prompt prefixes over the blocks of a PagedKVCache, so requests
+// sharing a system prompt or chat template prefill only what follows it.
+//
+// A radix tree keyed by token ids: each edge holds whole blocks, i.e. a
+// multiple of block_size tokens and one pool block per block_size of them,
+// and a node's path from the root spells the tokens its blocks hold K/V for.
+// The tree keeps one reference on each of its blocks, so they outlive the
+// sequences that computed them and can be shared read-only by new ones.
+//
+// When the pool runs out, extend() evicts the least recently used leaves
+// (their last blocks first) among those no live sequence still references.
+//
+// Usage per request: seq = addSequence(tokens, n, cached); prefill tokens
+// [cached, n) through extend/store/attention as usual; commit(seq, tokens, n)
+// once every layer is stored, publishing the sequence's full blocks.
+class PrefixCache {
+private:
+    struct Node {
+        std::vector<int64_t> tokens; // edge label, blocks.size() * block_size of them
+        std::vector<int32_t> blocks;
+        std::map<std::vector<int64_t>, std::unique_ptr<Node>> children; // by first block of tokens
+        Node *parent = nullptr;
+        uint64_t last_use = 0;
+    };
+
+    PagedKVCache &_cache;
+    Node _root;
+    uint64_t _clock = 0;
+    size_t _nblocks = 0;
+
+    // Splits `node` after its first `nblock` blocks and returns the new parent.
+    Node *split(Node *node, size_t nblock);
+    // Walks the longest whole-block prefix of tokens[0, n) in the tree,
+    // appending its blocks. Returns the deepest node reached and, in
+    // `matched`, the blocks matched in that node's edge.
+    Node *walk(const int64_t *tokens, size_t n, std::vector<int32_t> &blocks, size_t &matched);
+
+public:
+    explicit PrefixCache(PagedKVCache &cache);
+    ~PrefixCache();
+    PrefixCache(const PrefixCache &) = delete;
+    PrefixCache &operator=(const PrefixCache &) = delete;
+
+    PagedKVCache &cache();
+    // Blocks held by the tree.
+    size_t numBlocks() const;
+    // Blocks held by the tree alone, i.e. those evict() can free.
+    size_t numEvictable() const;
+
+    // Blocks holding the longest cached whole-block prefix of tokens[0, n).
+    std::vector<int32_t> match(const int64_t *tokens, size_t n);
+    // A new sequence starting on the longest cached prefix of tokens[0, n),
+    // leaving at least the last token to prefill (its logits are needed).
+    // `cached` receives the number of tokens already in the cache.
+    int64_t addSequence(const int64_t *tokens, size_t n, size_t &cached);
+    // Publishes the full blocks of `seq` holding tokens[0, n).
+    void commit(int64_t seq, const int64_t *tokens, size_t n);
+    // PagedKVCache::extend, evicting cached prefixes first if the pool is short.
+    size_t extend(int64_t seq, size_t ntoken);
+    // Evicts least recently used blocks no sequence uses until `nblocks` are
+    // free in the pool or nothing is left to evict. Returns the blocks freed.
+    size_t evict(size_t nblocks);
+};
+} // namespace llaisys::kv_cache
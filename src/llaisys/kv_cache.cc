@@ -0,0 +1,76 @@
+#include "llaisys/kv_cache.h"
+
+#include "llaisys_tensor.hpp"
+
+#include "../kv_cache/prefix_cache.hpp"
+
+__C {
+    struct LlaisysKVCache {
+        llaisys::kv_cache::PagedKVCache cache;
+        llaisys::kv_cache::PrefixCache prefix{cache};
+    };
+
+    llaisysKVCache_t llaisysKVCacheCreate(llaisysDataType_t dtype, llaisysDataType_t kv_dtype,
+                                          size_t nlayer, size_t nkvh, size_t dh,
+                                          size_t block_size, size_t num_blocks,
+                                          llaisysDeviceType_t device, int device_id) {
+        return new LlaisysKVCache{{dtype, kv_dtype, nlayer, nkvh, dh, block_size, num_blocks, device, device_id}};
+    }
+    void llaisysKVCacheDestroy(llaisysKVCache_t cache) {
+        delete cache;
+    }
+    size_t llaisysKVCacheBlockSize(llaisysKVCache_t cache) {
+        return cache->cache.blockSize();
+    }
+    size_t llaisysKVCacheNumFreeBlocks(llaisysKVCache_t cache) {
+        return cache->cache.numFreeBlocks();
+    }
+    llaisysTensor_t llaisysKVCacheKeys(llaisysKVCache_t cache, size_t layer) {
+        return new LlaisysTensor{cache->cache.keys(layer)};
+    }
+    llaisysTensor_t llaisysKVCacheValues(llaisysKVCache_t cache, size_t layer) {
+        return new LlaisysTensor{cache->cache.values(layer)};
+    }
+    int64_t llaisysKVCacheAddSequence(llaisysKVCache_t cache) {
+        return cache->cache.addSequence();
+    }
+    int64_t llaisysKVCacheAddStreamingSequence(llaisysKVCache_t cache, size_t sink, size_t window, float theta) {
+        return cache->cache.addStreamingSequence(sink, window, theta);
+    }
+    int64_t llaisysKVCacheAddSequenceWithPrefix(llaisysKVCache_t cache, const int64_t *token_ids, size_t ntoken,
+                                                size_t *cached) {
+        return cache->prefix.addSequence(token_ids, ntoken, *cached);
+    }
+    void llaisysKVCacheCommitPrefix(llaisysKVCache_t cache, int64_t seq, const int64_t *token_ids, size_t ntoken) {
+        cache->prefix.commit(seq, token_ids, ntoken);
+    }
+    size_t llaisysKVCachePrefixBlocks(llaisysKVCache_t cache) {
+        return cache->prefix.numBlocks();
+    }
+    void llaisysKVCacheRemoveSequence(llaisysKVCache_t cache, int64_t seq) {
+        cache->cache.removeSequence(seq);
+    }
+    size_t llaisysKVCacheLength(llaisysKVCache_t cache, int64_t seq) {
+        return cache->cache.length(seq);
+    }
+    size_t llaisysKVCacheEvicted(llaisysKVCache_t cache, int64_t seq) {
+        return cache->cache.evicted(seq);
+    }
+    llaisysTensor_t llaisysKVCacheBlockTable(llaisysKVCache_t cache, int64_t seq) {
+        return new LlaisysTensor{cache->cache.blockTable(seq)};
+    }
+    size_t llaisysKVCacheExtend(llaisysKVCache_t cache, int64_t seq, size_t ntoken) {
+        return cache->prefix.extend(seq, ntoken);
+    }
+    void llaisysKVCacheTruncate(llaisysKVCache_t cache, int64_t seq, size_t length) {
+        cache->cache.truncate(seq, length);
+    }
+    void llaisysKVCacheStore(llaisysKVCache_t cache, int64_t seq, size_t layer, size_t pos,
+                             llaisysTensor_t k, llaisysTensor_t v) {
+        cache->cache.store(seq, layer, pos, k->tensor, v->tensor);
+    }
+    void llaisysKVCacheAttention(llaisysKVCache_t cache, int64_t seq, size_t layer,
+                                 llaisysTensor_t attn_val, llaisysTensor_t q, float scale) {
+        cache->cache.attention(seq, layer, attn_val->tensor, q->tensor, scale);
+    }
+}
@@ -0,0 +1,64 @@
+#include "llaisys/models/qwen2.h"
+
+#include "../../models/qwen2/scheduler.hpp"
+
+__C {
+    struct LlaisysQwen2Model {
+        llaisys::models::Qwen2Model model;
+        llaisys::models::Qwen2Scheduler scheduler{model};
+    };
+
+    struct LlaisysQwen2Model *llaisysQwen2ModelCreate(const LlaisysQwen2Meta *meta, llaisysDeviceType_t device,
+                                                      int *device_ids, int ndevice) {
+        return new LlaisysQwen2Model{{*meta, device, device_ids && ndevice > 0 ? device_ids[0] : 0}};
+    }
+    void llaisysQwen2ModelDestroy(struct LlaisysQwen2Model * model) {
+        delete model;
+    }
+    struct LlaisysQwen2Weights *llaisysQwen2ModelWeights(struct LlaisysQwen2Model * model) {
+        return model->model.weights();
+    }
+    void llaisysQwen2ModelSetOptions(struct LlaisysQwen2Model * model, const struct LlaisysQwen2Options *options) {
+        model->model.setOptions(*options);
+    }
+    int64_t llaisysQwen2ModelInfer(struct LlaisysQwen2Model * model, int64_t * token_ids, size_t ntoken) {
+        return model->model.infer(token_ids, ntoken);
+    }
+    void llaisysQwen2ModelSetSampling(struct LlaisysQwen2Model * model, size_t top_k, float top_p, float temperature,
+                                      uint64_t seed) {
+        model->model.setSampling({top_k, top_p, temperature, seed});
+    }
+    int64_t llaisysQwen2ModelEnqueue(struct LlaisysQwen2Model * model, const int64_t *token_ids, size_t ntoken,
+                                     size_t max_new_tokens) {
+        return model->scheduler.enqueue(token_ids, ntoken, max_new_tokens);
+    }
+    size_t llaisysQwen2ModelStep(struct LlaisysQwen2Model * model) {
+        return model->scheduler.step();
+    }
+    size_t llaisysQwen2ModelPoll(struct LlaisysQwen2Model * model, int64_t request, int64_t *token_ids,
+                                 size_t capacity, uint8_t *done) {
+        bool finished = false;
+        const size_t n = model->scheduler.poll(request, token_ids, capacity, finished);
+        *done = finished;
+        return n;
+    }
+    void llaisysQwen2ModelBatchStats(struct LlaisysQwen2Model * model, struct LlaisysQwen2BatchStats *stats) {
+        const auto &s = model->scheduler.stats();
+        *stats = {s.steps, s.prefill_tokens, s.generated_tokens, s.seconds,
+                  s.seconds > 0 ? s.generated_tokens / s.seconds : 0.0};
+    }
+    size_t llaisysQwen2ModelGenerateSpeculative(struct LlaisysQwen2Model * model, const int64_t *token_ids,
+                                                size_t ntoken, size_t max_new_tokens,
+                                                struct LlaisysQwen2Model *draft_model, size_t num_speculative,
+                                                int64_t *out_tokens, struct LlaisysQwen2SpecStats *stats) {
+        llaisys::models::SpeculativeStats s;
+        const size_t n = model->model.generateSpeculative(token_ids, ntoken, max_new_tokens, num_speculative,
+                                                          draft_model ? &draft_model->model : nullptr, out_tokens, s);
+        if (stats) {
+            *stats = {s.steps, s.proposed, s.accepted, s.generated, s.seconds,
+                      s.proposed > 0 ? double(s.accepted) / s.proposed : 0.0,
+                      s.steps > 0 ? double(s.generated) / s.steps : 0.0};
+        }
+        return n;
+    }
+}
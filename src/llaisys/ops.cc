@@ -9,9 +9,12 @@
 #include "../ops/rearrange/op.hpp"
 #include "../ops/rms_norm/op.hpp"
 #include "../ops/rope/op.hpp"
+#include "../ops/sample/op.hpp"
 #include "../ops/self_attention/op.hpp"
 #include "../ops/swiglu/op.hpp"
 
+#include <vector>
+
 __C {
     void llaisysAdd(llaisysTensor_t c, llaisysTensor_t a, llaisysTensor_t b) {
         llaisys::ops::add(c->tensor, a->tensor, b->tensor);
@@ -23,7 +26,38 @@ __C {
         llaisys::ops::embedding(out->tensor, index->tensor, weight->tensor);
     }
     void llaisysLinear(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t bias) {
-        llaisys::ops::linear(out->tensor, in->tensor, weight->tensor, bias->tensor);
+        llaisys::ops::linear(out->tensor, in->tensor, weight->tensor, bias ? bias->tensor : nullptr);
+    }
+    void llaisysLinearFused(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t bias,
+                            llaisysTensor_t residual, llaisysActivation_t activation) {
+        llaisys::ops::linear(out->tensor, in->tensor, weight->tensor,
+                             {bias ? bias->tensor : nullptr, residual ? residual->tensor : nullptr, activation});
+    }
+    llaisysTensor_t llaisysLinearConcat(llaisysTensor_t *parts, size_t nparts) {
+        std::vector<llaisys::tensor_t> tensors(nparts);
+        for (size_t i = 0; i < nparts; i++) {
+            tensors[i] = parts[i]->tensor;
+        }
+        return new LlaisysTensor{llaisys::ops::linear_concat(tensors)};
+    }
+    llaisysTensor_t llaisysLinearStackGateUp(llaisysTensor_t gate, llaisysTensor_t up) {
+        return new LlaisysTensor{llaisys::ops::linear_stack_gate_up(gate->tensor, up->tensor)};
+    }
+    void llaisysLinearSwiGLU(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t gate_up, llaisysTensor_t bias) {
+        llaisys::ops::linear_swiglu(out->tensor, in->tensor, gate_up->tensor, bias ? bias->tensor : nullptr);
+    }
+    llaisysTensor_t llaisysLinearPackWeight(llaisysTensor_t weight) {
+        return new LlaisysTensor{llaisys::ops::linear_pack_weight(weight->tensor)};
+    }
+    llaisysTensor_t llaisysLinearQuantizeInt8(llaisysTensor_t weight) {
+        return new LlaisysTensor{llaisys::ops::linear_quantize_int8(weight->tensor)};
+    }
+    llaisysTensor_t llaisysLinearQuantizeQ4(llaisysTensor_t weight, size_t group_size, llaisysQ4Mode_t mode) {
+        return new LlaisysTensor{llaisys::ops::linear_quantize_q4(weight->tensor, group_size, mode)};
+    }
+    void llaisysLinearTopK(llaisysTensor_t out_idx, llaisysTensor_t out_val, llaisysTensor_t in, llaisysTensor_t weight,
+                           size_t k) {
+        llaisys::ops::linear_topk(out_idx->tensor, out_val->tensor, in->tensor, weight->tensor, k);
     }
     void llaisysRearrange(llaisysTensor_t out, llaisysTensor_t in) {
         llaisys::ops::rearrange(out->tensor, in->tensor);
@@ -34,9 +68,33 @@ __C {
     void llaisysROPE(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t pos_ids, float theta) {
         llaisys::ops::rope(out->tensor, in->tensor, pos_ids->tensor, theta);
     }
+    void llaisysROPEShift(llaisysTensor_t out, llaisysTensor_t in, int64_t delta, float theta) {
+        llaisys::ops::rope_shift(out->tensor, in->tensor, delta, theta);
+    }
+    void llaisysSample(llaisysTensor_t max_idx, llaisysTensor_t logits, llaisysTensor_t rng_state, size_t top_k,
+                       float top_p, float temperature) {
+        llaisys::ops::sample(max_idx->tensor, logits->tensor, rng_state->tensor, top_k, top_p, temperature);
+    }
     void llaisysSelfAttention(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k, llaisysTensor_t v, float scale) {
         llaisys::ops::self_attention(attn_val->tensor, q->tensor, k->tensor, v->tensor, scale);
     }
+    void llaisysSelfAttentionPaged(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k_cache,
+                                   llaisysTensor_t v_cache, llaisysTensor_t block_table, size_t total_len, float scale) {
+        llaisys::ops::self_attention_paged(attn_val->tensor, q->tensor, k_cache->tensor, v_cache->tensor,
+                                           block_table->tensor, total_len, scale);
+    }
+    void llaisysSelfAttentionVarlen(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k, llaisysTensor_t v,
+                                    llaisysTensor_t cu_seqlens_q, llaisysTensor_t cu_seqlens_k, float scale) {
+        llaisys::ops::self_attention_varlen(attn_val->tensor, q->tensor, k->tensor, v->tensor,
+                                            cu_seqlens_q->tensor, cu_seqlens_k->tensor, scale);
+    }
+    void llaisysSelfAttentionPagedVarlen(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k_cache,
+                                         llaisysTensor_t v_cache, llaisysTensor_t cu_seqlens_q,
+                                         llaisysTensor_t seq_lens_k, llaisysTensor_t block_tables, float scale) {
+        llaisys::ops::self_attention_paged_varlen(attn_val->tensor, q->tensor, k_cache->tensor, v_cache->tensor,
+                                                  cu_seqlens_q->tensor, seq_lens_k->tensor, block_tables->tensor,
+                                                  scale);
+    }
     void llaisysSwiGLU(llaisysTensor_t out, llaisysTensor_t gate, llaisysTensor_t up) {
         llaisys::ops::swiglu(out->tensor, gate->tensor, up->tensor);
     }
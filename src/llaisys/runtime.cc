@@ -7,6 +7,15 @@ __C void llaisysSetContextRuntime(llaisysDeviceType_t device_type, int device_id
     llaisys::core::context().setDevice(device_type, device_id);
 }
 
+// Llaisys API for the precision policy of the calling thread.
+__C void llaisysSetPrecision(llaisysPrecision_t precision) {
+    llaisys::core::context().setPrecision(precision);
+}
+
+__C llaisysPrecision_t llaisysGetPrecision() {
+    return llaisys::core::context().precision();
+}
+
 // Llaisys API for getting the runtime APIs
 __C const LlaisysRuntimeAPI *llaisysGetRuntimeAPI(llaisysDeviceType_t device_type) {
     return llaisys::device::getRuntimeAPI(device_type);
@@ -0,0 +1,568 @@
+#include "qwen2.hpp"
+
+#include "speculative.hpp"
+
+#include "../../llaisys/llaisys_tensor.hpp"
+#include "../../ops/argmax/op.hpp"
+#include "../../ops/embedding/op.hpp"
+#include "../../ops/linear/op.hpp"
+#include "../../ops/rms_norm/op.hpp"
+#include "../../ops/rope/op.hpp"
+#include "../../ops/sample/op.hpp"
+#include "../../ops/self_attention/op.hpp"
+#include "../../utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+namespace llaisys::models {
+namespace {
+// tokens per KV block, per step and sequences per step at most
+constexpr size_t BLOCK_SIZE = 16;
+constexpr size_t CHUNK_ROWS = 512;
+constexpr size_t MAX_BATCH = 64;
+// widest top-k drawn from the fused LM head's candidates; wider ones, and
+// top-p alone, sample from the full logits
+constexpr size_t MAX_TOP_K = 256;
+} // namespace
+
+Qwen2Model::Qwen2Model(const LlaisysQwen2Meta &meta, llaisysDeviceType_t device_type, int device_id)
+    : _meta(meta), _device_type(device_type), _device_id(device_id), _rows(std::min(meta.maxseq, CHUNK_ROWS)),
+      _max_batch(std::min(_rows, MAX_BATCH)), _max_blocks((meta.maxseq + BLOCK_SIZE - 1) / BLOCK_SIZE),
+      _cache(meta.dtype, meta.dtype, meta.nlayer, meta.nkvh, meta.dh, BLOCK_SIZE,
+             _max_blocks, device_type, device_id) {
+    const size_t nlayer = meta.nlayer, hs = meta.hs, nh = meta.nh, nkvh = meta.nkvh, dh = meta.dh;
+    CHECK_ARGUMENT(nlayer > 0 && hs > 0 && nh > 0 && nkvh > 0 && dh > 0 && meta.di > 0 && meta.voc > 0 && meta.maxseq > 0,
+                   "Qwen2: all sizes must be positive.");
+    CHECK_ARGUMENT(nh % nkvh == 0, "Qwen2: query heads must be a multiple of the KV heads.");
+    _options.kv_dtype = meta.dtype;
+
+    const auto weight = [&](const std::vector<size_t> &shape) {
+        _handles.push_back(new LlaisysTensor{Tensor::create(shape, meta.dtype, device_type, device_id)});
+        return _handles.back();
+    };
+    const auto per_layer = [&](const std::vector<size_t> &shape) {
+        auto *arr = new llaisysTensor_t[nlayer];
+        for (size_t l = 0; l < nlayer; ++l) {
+            arr[l] = weight(shape);
+        }
+        return arr;
+    };
+    _weights.in_embed = weight({meta.voc, hs});
+    _weights.out_embed = weight({meta.voc, hs});
+    _weights.out_norm_w = weight({hs});
+    _weights.attn_norm_w = per_layer({hs});
+    _weights.attn_q_w = per_layer({nh * dh, hs});
+    _weights.attn_q_b = per_layer({nh * dh});
+    _weights.attn_k_w = per_layer({nkvh * dh, hs});
+    _weights.attn_k_b = per_layer({nkvh * dh});
+    _weights.attn_v_w = per_layer({nkvh * dh, hs});
+    _weights.attn_v_b = per_layer({nkvh * dh});
+    _weights.attn_o_w = per_layer({hs, nh * dh});
+    _weights.mlp_norm_w = per_layer({hs});
+    _weights.mlp_gate_w = per_layer({meta.di, hs});
+    _weights.mlp_up_w = per_layer({meta.di, hs});
+    _weights.mlp_down_w = per_layer({hs, meta.di});
+
+    const auto activation = [&](const std::vector<size_t> &shape, llaisysDataType_t dtype) {
+        return Tensor::create(shape, dtype, device_type, device_id);
+    };
+    _ids_host.resize(_rows);
+    _pos_host.resize(_rows);
+    _chunk_pos.resize(_max_batch);
+    _views.cu.reserve(_max_batch + 1);
+    _views.k_rows.resize(_max_batch);
+    _views.v_rows.resize(_max_batch);
+    _ids = activation({_rows}, LLAISYS_DTYPE_I64);
+    _pos = activation({_rows}, LLAISYS_DTYPE_I64);
+    _hidden = activation({_rows, hs}, meta.dtype);
+    _normed = activation({_rows, hs}, meta.dtype);
+    _qkv = activation({_rows, (nh + 2 * nkvh) * dh}, meta.dtype);
+    _q = activation({_rows, nh, dh}, meta.dtype);
+    _k = activation({_rows, nkvh, dh}, meta.dtype);
+    _attn = activation({_rows, nh, dh}, meta.dtype);
+    _act = activation({_rows, meta.di}, meta.dtype);
+    _logits = activation({_max_batch, meta.voc}, meta.dtype);
+    _max_idx = activation({_max_batch}, LLAISYS_DTYPE_I64);
+    _max_val = activation({_max_batch}, meta.dtype);
+    _top_idx = activation({_max_batch * std::min(MAX_TOP_K, meta.voc)}, LLAISYS_DTYPE_I64);
+    _top_val = activation({_max_batch * std::min(MAX_TOP_K, meta.voc)}, LLAISYS_DTYPE_F32);
+    _top_host.resize(_max_batch * std::min(MAX_TOP_K, meta.voc));
+    _cu_q = Tensor::create({_max_batch + 1}, LLAISYS_DTYPE_I32);
+    _lens = Tensor::create({_max_batch}, LLAISYS_DTYPE_I32);
+    _rng = Tensor::create({1}, LLAISYS_DTYPE_I64);
+    _tables = Tensor::create({_max_batch, _max_blocks}, LLAISYS_DTYPE_I32);
+}
+
+Qwen2Model::~Qwen2Model() {
+    for (llaisysTensor_t t : _handles) {
+        delete t;
+    }
+    for (llaisysTensor_t *arr : {_weights.attn_norm_w, _weights.attn_q_w, _weights.attn_q_b, _weights.attn_k_w,
+                                 _weights.attn_k_b, _weights.attn_v_w, _weights.attn_v_b, _weights.attn_o_w,
+                                 _weights.mlp_norm_w, _weights.mlp_gate_w, _weights.mlp_up_w, _weights.mlp_down_w}) {
+        delete[] arr;
+    }
+}
+
+const LlaisysQwen2Meta &Qwen2Model::meta() const {
+    return _meta;
+}
+
+void Qwen2Model::setOptions(const LlaisysQwen2Options &options) {
+    CHECK_ARGUMENT(!_prepared, "Qwen2: options are set before the weights are prepared.");
+    const auto format = options.weight_format;
+    CHECK_ARGUMENT(format == LLAISYS_QWEN2_WEIGHTS_DENSE || format == LLAISYS_QWEN2_WEIGHTS_INT8
+                       || format == LLAISYS_QWEN2_WEIGHTS_Q4,
+                   "Qwen2: invalid weight format.");
+    CHECK_ARGUMENT(format == LLAISYS_QWEN2_WEIGHTS_DENSE || _device_type == LLAISYS_DEVICE_CPU,
+                   "Qwen2: quantized weights are CPU only.");
+    if (format == LLAISYS_QWEN2_WEIGHTS_Q4) {
+        const size_t g = options.q4_group_size;
+        CHECK_ARGUMENT(g > 0 && g % 32 == 0 && _meta.hs % g == 0 && (_meta.nh * _meta.dh) % g == 0 && _meta.di % g == 0,
+                       "Qwen2: the Q4 group size must be a multiple of 32 dividing hs, nh * dh and di.");
+        CHECK_ARGUMENT(options.q4_mode == LLAISYS_Q4_SYMMETRIC || options.q4_mode == LLAISYS_Q4_ZERO_POINT,
+                       "Qwen2: invalid Q4 mode.");
+    }
+    CHECK_ARGUMENT(options.precision == LLAISYS_PRECISION_F32 || options.precision == LLAISYS_PRECISION_BF16_DOT,
+                   "Qwen2: invalid precision policy.");
+    const bool quantized_kv = options.kv_dtype != _meta.dtype;
+    CHECK_ARGUMENT(!quantized_kv || options.kv_dtype == LLAISYS_DTYPE_I8 || options.kv_dtype == LLAISYS_DTYPE_F8,
+                   "Qwen2: K/V are stored in the model type, I8 or F8.");
+    CHECK_ARGUMENT(!quantized_kv || _device_type == LLAISYS_DEVICE_CPU, "Qwen2: a quantized KV cache is CPU only.");
+    if (options.window > 0) {
+        // a streaming block table, at most (sink + window) / BLOCK_SIZE + 1
+        // blocks, then fits in that of maxseq tokens
+        CHECK_ARGUMENT(options.sink % BLOCK_SIZE == 0 && options.window % BLOCK_SIZE == 0
+                           && options.sink + options.window < _meta.maxseq,
+                       "Qwen2: sink and window must be multiples of 16 adding up to less than maxseq.");
+        CHECK_ARGUMENT(!quantized_kv, "Qwen2: streaming re-bases keys and needs an unquantized KV cache.");
+    } else {
+        CHECK_ARGUMENT(options.sink == 0, "Qwen2: a sink needs a window.");
+    }
+    if (options.kv_dtype != _cache.kvDtype()) {
+        // nothing is cached before the first step
+        _cache = kv_cache::PagedKVCache(_meta.dtype, options.kv_dtype, _meta.nlayer, _meta.nkvh, _meta.dh, BLOCK_SIZE,
+                                        _max_blocks, _device_type, _device_id);
+    }
+    _options = options;
+}
+
+const LlaisysQwen2Options &Qwen2Model::options() const {
+    return _options;
+}
+
+bool Qwen2Model::streaming() const {
+    return _options.window > 0;
+}
+
+LlaisysQwen2Weights *Qwen2Model::weights() {
+    return &_weights;
+}
+
+size_t Qwen2Model::chunkRows() const {
+    return _rows;
+}
+
+size_t Qwen2Model::maxBatch() const {
+    return _max_batch;
+}
+
+kv_cache::PrefixCache &Qwen2Model::prefixCache() {
+    return _prefix;
+}
+
+int64_t Qwen2Model::addSequence(const int64_t *tokens, size_t n, size_t &cached) {
+    if (streaming()) {
+        cached = 0;
+        return _cache.addStreamingSequence(_options.sink, _options.window, _meta.theta);
+    }
+    return _prefix.addSequence(tokens, n, cached);
+}
+
+void Qwen2Model::prepare() {
+    const auto pack = [&](tensor_t w) {
+        switch (_options.weight_format) {
+        case LLAISYS_QWEN2_WEIGHTS_INT8:
+            return ops::linear_quantize_int8(w);
+        case LLAISYS_QWEN2_WEIGHTS_Q4:
+            return ops::linear_quantize_q4(w, _options.q4_group_size, _options.q4_mode);
+        default:
+            return _device_type == LLAISYS_DEVICE_CPU ? ops::linear_pack_weight(w) : w;
+        }
+    };
+    const auto take = [](llaisysTensor_t handle) {
+        tensor_t t = std::move(handle->tensor);
+        handle->tensor = nullptr;
+        return t;
+    };
+    _layers.resize(_meta.nlayer);
+    for (size_t l = 0; l < _meta.nlayer; ++l) {
+        Layer &layer = _layers[l];
+        layer.attn_norm = take(_weights.attn_norm_w[l]);
+        layer.qkv = pack(ops::linear_concat({take(_weights.attn_q_w[l]), take(_weights.attn_k_w[l]),
+                                             take(_weights.attn_v_w[l])}));
+        layer.qkv_bias = ops::linear_concat({take(_weights.attn_q_b[l]), take(_weights.attn_k_b[l]),
+                                             take(_weights.attn_v_b[l])});
+        layer.o = pack(take(_weights.attn_o_w[l]));
+        layer.mlp_norm = take(_weights.mlp_norm_w[l]);
+        layer.gate_up = pack(ops::linear_stack_gate_up(take(_weights.mlp_gate_w[l]), take(_weights.mlp_up_w[l])));
+        layer.down = pack(take(_weights.mlp_down_w[l]));
+    }
+    _in_embed = take(_weights.in_embed);
+    _out_embed = pack(take(_weights.out_embed));
+    _out_norm = take(_weights.out_norm_w);
+    _prepared = true;
+}
+
+void Qwen2Model::forward(const Chunk *chunks, size_t nchunk, int64_t *next) {
+    CHECK_ARGUMENT(nchunk > 0 && nchunk <= _max_batch, "Qwen2: between 1 and maxBatch() sequences per step.");
+    // every argument is checked before the cache or the weights change
+    size_t nrows = 0, nlogits = 0;
+    for (size_t i = 0; i < nchunk; ++i) {
+        const Chunk &c = chunks[i];
+        CHECK_ARGUMENT(c.n > 0 && c.n <= _rows - nrows, "Qwen2: between 1 and chunkRows() tokens per step.");
+        CHECK_ARGUMENT(c.logits <= c.n && c.logits <= _max_batch - nlogits,
+                       "Qwen2: at most maxBatch() rows of logits.");
+        // a streaming sequence makes room by evicting its oldest window tokens
+        CHECK_ARGUMENT(streaming() ? c.n <= _options.window : _cache.length(c.seq) + c.n <= _meta.maxseq,
+                       "Qwen2: the sequence would exceed maxseq, or a step the streaming window.");
+        for (size_t j = 0; j < i; ++j) {
+            CHECK_ARGUMENT(chunks[j].seq != c.seq, "Qwen2: a sequence appears twice in one step.");
+        }
+        nrows += c.n;
+        nlogits += c.logits;
+    }
+    if (!_prepared) {
+        prepare();
+    }
+    core::context().setDevice(_device_type, _device_id);
+    const auto *api = core::context().runtime().api();
+    // the model's precision policy for this step, the caller's restored after
+    struct PrecisionScope {
+        llaisysPrecision_t saved = core::context().precision();
+        explicit PrecisionScope(llaisysPrecision_t p) { core::context().setPrecision(p); }
+        ~PrecisionScope() { core::context().setPrecision(saved); }
+    } precision_scope(_options.precision);
+    const size_t nh = _meta.nh, nkvh = _meta.nkvh, dh = _meta.dh, hs = _meta.hs;
+    const float scale = 1.0f / std::sqrt(static_cast<float>(dh));
+
+    // rows of chunk i are [cu[i], cu[i + 1]) of the step
+    int32_t *cu = reinterpret_cast<int32_t *>(_cu_q->data());
+    int32_t *lens = reinterpret_cast<int32_t *>(_lens->data());
+    int32_t *tables = reinterpret_cast<int32_t *>(_tables->data());
+    cu[0] = 0;
+    for (size_t i = 0; i < nchunk; ++i) {
+        const Chunk &c = chunks[i];
+        size_t pos;
+        try {
+            pos = _prefix.extend(c.seq, c.n);
+        } catch (...) {
+            // out of blocks: the chunks already extended give theirs back
+            for (size_t j = 0; j < i; ++j) {
+                _cache.truncate(chunks[j].seq, _chunk_pos[j]);
+            }
+            throw;
+        }
+        std::copy(c.tokens, c.tokens + c.n, _ids_host.begin() + cu[i]);
+        for (size_t t = 0; t < c.n; ++t) {
+            _pos_host[cu[i] + t] = static_cast<int64_t>(pos + t);
+        }
+        _chunk_pos[i] = pos;
+        cu[i + 1] = static_cast<int32_t>(cu[i] + c.n);
+        lens[i] = static_cast<int32_t>(_cache.length(c.seq));
+        const std::vector<int32_t> &blocks = _cache.blockIds(c.seq);
+        std::copy(blocks.begin(), blocks.end(), tables + i * _max_blocks);
+    }
+    const size_t m = cu[nchunk];
+
+    // every view of the step, built for all the layers, and kept for the
+    // next steps while they split their rows the same way
+    StepViews &sv = _views;
+    if (!std::equal(cu, cu + nchunk + 1, sv.cu.begin(), sv.cu.end())) {
+        sv.cu.assign(cu, cu + nchunk + 1);
+        sv.ids = _ids->slice(0, 0, m);
+        sv.pos = _pos->slice(0, 0, m);
+        sv.hidden = _hidden->slice(0, 0, m);
+        sv.normed = _normed->slice(0, 0, m);
+        sv.qkv = _qkv->slice(0, 0, m);
+        tensor_t heads = sv.qkv->view({m, nh + 2 * nkvh, dh});
+        sv.q_in = heads->slice(1, 0, nh);
+        sv.k_in = heads->slice(1, nh, nh + nkvh);
+        tensor_t v = heads->slice(1, nh + nkvh, nh + 2 * nkvh);
+        sv.q = _q->slice(0, 0, m);
+        sv.k = _k->slice(0, 0, m);
+        sv.attn = _attn->slice(0, 0, m);
+        sv.attn_rows = sv.attn->view({m, nh * dh});
+        sv.act = _act->slice(0, 0, m);
+        sv.cu_q = _cu_q->slice(0, 0, nchunk + 1);
+        sv.seq_lens = _lens->slice(0, 0, nchunk);
+        sv.block_tables = _tables->slice(0, 0, nchunk);
+        for (size_t i = 0; i < nchunk; ++i) {
+            sv.k_rows[i] = sv.k->slice(0, cu[i], cu[i + 1]);
+            sv.v_rows[i] = v->slice(0, cu[i], cu[i + 1]);
+        }
+    }
+    const tensor_t &hidden = sv.hidden, &normed = sv.normed, &pos = sv.pos;
+    sv.ids->load(_ids_host.data());
+    pos->load(_pos_host.data());
+
+    ops::embedding(hidden, sv.ids, _in_embed);
+    for (size_t l = 0; l < _meta.nlayer; ++l) {
+        const Layer &layer = _layers[l];
+        ops::rms_norm(normed, hidden, layer.attn_norm, _meta.epsilon);
+        ops::linear(sv.qkv, normed, layer.qkv, layer.qkv_bias);
+        ops::rope(sv.q, sv.q_in, pos, _meta.theta);
+        ops::rope(sv.k, sv.k_in, pos, _meta.theta);
+        for (size_t i = 0; i < nchunk; ++i) {
+            _cache.store(chunks[i].seq, l, _chunk_pos[i], sv.k_rows[i], sv.v_rows[i]);
+        }
+        ops::self_attention_paged_varlen(sv.attn, sv.q, _cache.keys(l), _cache.values(l), sv.cu_q, sv.seq_lens,
+                                         sv.block_tables, scale);
+        ops::linear(hidden, sv.attn_rows, layer.o, ops::LinearEpilogue{nullptr, hidden});
+
+        ops::rms_norm(normed, hidden, layer.mlp_norm, _meta.epsilon);
+        ops::linear_swiglu(sv.act, normed, layer.gate_up, nullptr);
+        ops::linear(hidden, sv.act, layer.down, ops::LinearEpilogue{nullptr, hidden});
+    }
+
+    // logits of the last rows of each chunk that asks for them, gathered
+    // into the first rows of _normed (free by now) and normalized in place
+    const size_t row = hs * _hidden->elementSize();
+    size_t nl = 0;
+    for (size_t i = 0; i < nchunk; ++i) {
+        const size_t nrow = chunks[i].logits;
+        if (nrow > 0) {
+            api->memcpy_sync(_normed->data() + nl * row, _hidden->data() + (cu[i + 1] - nrow) * row, nrow * row,
+                             LLAISYS_MEMCPY_D2D);
+            nl += nrow;
+        }
+    }
+    if (nl == 0) {
+        return;
+    }
+    if (nl != sv.nl) {
+        sv.nl = nl;
+        sv.last = _normed->slice(0, 0, nl);
+        sv.width = 0;
+    }
+    const tensor_t &last = sv.last;
+    ops::rms_norm(last, last, _out_norm, _meta.epsilon);
+    const auto sampled = [](const Sampling *s) { return s != nullptr && !s->greedy(); };
+    uint64_t *rng = reinterpret_cast<uint64_t *>(_rng->data());
+
+    // Greedy and top-k rows only need the best few logits: linear_topk finds
+    // them without writing the [nl, voc] logits, and a sampled row draws a
+    // position among its candidates, which are its top_k logits in the order
+    // ops::sample would rank them over the full row.
+    size_t width = 1;
+    for (size_t i = 0; i < nchunk && width > 0; ++i) {
+        const Sampling *s = chunks[i].sampling;
+        if (chunks[i].logits > 0 && sampled(s)) {
+            const bool fits = s->top_k > 0 && s->top_k <= MAX_TOP_K && s->top_k < _meta.voc;
+            width = fits ? std::max(width, s->top_k) : 0;
+        }
+    }
+    if (width > 0) {
+        if (width != sv.width) {
+            sv.width = width;
+            sv.top_idx = _top_idx->slice(0, 0, nl * width)->view({nl, width});
+            sv.top_val = _top_val->slice(0, 0, nl * width)->view({nl, width});
+        }
+        ops::linear_topk(sv.top_idx, sv.top_val, last, _out_embed, width);
+        for (size_t i = 0, j = 0; i < nchunk; j += chunks[i++].logits) {
+            Sampling *s = chunks[i].sampling;
+            for (size_t r = j; sampled(s) && r < j + chunks[i].logits; ++r) {
+                tensor_t candidates = _top_val->slice(0, r * width, r * width + s->top_k)->view({1, s->top_k});
+                *rng = s->rng;
+                ops::sample(_max_idx->slice(0, r, r + 1), candidates, _rng, s->top_k, s->top_p, s->temperature);
+                s->rng = *rng;
+            }
+        }
+        api->memcpy_sync(_top_host.data(), _top_idx->data(), nl * width * sizeof(int64_t), LLAISYS_MEMCPY_D2H);
+        api->memcpy_sync(next, _max_idx->data(), nl * sizeof(int64_t), LLAISYS_MEMCPY_D2H);
+        for (size_t i = 0, j = 0; i < nchunk; j += chunks[i++].logits) {
+            const bool drawn = sampled(chunks[i].sampling);
+            for (size_t r = j; r < j + chunks[i].logits; ++r) {
+                next[r] = _top_host[r * width + (drawn ? next[r] : 0)];
+            }
+        }
+        return;
+    }
+
+    // top-p alone, or a top-k wider than MAX_TOP_K: the full logits
+    ops::linear(_logits->slice(0, 0, nl), last, _out_embed, nullptr);
+    for (size_t i = 0, j = 0; i < nchunk; ++i) {
+        Sampling *s = chunks[i].sampling;
+        for (size_t r = 0; r < chunks[i].logits; ++r, ++j) {
+            tensor_t logits = _logits->slice(0, j, j + 1);
+            if (!sampled(s)) {
+                ops::argmax(_max_idx->slice(0, j, j + 1), _max_val->slice(0, j, j + 1), logits);
+                continue;
+            }
+            *rng = s->rng;
+            ops::sample(_max_idx->slice(0, j, j + 1), logits, _rng, s->top_k, s->top_p, s->temperature);
+            s->rng = *rng;
+        }
+    }
+    api->memcpy_sync(next, _max_idx->data(), nl * sizeof(int64_t), LLAISYS_MEMCPY_D2H);
+}
+
+void Qwen2Model::setSampling(const Sampling &sampling) {
+    _sampling = sampling;
+}
+
+int64_t Qwen2Model::infer(const int64_t *tokens, size_t n) {
+    CHECK_ARGUMENT(n > 0 && (streaming() || n <= _meta.maxseq), "Qwen2: between 1 and maxseq tokens per sequence.");
+
+    // continue the session if tokens extend it, roll it back if they diverge
+    // past its published blocks, else restart on the longest cached prefix;
+    // the last token always runs, its logits are needed. A streaming session
+    // cannot roll back past the tokens it evicted: it starts over.
+    size_t common = 0;
+    if (_seq >= 0) {
+        const size_t limit = std::min(_tokens.size(), n - 1);
+        while (common < limit && _tokens[common] == tokens[common]) {
+            ++common;
+        }
+    }
+    if (_seq >= 0 && common < _tokens.size() && !streaming() && common >= _committed * _cache.blockSize()) {
+        _cache.truncate(_seq, common);
+        _tokens.resize(common);
+    } else if (_seq < 0 || common < _tokens.size()) {
+        if (_seq >= 0) {
+            _cache.removeSequence(_seq);
+        }
+        _seq = addSequence(tokens, n, common);
+        _tokens.assign(tokens, tokens + common);
+        _committed = common / _cache.blockSize();
+    }
+    int64_t next = -1;
+    const size_t step = streaming() ? std::min(_rows, _options.window) : _rows;
+    for (size_t off = common; off < n;) {
+        const size_t m = std::min(n - off, step);
+        const Chunk chunk{_seq, tokens + off, m, off + m == n ? size_t(1) : size_t(0), &_sampling};
+        forward(&chunk, 1, &next);
+        _tokens.insert(_tokens.end(), tokens + off, tokens + off + m);
+        off += m;
+    }
+
+    if (!streaming() && n / _cache.blockSize() > _committed) {
+        _prefix.commit(_seq, tokens, n);
+        _committed = n / _cache.blockSize();
+    }
+    return next;
+}
+
+bool Qwen2Model::endSession() {
+    if (_seq < 0) {
+        return false;
+    }
+    _cache.removeSequence(_seq);
+    _seq = -1;
+    _tokens.clear();
+    _committed = 0;
+    return true;
+}
+
+size_t Qwen2Model::sessionBlocks() const {
+    if (_seq < 0) {
+        return 0;
+    }
+    // a block the session shares with a batch request is in the tree too
+    const kv_cache::BlockAllocator &alloc = _cache.blocks();
+    const std::vector<int32_t> &blocks = _cache.blockIds(_seq);
+    return std::count_if(blocks.begin(), blocks.end(), [&](int32_t b) { return alloc.refs(b) <= 2; });
+}
+
+size_t Qwen2Model::generateSpeculative(const int64_t *tokens, size_t n, size_t max_new, size_t k, Qwen2Model *draft,
+                                       int64_t *out, SpeculativeStats &stats) {
+    CHECK_ARGUMENT(n > 0 && (streaming() || n < _meta.maxseq), "Qwen2: a prompt needs 1 to maxseq - 1 tokens.");
+    CHECK_ARGUMENT(draft != this, "Qwen2: a model cannot draft for itself.");
+    CHECK_ARGUMENT(draft == nullptr || draft->meta().voc == _meta.voc,
+                   "Qwen2: the draft model must share the vocabulary.");
+    const auto start = std::chrono::steady_clock::now();
+    if (!streaming()) {
+        max_new = max_new == 0 ? _meta.maxseq - n : std::min(max_new, _meta.maxseq - n);
+    } else if (max_new == 0) {
+        max_new = _meta.maxseq;
+    }
+    // a streaming step adds at most a window of tokens
+    k = std::min({k, _max_batch - 1, streaming() ? _options.window - 1 : k});
+
+    // The session holds the K/V of every token of `history` but the pending
+    // `next`. A step runs [next, d1..dm] with logits for all m + 1 rows: p_i
+    // is the greedy token after d_i (p_0 after next), so d1..da with a the
+    // longest prefix where d_{i+1} == p_i are what greedy decoding would have
+    // produced, followed by p_a; the K/V of the rejected d_{a+1}.. is cut off.
+    // A streaming step stops short of where the window slides, unless it
+    // slides at its first row as it would for infer(), so that every row sees
+    // the cache repeated infer() would have.
+    std::vector<int64_t> history(tokens, tokens + n), draft_in, proposal(k), verified(k + 1);
+    history.reserve(n + max_new);
+    PromptLookup lookup;
+    const Sampling sampling = std::exchange(_sampling, Sampling{});
+    int64_t next = infer(tokens, n);
+    _sampling = sampling;
+    ++stats.steps;
+    size_t generated = 0;
+    while (true) {
+        history.push_back(next);
+        out[generated++] = next;
+        if (next == _meta.end_token || generated == max_new) {
+            break;
+        }
+        size_t room = std::min({k, max_new - generated, streaming() ? k : _meta.maxseq - history.size()});
+        if (streaming()) {
+            const size_t kept = _options.sink + _options.window, len = _cache.length(_seq);
+            room = std::min(room, (len < kept ? kept - len : _cache.blockSize()) - 1);
+        }
+        size_t m = 0;
+        if (draft != nullptr) {
+            draft_in.assign(history.begin(), history.end());
+            for (; m < room; ++m) {
+                proposal[m] = draft->infer(draft_in.data(), draft_in.size());
+                draft_in.push_back(proposal[m]);
+            }
+        } else if (room > 0) {
+            m = lookup.propose(history.data(), history.size(), room, proposal.data());
+        }
+
+        const size_t cached = _tokens.size();
+        _tokens.push_back(next);
+        _tokens.insert(_tokens.end(), proposal.begin(), proposal.begin() + m);
+        const Chunk chunk{_seq, _tokens.data() + cached, m + 1, m + 1};
+        forward(&chunk, 1, verified.data());
+        size_t a = 0;
+        while (a < m && proposal[a] == verified[a]) {
+            ++a;
+        }
+        ++stats.steps;
+        stats.proposed += m;
+        stats.accepted += a;
+
+        _cache.truncate(_seq, _cache.length(_seq) - (m - a));
+        _tokens.resize(cached + 1 + a);
+        bool done = false;
+        for (size_t i = 0; i < a && !done; ++i) {
+            history.push_back(proposal[i]);
+            out[generated++] = proposal[i];
+            done = proposal[i] == _meta.end_token || generated == max_new;
+        }
+        if (done) {
+            break;
+        }
+        next = verified[a];
+    }
+
+    if (!streaming() && _tokens.size() / _cache.blockSize() > _committed) {
+        _prefix.commit(_seq, _tokens.data(), _tokens.size());
+        _committed = _tokens.size() / _cache.blockSize();
+    }
+    stats.generated += generated;
+    stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return generated;
+}
+} // namespace llaisys::models
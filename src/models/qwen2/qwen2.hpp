@@ -0,0 +1,166 @@
+#pragma once
+
+#include "llaisys/models/qwen2.h"
+
+#include "../../kv_cache/prefix_cache.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace llaisys::models {
+// How a sequence picks its next tokens (see ops::sample); the default, and
+// top_k == 1 or temperature <= 0, is greedy.
+struct Sampling {
+    size_t top_k = 1;
+    float top_p = 1.0f;
+    float temperature = 1.0f;
+    uint64_t rng = 0; // the sequence's generator state, advanced by every draw
+
+    bool greedy() const { return top_k == 1 || temperature <= 0.0f; }
+};
+
+// Counters of Qwen2Model::generateSpeculative().
+struct SpeculativeStats {
+    size_t steps = 0; // target forwards verifying proposals
+    size_t proposed = 0, accepted = 0;
+    size_t generated = 0;
+    double seconds = 0;
+};
+
+// Qwen2 decoder driving the ops directly. Every activation buffer is
+// allocated once, at construction, for a step of up to `chunkRows()` tokens:
+// a forward step only slices them, so it allocates no activation memory, and
+// prompts longer than a step are prefilled chunk by chunk (the queries of a
+// chunk attend to the cached keys of the ones before it). Nor does it
+// allocate anything else: the views it slices are kept from the step before
+// and only rebuilt when the rows are split differently, e.g. when a sequence
+// joins or leaves the batch or a prefill chunk ends (sampling a row from
+// wide top-k candidates or the full logits still slices per row).
+//
+// A step may hold chunks of up to `maxBatch()` sequences, stacked into one
+// [rows, hs] activation so each weight is read once for all of them; only
+// attention and the KV stores are per sequence.
+//
+// The weights are the tensors of `weights()`, filled by the caller. At the
+// first infer() they are prepared once: Q/K/V and gate/up are fused into one
+// projection each and, on the CPU, every projection is repacked for the GEMM
+// kernels, or quantized to INT8/Q4 if setOptions() asked for it. The source
+// tensors are released then and must not be used again.
+//
+// K/V live in a PagedKVCache with a PrefixCache over it. infer() keeps one
+// session: it takes the whole token sequence so far, prefills only what
+// extends the session and, when the sequence diverges from it, rolls the
+// session back to the common part or, if that part was already published to
+// the prefix cache, starts a new one on the longest cached prefix. Batched
+// callers (Qwen2Scheduler) manage their own sequences in the same cache.
+// setOptions() may quantize the cache
+// or make every sequence a streaming one (PagedKVCache::addStreamingSequence),
+// which runs past maxseq in constant memory, its rows rotated at the positions
+// extend() returns, and keeps out of the prefix cache: eviction re-bases its
+// keys in place.
+class Qwen2Model {
+public:
+    // One sequence's share of a step: `n` tokens appended to `seq`, for how
+    // many of the last of them the next token is wanted (1 to decode, all of
+    // them to verify speculative tokens), and how it is picked (null: greedy).
+    struct Chunk {
+        int64_t seq;
+        const int64_t *tokens;
+        size_t n;
+        size_t logits;
+        Sampling *sampling = nullptr;
+    };
+
+private:
+    struct Layer {
+        tensor_t attn_norm, qkv, qkv_bias, o, mlp_norm, gate_up, down;
+    };
+    // The views a step slices the buffers into, kept until a step splits its
+    // rows differently (cu) or asks for other logits (nl rows, top-width).
+    struct StepViews {
+        std::vector<int32_t> cu;
+        tensor_t ids, pos, hidden, normed, qkv, q_in, k_in, q, k, attn, attn_rows, act;
+        tensor_t cu_q, seq_lens, block_tables;
+        std::vector<tensor_t> k_rows, v_rows; // each chunk's rows of K and V
+        size_t nl = 0, width = 0;
+        tensor_t last, top_idx, top_val;
+    };
+
+    LlaisysQwen2Meta _meta;
+    llaisysDeviceType_t _device_type;
+    int _device_id;
+    LlaisysQwen2Weights _weights;
+    std::vector<llaisysTensor_t> _handles; // owned by the model, in _weights
+    LlaisysQwen2Options _options{LLAISYS_QWEN2_WEIGHTS_DENSE, 128, LLAISYS_Q4_SYMMETRIC, LLAISYS_PRECISION_F32,
+                                 LLAISYS_DTYPE_INVALID, 0, 0}; // kv_dtype set by the constructor
+    bool _prepared = false;
+    tensor_t _in_embed, _out_embed, _out_norm;
+    std::vector<Layer> _layers;
+
+    // activations, [_rows, ...], and per-sequence batch data, [_max_batch, ...]
+    size_t _rows, _max_batch, _max_blocks;
+    tensor_t _ids, _pos, _hidden, _normed, _qkv, _q, _k, _attn, _act;
+    tensor_t _logits, _max_idx, _max_val;
+    tensor_t _top_idx, _top_val; // linear_topk candidates, [_max_batch * MAX_TOP_K]
+    tensor_t _cu_q, _lens, _tables; // host I32 for self_attention_paged_varlen
+    tensor_t _rng;                  // host I64 generator state for ops::sample
+    std::vector<int64_t> _ids_host, _pos_host, _top_host;
+    std::vector<size_t> _chunk_pos;
+    StepViews _views;
+
+    kv_cache::PagedKVCache _cache;
+    kv_cache::PrefixCache _prefix{_cache};
+    int64_t _seq = -1;
+    std::vector<int64_t> _tokens; // those the session's K/V hold
+    size_t _committed = 0;        // full blocks published to the prefix cache
+    Sampling _sampling;           // of the session
+
+    void prepare();
+
+public:
+    Qwen2Model(const LlaisysQwen2Meta &meta, llaisysDeviceType_t device_type, int device_id);
+    ~Qwen2Model();
+    Qwen2Model(const Qwen2Model &) = delete;
+    Qwen2Model &operator=(const Qwen2Model &) = delete;
+
+    const LlaisysQwen2Meta &meta() const;
+    // How prepare() stores the weights, the precision forward() runs under
+    // and how the KV cache stores and keeps tokens; only before the weights
+    // are prepared.
+    void setOptions(const LlaisysQwen2Options &options);
+    const LlaisysQwen2Options &options() const;
+    // Whether sequences stream (options().window > 0).
+    bool streaming() const;
+    LlaisysQwen2Weights *weights();
+    // Tokens, and sequences, one step can take.
+    size_t chunkRows() const;
+    size_t maxBatch() const;
+    kv_cache::PrefixCache &prefixCache();
+    // A new sequence for tokens[0, n): a streaming one if the options ask for
+    // it, else one on the longest prefix of them in the prefix cache. `cached`
+    // receives how many of the tokens it holds.
+    int64_t addSequence(const int64_t *tokens, size_t n, size_t &cached);
+
+    // Runs `nchunk` chunks (chunkRows() tokens, maxBatch() chunks and rows
+    // of logits at most) as one step. `next` receives the next tokens the
+    // chunks ask for, in order.
+    void forward(const Chunk *chunks, size_t nchunk, int64_t *next);
+    // How infer() picks tokens from now on; greedy until set.
+    void setSampling(const Sampling &sampling);
+    // The next token after tokens[0, n).
+    int64_t infer(const int64_t *tokens, size_t n);
+    // Releases the K/V of infer()'s session (its published blocks stay in the
+    // prefix cache, so the next infer() restarts on them). Returns whether
+    // there was a session.
+    bool endSession();
+    // Blocks endSession() would free or leave to the prefix cache alone.
+    size_t sessionBlocks() const;
+    // Greedy generation of up to max_new tokens after tokens[0, n) into
+    // `out`, verifying up to `k` proposed tokens per forward: the output is
+    // that of repeated greedy infer(). Proposals come from `draft` (sharing the
+    // vocabulary) if given, else from prompt lookup. Returns the number of
+    // tokens generated and adds to `stats`.
+    size_t generateSpeculative(const int64_t *tokens, size_t n, size_t max_new, size_t k, Qwen2Model *draft,
+                               int64_t *out, SpeculativeStats &stats);
+};
+} // namespace llaisys::models
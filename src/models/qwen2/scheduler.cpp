@@ -0,0 +1,177 @@
+#include "scheduler.hpp"
+
+#include "../../utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace llaisys::models {
+Qwen2Scheduler::Qwen2Scheduler(Qwen2Model &model) : _model(model) {
+    _chunks.reserve(model.maxBatch());
+    _chunk_ids.reserve(model.maxBatch());
+    _next.resize(model.maxBatch());
+}
+
+Qwen2Scheduler::~Qwen2Scheduler() {
+    for (int64_t id : _running) {
+        _model.prefixCache().cache().removeSequence(_requests.at(id).seq);
+    }
+}
+
+int64_t Qwen2Scheduler::enqueue(const int64_t *tokens, size_t n, size_t max_new_tokens) {
+    const size_t maxseq = _model.meta().maxseq;
+    const kv_cache::PagedKVCache &cache = _model.prefixCache().cache();
+    const bool streaming = _model.streaming();
+    CHECK_ARGUMENT(n > 0 && (streaming || n < maxseq), "Qwen2Scheduler: a prompt needs 1 to maxseq - 1 tokens.");
+    // the reservation follows max_new_tokens: defaulting it to maxseq would
+    // have every request reserve most of the pool and run alone
+    CHECK_ARGUMENT(max_new_tokens > 0, "Qwen2Scheduler: max_new_tokens must be positive.");
+    Request r;
+    r.prompt = n;
+    r.max_new = streaming ? max_new_tokens : std::min(max_new_tokens, maxseq - n);
+    r.tokens.reserve(n + r.max_new);
+    r.tokens.assign(tokens, tokens + n);
+    r.reserve = (n + r.max_new + cache.blockSize() - 1) / cache.blockSize();
+    if (streaming) {
+        // the sink, the window and the block being filled at most
+        const LlaisysQwen2Options &o = _model.options();
+        r.reserve = std::min(r.reserve, (o.sink + o.window) / cache.blockSize() + 1);
+    }
+    CHECK_ARGUMENT(r.reserve <= cache.numBlocks(), "Qwen2Scheduler: request larger than the KV cache.");
+    const int64_t id = _next_id++;
+    _requests.emplace(id, std::move(r));
+    _waiting.push_back(id);
+    return id;
+}
+
+bool Qwen2Scheduler::admit(Request &r) {
+    kv_cache::PrefixCache &prefix = _model.prefixCache();
+    kv_cache::PagedKVCache &cache = prefix.cache();
+    // blocks the running requests may still allocate
+    size_t outstanding = 0;
+    for (int64_t id : _running) {
+        const Request &o = _requests.at(id);
+        outstanding += o.reserve - std::min(o.reserve, cache.blockIds(o.seq).size());
+    }
+    // a cached prefix is shared, not allocated
+    const int64_t seq = _model.addSequence(r.tokens.data(), r.prompt, r.cached);
+    const size_t need = outstanding + r.reserve - cache.blockIds(seq).size();
+    // evict nothing for a request that would still not fit
+    if (cache.numFreeBlocks() + prefix.numEvictable() + _model.sessionBlocks() < need) {
+        cache.removeSequence(seq);
+        r.cached = 0;
+        return false;
+    }
+    prefix.evict(need);
+    if (cache.numFreeBlocks() < need && _model.endSession()) {
+        // infer()'s session holds blocks the batch needs
+        prefix.evict(need);
+    }
+    if (cache.numFreeBlocks() < need) {
+        cache.removeSequence(seq);
+        r.cached = 0;
+        return false;
+    }
+    r.seq = seq;
+    return true;
+}
+
+void Qwen2Scheduler::finish(Request &r) {
+    kv_cache::PrefixCache &prefix = _model.prefixCache();
+    if (!_model.streaming()) {
+        prefix.commit(r.seq, r.tokens.data(), r.cached);
+    }
+    prefix.cache().removeSequence(r.seq);
+    r.seq = -1;
+    r.finished = true;
+}
+
+size_t Qwen2Scheduler::step() {
+    const auto start = std::chrono::steady_clock::now();
+    size_t rows = _model.chunkRows();
+    // a streaming chunk adds at most a window of tokens
+    const size_t widest = _model.streaming() ? _model.options().window : rows;
+    _chunks.clear();
+    _chunk_ids.clear();
+    const auto add = [&](int64_t id) {
+        Request &r = _requests.at(id);
+        const size_t remaining = r.tokens.size() - r.cached;
+        const size_t n = std::min({remaining, rows, widest});
+        _chunks.push_back({r.seq, r.tokens.data() + r.cached, n, n == remaining ? size_t(1) : size_t(0)});
+        _chunk_ids.push_back(id);
+        rows -= n;
+    };
+    // decode rows first, so a long prefill only delays admissions
+    for (bool decoding : {true, false}) {
+        for (int64_t id : _running) {
+            const Request &r = _requests.at(id);
+            if ((r.cached >= r.prompt) == decoding && rows > 0 && _chunks.size() < _model.maxBatch()) {
+                add(id);
+            }
+        }
+    }
+    while (!_waiting.empty() && rows > 0 && _chunks.size() < _model.maxBatch()) {
+        const int64_t id = _waiting.front();
+        if (!admit(_requests.at(id))) {
+            break;
+        }
+        _waiting.pop_front();
+        _running.push_back(id);
+        add(id);
+    }
+    // with nothing running, nothing will free the blocks the head is waiting for
+    ASSERT(!_running.empty() || _waiting.empty(), "Qwen2Scheduler: the next request does not fit in the free KV cache.");
+    if (_chunks.empty()) {
+        return _running.size() + _waiting.size();
+    }
+
+    _model.forward(_chunks.data(), _chunks.size(), _next.data());
+
+    const int64_t end_token = _model.meta().end_token;
+    for (size_t i = 0, j = 0; i < _chunks.size(); ++i) {
+        Request &r = _requests.at(_chunk_ids[i]);
+        const bool prefilling = r.cached < r.prompt;
+        r.cached += _chunks[i].n;
+        if (prefilling) {
+            _stats.prefill_tokens += _chunks[i].n;
+            if (r.cached == r.prompt && !_model.streaming()) {
+                // later requests with the same prompt start past it
+                _model.prefixCache().commit(r.seq, r.tokens.data(), r.prompt);
+            }
+        }
+        if (_chunks[i].logits == 0) {
+            continue;
+        }
+        const int64_t next = _next[j++];
+        r.tokens.push_back(next);
+        ++_stats.generated_tokens;
+        if (next == end_token || r.tokens.size() - r.prompt == r.max_new) {
+            finish(r);
+        }
+    }
+    _running.erase(std::remove_if(_running.begin(), _running.end(),
+                                  [&](int64_t id) { return _requests.at(id).finished; }),
+                   _running.end());
+
+    ++_stats.steps;
+    _stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return _running.size() + _waiting.size();
+}
+
+size_t Qwen2Scheduler::poll(int64_t request, int64_t *tokens, size_t capacity, bool &done) {
+    auto it = _requests.find(request);
+    CHECK_ARGUMENT(it != _requests.end(), "Qwen2Scheduler: unknown request.");
+    const Request &r = it->second;
+    const size_t generated = r.tokens.size() - r.prompt;
+    std::copy_n(r.tokens.begin() + r.prompt, std::min(generated, capacity), tokens);
+    done = r.finished;
+    if (done && generated <= capacity) {
+        _requests.erase(it);
+    }
+    return generated;
+}
+
+const Qwen2Scheduler::Stats &Qwen2Scheduler::stats() const {
+    return _stats;
+}
+} // namespace llaisys::models
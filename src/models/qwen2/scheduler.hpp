@@ -0,0 +1,79 @@
+#pragma once
+
+#include "qwen2.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace llaisys::models {
+// Continuous batching over a Qwen2Model: requests are admitted and retired at
+// token granularity, and every step() runs one model forward over all of
+// them, so N concurrent requests cost one weight sweep per token rather than N.
+//
+// Per step, running requests come first: a decoding one adds its last token,
+// one still prefilling adds as much of its prompt as the step has room for
+// (chunked prefill). Waiting requests are then admitted in FIFO order while
+// the step has rows and sequences left and the KV pool can hold them: an
+// admitted request reserves the blocks its prompt plus max_new_tokens need,
+// so running requests never run out of cache. To make room, admission evicts
+// cached prefixes and, if that is not enough, ends the model's infer()
+// session. Prompts start on the longest prefix in the model's prefix cache,
+// and publish theirs once prefilled, unless the model streams: then a request
+// is not capped by maxseq and reserves its sink and window only.
+class Qwen2Scheduler {
+public:
+    struct Stats {
+        size_t steps = 0;
+        size_t prefill_tokens = 0; // prompt tokens run, i.e. not found in the prefix cache
+        size_t generated_tokens = 0;
+        double seconds = 0; // spent in step()
+    };
+
+private:
+    struct Request {
+        std::vector<int64_t> tokens; // prompt then generated
+        size_t prompt, max_new;
+        int64_t seq = -1;
+        size_t cached = 0;  // tokens whose K/V the sequence holds
+        size_t reserve = 0; // blocks the request may grow to
+        bool finished = false;
+    };
+
+    Qwen2Model &_model;
+    std::map<int64_t, Request> _requests;
+    std::deque<int64_t> _waiting;
+    std::vector<int64_t> _running;
+    int64_t _next_id = 0;
+    Stats _stats;
+    // reused by every step
+    std::vector<Qwen2Model::Chunk> _chunks;
+    std::vector<int64_t> _chunk_ids, _next;
+
+    // Starts the sequence of r if the pool can hold all of it.
+    bool admit(Request &r);
+    void finish(Request &r);
+
+public:
+    explicit Qwen2Scheduler(Qwen2Model &model);
+    ~Qwen2Scheduler();
+    Qwen2Scheduler(const Qwen2Scheduler &) = delete;
+    Qwen2Scheduler &operator=(const Qwen2Scheduler &) = delete;
+
+    // A request generating up to max_new_tokens (> 0, capped at maxseq - n
+    // unless streaming) after tokens[0, n); it reserves the KV blocks for all
+    // of them, or for a streamed sequence's sink and window. Returns its id.
+    int64_t enqueue(const int64_t *tokens, size_t n, size_t max_new_tokens);
+    // One batched forward over the running requests. Returns how many
+    // requests are not finished yet. Throws if nothing is running and the
+    // next request still cannot be admitted: blocks held outside the
+    // scheduler keep it out, and no step would ever free them.
+    size_t step();
+    // Copies up to `capacity` of the tokens generated so far for `request`
+    // and returns how many there are. `done` is set once it has finished; a
+    // finished request is forgotten once all its tokens have been copied.
+    size_t poll(int64_t request, int64_t *tokens, size_t capacity, bool &done);
+    const Stats &stats() const;
+};
+} // namespace llaisys::models
@@ -0,0 +1,49 @@
+#include "speculative.hpp"
+
+#include "../../utils.hpp"
+
+#include <algorithm>
+
+namespace llaisys::models {
+namespace {
+uint64_t hashNgram(const int64_t *tokens, size_t n) {
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < n; ++i) {
+        h = (h ^ static_cast<uint64_t>(tokens[i])) * 1099511628211ull;
+    }
+    return h;
+}
+} // namespace
+
+PromptLookup::PromptLookup(size_t max_ngram, size_t min_ngram)
+    : _min_ngram(min_ngram), _max_ngram(max_ngram), _tables(max_ngram - min_ngram + 1) {
+    CHECK_ARGUMENT(min_ngram > 0 && min_ngram <= max_ngram, "PromptLookup: need 0 < min_ngram <= max_ngram.");
+}
+
+size_t PromptLookup::propose(const int64_t *history, size_t n, size_t k, int64_t *out) {
+    // index the n-grams ending right before each position whose token is known
+    for (size_t p = _indexed; p < n; ++p) {
+        for (size_t g = _min_ngram; g <= std::min(_max_ngram, p); ++g) {
+            _tables[g - _min_ngram][hashNgram(history + p - g, g)] = p;
+        }
+    }
+    _indexed = std::max(_indexed, n);
+
+    for (size_t g = std::min(_max_ngram, n); g >= _min_ngram; --g) {
+        const int64_t *tail = history + n - g;
+        const auto &table = _tables[g - _min_ngram];
+        auto it = table.find(hashNgram(tail, g));
+        if (it == table.end() || !std::equal(tail, tail + g, history + it->second - g)) {
+            continue;
+        }
+        // a continuation running into the tail repeats it: history + out is
+        // read as one sequence, so periodic text is proposed k tokens deep
+        const size_t p = it->second;
+        for (size_t i = 0; i < k; ++i) {
+            out[i] = p + i < n ? history[p + i] : out[p + i - n];
+        }
+        return k;
+    }
+    return 0;
+}
+} // namespace llaisys::models
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace llaisys::models {
+// Draft tokens from prompt lookup: the continuation of the most recent earlier
+// occurrence of the history's last n-gram, trying the longest n first. It
+// costs no model at all and pays off whenever the output repeats its context
+// (quoting, code edits, summaries).
+//
+// The history is only ever appended to between calls; n-grams are indexed
+// incrementally, once the token following them is known.
+class PromptLookup {
+private:
+    size_t _min_ngram, _max_ngram;
+    // per n - min_ngram: hash of an n-gram -> position after its last occurrence
+    std::vector<std::unordered_map<uint64_t, size_t>> _tables;
+    size_t _indexed = 1; // positions [1, _indexed) are in the tables
+
+public:
+    explicit PromptLookup(size_t max_ngram = 3, size_t min_ngram = 1);
+
+    // Writes up to `k` tokens likely to follow history[0, n) to `out` and
+    // returns how many; 0 if no n-gram matches.
+    size_t propose(const int64_t *history, size_t n, size_t k, int64_t *out);
+};
+} // namespace llaisys::models
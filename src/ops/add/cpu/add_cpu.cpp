@@ -2,14 +2,28 @@
 
 #include "../../../utils.hpp"
 
+#include <algorithm>
 #include <cmath>
 
+// Half-precision inputs are widened and the sums narrowed a tile at a time.
+constexpr size_t TILE = 256;
+
 template <typename T>
 void add_(T *c, const T *a, const T *b, size_t numel) {
-    for (size_t i = 0; i < numel; i++) {
-        if constexpr (std::is_same_v<T, llaisys::bf16_t> || std::is_same_v<T, llaisys::fp16_t>) {
-            c[i] = llaisys::utils::cast<T>(llaisys::utils::cast<float>(a[i]) + llaisys::utils::cast<float>(b[i]));
-        } else {
+    if constexpr (std::is_same_v<T, llaisys::bf16_t> || std::is_same_v<T, llaisys::fp16_t>) {
+        float fa[TILE];
+        float fb[TILE];
+        for (size_t i0 = 0; i0 < numel; i0 += TILE) {
+            const size_t n = std::min(TILE, numel - i0);
+            llaisys::utils::convert_n(fa, a + i0, n);
+            llaisys::utils::convert_n(fb, b + i0, n);
+            for (size_t i = 0; i < n; i++) {
+                fa[i] += fb[i];
+            }
+            llaisys::utils::convert_n(c + i0, fa, n);
+        }
+    } else {
+        for (size_t i = 0; i < numel; i++) {
             c[i] = a[i] + b[i];
         }
     }
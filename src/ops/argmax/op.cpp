@@ -1,5 +1,6 @@
 #include "op.hpp"
 #include "../../utils.hpp" // 注意：如果报错找不到头文件，尝试改为 "../utils.hpp"
+#include <algorithm>
 #include <limits>
 #include <iostream>
 
@@ -18,13 +19,18 @@ void argmax_cpu(tensor_t max_idx, tensor_t max_val, tensor_t vals) {
     float max_v = -std::numeric_limits<float>::infinity();
     int64_t max_i = 0;
 
-    // 4. 核心循环：打擂台找最大值
-    for (size_t i = 0; i < count; i++) {
-        // 关键点：统一转成 float 进行比较，避免半精度误差
-        float val = utils::cast<float>(vals_data[i]);
-        if (val > max_v) {
-            max_v = val;
-            max_i = i;
+    // 4. 核心循环：打擂台找最大值 (widened to float a tile at a time)
+    constexpr size_t TILE = 256;
+    float tile[TILE];
+    for (size_t i0 = 0; i0 < count; i0 += TILE) {
+        size_t len = std::min(TILE, count - i0);
+        utils::convert_n(tile, vals_data + i0, len);
+        for (size_t i = 0; i < len; i++) {
+            // 关键点：统一转成 float 进行比较，避免半精度误差
+            if (tile[i] > max_v) {
+                max_v = tile[i];
+                max_i = i0 + i;
+            }
         }
     }
 
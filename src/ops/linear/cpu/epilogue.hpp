@@ -0,0 +1,138 @@
+#pragma once
+#include "llaisys.h"
+
+#include "../../../utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// What happens to the float accumulators of linear on their way to memory.
+//
+// Accumulator column j (= weight row j) becomes v = acc * scale[j] + bias[j];
+// the activation maps v to y, and the residual row is added last:
+// out[i, j] = act(v) + residual[i, j]. Everything is applied to a tile that is
+// still hot in cache, so the output is written exactly once.
+namespace llaisys::ops::cpu::gemm {
+// Gate and up projections stacked for SWIGLU alternate in blocks of this many
+// rows: [gate 0..31, up 0..31, gate 32..63, up 32..63, ...]; the final pair may
+// be shorter. Tiles of the GEMM and GEMV are aligned to whole pairs.
+constexpr size_t GATE_UP_BLOCK = 32;
+
+enum class Activation {
+    NONE,
+    RELU,
+    SILU,
+    GELU,   // tanh approximation
+    SWIGLU, // out[:, j] = silu(gate_j) * up_j over a GATE_UP_BLOCK-stacked weight, N / 2 columns
+};
+
+template <typename T>
+struct Epilogue {
+    const float *scale = nullptr; // per weight row, e.g. INT8 channel scales
+    const T *bias = nullptr;      // per weight row
+    Activation act = Activation::NONE;
+    const T *residual = nullptr; // [M, output columns], may be the output itself
+    size_t ldr = 0;              // row stride of residual in elements
+
+    // The same epilogue for a tile starting at weight row j and output row i.
+    Epilogue at(size_t j, size_t i = 0) const;
+};
+
+// Output column of weight row j (which must start a gate/up pair for SWIGLU).
+inline size_t output_col(Activation act, size_t j) {
+    return act == Activation::SWIGLU ? j / 2 : j;
+}
+
+template <typename T>
+Epilogue<T> Epilogue<T>::at(size_t j, size_t i) const {
+    return {scale ? scale + j : nullptr,
+            bias ? bias + j : nullptr,
+            act,
+            residual ? residual + i * ldr + output_col(act, j) : nullptr,
+            ldr};
+}
+
+inline float silu(float x) {
+    return x / (1.0f + std::exp(-x));
+}
+
+inline float activate(Activation act, float x) {
+    switch (act) {
+    case Activation::RELU:
+        return x > 0.0f ? x : 0.0f;
+    case Activation::SILU:
+        return silu(x);
+    case Activation::GELU:
+        return 0.5f * x * (1.0f + std::tanh(0.7978845608f * (x + 0.044715f * x * x * x)));
+    default:
+        return x;
+    }
+}
+
+// c[mc, output_col(nc)] <- epilogue(acc[mc, nc]). For SWIGLU the tile must
+// cover whole gate/up pairs, only the last of which may be short. `c` may be
+// `acc` itself or the residual, element for element. Rows are finished in
+// float runs of up to 2 * GATE_UP_BLOCK columns and narrowed with one
+// convert_n call per run.
+template <typename T, typename TC>
+void store_tile(TC *c, size_t ldc, const float *acc, size_t ldacc, const Epilogue<T> &ep, size_t mc, size_t nc) {
+    constexpr size_t RUN = 2 * GATE_UP_BLOCK;
+    float bias[RUN];
+    float y[RUN];
+    float res[RUN];
+
+    // v = acc * scale + bias for columns [j0, j0 + len) of row i, into `v`
+    auto value = [&](float *v, size_t i, size_t j0, size_t len) {
+        const float *a = acc + i * ldacc + j0;
+        for (size_t j = 0; j < len; ++j) {
+            v[j] = ep.scale ? a[j] * ep.scale[j0 + j] : a[j];
+        }
+        if (ep.bias) {
+            utils::convert_n(bias, ep.bias + j0, len);
+            for (size_t j = 0; j < len; ++j) {
+                v[j] += bias[j];
+            }
+        }
+    };
+    // out[i, o0 + j] = y[j] + residual[i, o0 + j]
+    auto store = [&](size_t i, size_t o0, size_t len) {
+        if (ep.residual) {
+            utils::convert_n(res, ep.residual + i * ep.ldr + o0, len);
+            for (size_t j = 0; j < len; ++j) {
+                y[j] += res[j];
+            }
+        }
+        utils::convert_n(c + i * ldc + o0, y, len);
+    };
+
+    if (ep.act == Activation::SWIGLU) {
+        float up[GATE_UP_BLOCK];
+        for (size_t q = 0; q < nc;) {
+            const size_t w = std::min(GATE_UP_BLOCK, (nc - q) / 2);
+            for (size_t i = 0; i < mc; ++i) {
+                value(y, i, q, w);
+                value(up, i, q + w, w);
+                for (size_t j = 0; j < w; ++j) {
+                    y[j] = silu(y[j]) * up[j];
+                }
+                store(i, q / 2, w);
+            }
+            q += 2 * w;
+        }
+        return;
+    }
+    for (size_t i = 0; i < mc; ++i) {
+        for (size_t j0 = 0; j0 < nc; j0 += RUN) {
+            const size_t len = std::min(RUN, nc - j0);
+            value(y, i, j0, len);
+            if (ep.act != Activation::NONE) {
+                for (size_t j = 0; j < len; ++j) {
+                    y[j] = activate(ep.act, y[j]);
+                }
+            }
+            store(i, j0, len);
+        }
+    }
+}
+} // namespace llaisys::ops::cpu::gemm
@@ -0,0 +1,642 @@
+#include "gemm.hpp"
+
+#include "../../../device/cpu/cpu_thread_pool.hpp"
+#include "../../../utils.hpp"
+#include "../../../utils/simd.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AMX_TILE__) && defined(__AMX_BF16__) && defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef ARCH_REQ_XCOMP_PERM
+#define ARCH_REQ_XCOMP_PERM 0x1023
+#endif
+#ifndef XFEATURE_XTILEDATA
+#define XFEATURE_XTILEDATA 18
+#endif
+#endif
+
+namespace llaisys::ops::cpu::gemm {
+namespace simd = llaisys::utils::simd;
+
+namespace {
+constexpr size_t NV = NR / simd::VL; // vectors per micro-tile row
+static_assert(NR % simd::VL == 0, "NR must be a multiple of the vector length");
+
+// Rows of C accumulated in a float workspace at a time when C is half precision.
+constexpr size_t MB = 1024;
+
+// B panels stay in the storage type, except int8 codes, which are widened once
+// per packed block instead of on every micro-kernel pass over the block.
+template <typename TB>
+using panel_t = std::conditional_t<std::is_same_v<TB, int8_t>, float, TB>;
+
+// acc[MR x NR] = sum_k ap[k][MR] (x) bp[k][NR]; stored to (or added into) c.
+template <typename TB>
+void micro_kernel(size_t kc, const float *ap, const TB *bp, float *c, size_t ldc, bool accumulate) {
+    simd::vec_t acc[MR][NV];
+    for (size_t r = 0; r < MR; ++r) {
+        for (size_t v = 0; v < NV; ++v) {
+            acc[r][v] = simd::zero();
+        }
+    }
+
+    for (size_t p = 0; p < kc; ++p) {
+        simd::vec_t b[NV];
+        for (size_t v = 0; v < NV; ++v) {
+            b[v] = simd::load(bp + v * simd::VL);
+        }
+        for (size_t r = 0; r < MR; ++r) {
+            simd::vec_t a = simd::set1(ap[r]);
+            for (size_t v = 0; v < NV; ++v) {
+                acc[r][v] = simd::fmadd(a, b[v], acc[r][v]);
+            }
+        }
+        ap += MR;
+        bp += NR;
+    }
+
+    for (size_t r = 0; r < MR; ++r) {
+        for (size_t v = 0; v < NV; ++v) {
+            float *dst = c + r * ldc + v * simd::VL;
+            simd::store(dst, accumulate ? simd::add(acc[r][v], simd::load(dst)) : acc[r][v]);
+        }
+    }
+}
+
+// c[mr, nr] (=|+=) the top-left corner of a full scratch tile.
+void add_tile(float *c, size_t ldc, const float *tile, size_t ldt, bool accumulate, size_t mr, size_t nr) {
+    for (size_t r = 0; r < mr; ++r) {
+        for (size_t j = 0; j < nr; ++j) {
+            c[r * ldc + j] = accumulate ? c[r * ldc + j] + tile[r * ldt + j] : tile[r * ldt + j];
+        }
+    }
+}
+
+// Partial tiles at the right/bottom edge go through a full-size scratch tile.
+// Packed panels are zero padded, so computing the full tile is always safe.
+template <typename TB>
+void edge_kernel(size_t kc, const float *ap, const TB *bp, float *c, size_t ldc, bool accumulate, size_t mr, size_t nr) {
+    alignas(64) float tile[MR * NR];
+    micro_kernel(kc, ap, bp, tile, NR, false);
+    add_tile(c, ldc, tile, NR, accumulate, mr, nr);
+}
+
+// ap[panel][k][MR] <- float(a[mc, kc]), rows past `mc` are zero.
+template <typename T>
+void pack_a(float *ap, const T *a, size_t lda, size_t mc, size_t kc) {
+    alignas(64) float row[KC];
+    for (size_t i = 0; i < mc; i += MR) {
+        size_t mr = std::min(MR, mc - i);
+        for (size_t r = 0; r < MR; ++r) {
+            if (r < mr) {
+                const float *src = row;
+                if constexpr (std::is_same_v<T, float>) {
+                    src = a + (i + r) * lda;
+                } else {
+                    utils::convert_n(row, a + (i + r) * lda, kc);
+                }
+                for (size_t p = 0; p < kc; ++p) {
+                    ap[p * MR + r] = src[p];
+                }
+            } else {
+                for (size_t p = 0; p < kc; ++p) {
+                    ap[p * MR + r] = 0.0f;
+                }
+            }
+        }
+        ap += MR * kc;
+    }
+}
+
+// bp[panel][k][NR] <- b[nc, kc] as panel type TP, rows past `nc` are zero.
+template <typename TP, typename TB>
+void pack_b(TP *bp, const TB *b, size_t ldb, size_t nc, size_t kc) {
+    for (size_t j = 0; j < nc; j += NR) {
+        size_t nr = std::min(NR, nc - j);
+        for (size_t c = 0; c < NR; ++c) {
+            if (c < nr) {
+                const TB *row = b + (j + c) * ldb;
+                for (size_t p = 0; p < kc; ++p) {
+                    bp[p * NR + c] = static_cast<TP>(row[p]);
+                }
+            } else {
+                for (size_t p = 0; p < kc; ++p) {
+                    bp[p * NR + c] = TP{};
+                }
+            }
+        }
+        bp += NR * kc;
+    }
+}
+
+// pack_b for a row-major [kc, nc] B (element (j, p) at b[p * ldb + j]): panel
+// rows are contiguous in the source.
+template <typename TP, typename TB>
+void pack_b_nn(TP *bp, const TB *b, size_t ldb, size_t nc, size_t kc) {
+    for (size_t j = 0; j < nc; j += NR) {
+        const size_t nr = std::min(NR, nc - j);
+        for (size_t p = 0; p < kc; ++p) {
+            const TB *row = b + p * ldb + j;
+            TP *dst = bp + p * NR;
+            for (size_t c = 0; c < nr; ++c) {
+                dst[c] = static_cast<TP>(row[c]);
+            }
+            std::fill(dst + nr, dst + NR, TP{});
+        }
+        bp += NR * kc;
+    }
+}
+
+// How a block's products are formed: the packed element types, the packing
+// routines and the register tile (TILE_M x TILE_N, also the panel sizes).
+// `a_depth`/`b_depth` are the elements of one packed A row / B column of a
+// kc-deep block; begin()/end() bracket a thread's use of the kernel.
+//
+// FmaKernel: A widened to float, B panels in their storage type, float FMAs.
+template <typename TB>
+struct FmaKernel {
+    using a_t = float;
+    using b_t = panel_t<TB>;
+    static constexpr size_t TILE_M = MR;
+    static constexpr size_t TILE_N = NR;
+
+    static size_t a_depth(size_t kc) { return kc; }
+    static size_t b_depth(size_t kc) { return kc; }
+
+    static void begin() {}
+    static void end() {}
+
+    template <typename T>
+    static void pack_rows(float *ap, const T *a, size_t lda, size_t mc, size_t kc) {
+        pack_a(ap, a, lda, mc, kc);
+    }
+    static void pack_cols(b_t *bp, const TB *b, size_t ldb, size_t nc, size_t kc) {
+        pack_b(bp, b, ldb, nc, kc);
+    }
+    static void tile(size_t kc, const float *ap, const b_t *bp, float *c, size_t ldc, bool accumulate, size_t mr, size_t nr) {
+        if (mr == MR && nr == NR) {
+            micro_kernel(kc, ap, bp, c, ldc, accumulate);
+        } else {
+            edge_kernel(kc, ap, bp, c, ldc, accumulate, mr, nr);
+        }
+    }
+};
+
+#if defined(__AVX512BF16__)
+// bp[panel][kp][NR][2] <- b[nc, kc] as BF16 k-pairs, zero past nc and kc.
+void pack_b_pairs(bf16_t *bp, const bf16_t *b, size_t ldb, size_t nc, size_t kc, size_t kp) {
+    for (size_t j = 0; j < nc; j += NR) {
+        const size_t nr = std::min(NR, nc - j);
+        for (size_t c = 0; c < NR; ++c) {
+            const bf16_t *col = c < nr ? b + (j + c) * ldb : nullptr;
+            const size_t full = col ? kc / 2 : 0;
+            for (size_t q = 0; q < full; ++q) {
+                std::memcpy(bp + (q * NR + c) * 2, col + 2 * q, 2 * sizeof(bf16_t));
+            }
+            for (size_t q = full; q < kp; ++q) {
+                bf16_t *dst = bp + (q * NR + c) * 2;
+                dst[0] = col && 2 * q < kc ? col[2 * q] : bf16_t{0};
+                dst[1] = bf16_t{0};
+            }
+        }
+        bp += NR * 2 * kp;
+    }
+}
+
+// row[0, kp) <- a[0, kc) rounded to BF16, zero padded.
+template <typename T>
+void round_row(bf16_t *row, const T *a, size_t kc, size_t kp) {
+    if constexpr (std::is_same_v<T, bf16_t>) {
+        std::memcpy(row, a, kc * sizeof(bf16_t));
+    } else {
+        alignas(64) float wide[KC];
+        utils::convert_n(wide, a, kc);
+        utils::convert_n(row, wide, kc);
+    }
+    std::fill(row + kc, row + kp, bf16_t{0});
+}
+
+// Bf16DotKernel: A rounded to BF16 and packed as k-pairs (one 32-bit word per
+// row and pair), B packed by pack_b_pairs. VDPBF16PS multiplies a broadcast A
+// pair with the B pairs of 16 columns and adds both products to float
+// accumulators.
+struct Bf16DotKernel {
+    using a_t = uint32_t;
+    using b_t = bf16_t;
+    static constexpr size_t TILE_M = MR;
+    static constexpr size_t TILE_N = NR;
+    static_assert(NR == 2 * simd::VL, "the BF16 dot kernel is written for AVX-512 tiles");
+
+    static size_t a_depth(size_t kc) { return (kc + 1) / 2; }
+    static size_t b_depth(size_t kc) { return (kc + 1) / 2 * 2; }
+
+    static void begin() {}
+    static void end() {}
+
+    template <typename T>
+    static void pack_rows(uint32_t *ap, const T *a, size_t lda, size_t mc, size_t kc) {
+        const size_t kp = a_depth(kc);
+        alignas(64) bf16_t row[KC];
+        for (size_t i = 0; i < mc; i += MR) {
+            const size_t mr = std::min(MR, mc - i);
+            for (size_t r = 0; r < MR; ++r) {
+                if (r < mr) {
+                    round_row(row, a + (i + r) * lda, kc, 2 * kp);
+                    for (size_t q = 0; q < kp; ++q) {
+                        std::memcpy(ap + q * MR + r, row + 2 * q, sizeof(uint32_t));
+                    }
+                } else {
+                    for (size_t q = 0; q < kp; ++q) {
+                        ap[q * MR + r] = 0;
+                    }
+                }
+            }
+            ap += MR * kp;
+        }
+    }
+    static void pack_cols(bf16_t *bp, const bf16_t *b, size_t ldb, size_t nc, size_t kc) {
+        pack_b_pairs(bp, b, ldb, nc, kc, a_depth(kc));
+    }
+
+    // acc[MR x NR] = sum_q ap[q][MR] (x) bp[q][NR][2]; stored to (or added into) c.
+    static void micro_kernel(size_t kp, const uint32_t *ap, const bf16_t *bp, float *c, size_t ldc, bool accumulate) {
+        __m512 acc[MR][2];
+        for (size_t r = 0; r < MR; ++r) {
+            acc[r][0] = _mm512_setzero_ps();
+            acc[r][1] = _mm512_setzero_ps();
+        }
+        for (size_t q = 0; q < kp; ++q) {
+            const __m512bh b0 = (__m512bh)_mm512_loadu_si512(bp);
+            const __m512bh b1 = (__m512bh)_mm512_loadu_si512(bp + NR);
+            for (size_t r = 0; r < MR; ++r) {
+                const __m512bh a = (__m512bh)_mm512_set1_epi32(static_cast<int>(ap[r]));
+                acc[r][0] = _mm512_dpbf16_ps(acc[r][0], a, b0);
+                acc[r][1] = _mm512_dpbf16_ps(acc[r][1], a, b1);
+            }
+            ap += MR;
+            bp += 2 * NR;
+        }
+        for (size_t r = 0; r < MR; ++r) {
+            for (size_t v = 0; v < 2; ++v) {
+                float *dst = c + r * ldc + v * simd::VL;
+                simd::store(dst, accumulate ? simd::add(acc[r][v], simd::load(dst)) : acc[r][v]);
+            }
+        }
+    }
+    static void tile(size_t kc, const uint32_t *ap, const bf16_t *bp, float *c, size_t ldc, bool accumulate, size_t mr, size_t nr) {
+        if (mr == MR && nr == NR) {
+            return micro_kernel(a_depth(kc), ap, bp, c, ldc, accumulate);
+        }
+        alignas(64) float scratch[MR * NR];
+        micro_kernel(a_depth(kc), ap, bp, scratch, NR, false);
+        add_tile(c, ldc, scratch, NR, accumulate, mr, nr);
+    }
+};
+
+#if defined(__AMX_TILE__) && defined(__AMX_BF16__) && defined(__linux__)
+// AmxKernel: a 32 x 32 register tile held in four 16 x 16 float AMX tiles.
+// A panels are BF16 rows padded to whole 32-element k steps (loaded as two
+// 16 x 32 tiles), B panels are pack_b_pairs output, which is exactly the
+// pair-interleaved layout TDPBF16PS takes for its second operand. Each
+// TDPBF16PS does 16 x 16 x 32 multiply-adds.
+struct AmxKernel {
+    using a_t = bf16_t;
+    using b_t = bf16_t;
+    static constexpr size_t TILE_M = 32;
+    static constexpr size_t TILE_N = 32;
+    static constexpr size_t KSTEP = 32;
+    static_assert(NR == TILE_N, "AMX B panels are pack_b_pairs panels");
+    static_assert(MC % TILE_M == 0 && KC % KSTEP == 0, "AMX tiles must divide the cache blocks");
+
+    static size_t a_depth(size_t kc) { return (kc + KSTEP - 1) / KSTEP * KSTEP; }
+    static size_t b_depth(size_t kc) { return a_depth(kc); }
+
+    // Linux hands out the AMX register state per process on request.
+    static bool available() {
+        static const bool granted = syscall(SYS_arch_prctl, ARCH_REQ_XCOMP_PERM, XFEATURE_XTILEDATA) == 0;
+        return granted;
+    }
+    // Tile configuration is per thread: every tile is 16 rows of 64 bytes.
+    static void begin() {
+        struct alignas(64) {
+            uint8_t palette = 1;
+            uint8_t start_row = 0;
+            uint8_t reserved[14] = {};
+            uint16_t colsb[16] = {64, 64, 64, 64, 64, 64, 64, 64};
+            uint8_t rows[16] = {16, 16, 16, 16, 16, 16, 16, 16};
+        } config;
+        _tile_loadconfig(&config);
+    }
+    static void end() { _tile_release(); }
+
+    template <typename T>
+    static void pack_rows(bf16_t *ap, const T *a, size_t lda, size_t mc, size_t kc) {
+        const size_t kp = a_depth(kc);
+        for (size_t r = 0; r < (mc + TILE_M - 1) / TILE_M * TILE_M; ++r) {
+            if (r < mc) {
+                round_row(ap + r * kp, a + r * lda, kc, kp);
+            } else {
+                std::fill(ap + r * kp, ap + (r + 1) * kp, bf16_t{0});
+            }
+        }
+    }
+    static void pack_cols(bf16_t *bp, const bf16_t *b, size_t ldb, size_t nc, size_t kc) {
+        pack_b_pairs(bp, b, ldb, nc, kc, b_depth(kc) / 2);
+    }
+
+    // c[32 x 32] (=|+=) ap[32][kp] * bp[kp / 2][32][2]; ldc in floats.
+    static void micro_kernel(size_t kp, const bf16_t *ap, const bf16_t *bp, float *c, size_t ldc, bool accumulate) {
+        const size_t lda = kp * sizeof(bf16_t);
+        const size_t ldb = 2 * NR * sizeof(bf16_t);
+        const size_t ldcb = ldc * sizeof(float);
+        if (accumulate) {
+            _tile_loadd(0, c, ldcb);
+            _tile_loadd(1, c + 16, ldcb);
+            _tile_loadd(2, c + 16 * ldc, ldcb);
+            _tile_loadd(3, c + 16 * ldc + 16, ldcb);
+        } else {
+            _tile_zero(0);
+            _tile_zero(1);
+            _tile_zero(2);
+            _tile_zero(3);
+        }
+        for (size_t p = 0; p < kp; p += KSTEP) {
+            _tile_loadd(4, ap + p, lda);
+            _tile_loadd(5, ap + 16 * kp + p, lda);
+            _tile_loadd(6, bp + p * NR, ldb);
+            _tile_loadd(7, bp + p * NR + 32, ldb);
+            _tile_dpbf16ps(0, 4, 6);
+            _tile_dpbf16ps(1, 4, 7);
+            _tile_dpbf16ps(2, 5, 6);
+            _tile_dpbf16ps(3, 5, 7);
+        }
+        _tile_stored(0, c, ldcb);
+        _tile_stored(1, c + 16, ldcb);
+        _tile_stored(2, c + 16 * ldc, ldcb);
+        _tile_stored(3, c + 16 * ldc + 16, ldcb);
+    }
+    static void tile(size_t kc, const bf16_t *ap, const bf16_t *bp, float *c, size_t ldc, bool accumulate, size_t mr, size_t nr) {
+        if (mr == TILE_M && nr == TILE_N) {
+            return micro_kernel(a_depth(kc), ap, bp, c, ldc, accumulate);
+        }
+        alignas(64) float scratch[TILE_M * TILE_N];
+        micro_kernel(a_depth(kc), ap, bp, scratch, TILE_N, false);
+        add_tile(c, ldc, scratch, TILE_N, accumulate, mr, nr);
+    }
+};
+#endif
+#endif
+
+// One thread's share of the product: all of the blocking happens in here.
+// With `b_packed`, b is already in pack_b_panels layout (starting at this
+// block's first panel) and the B packing step is skipped entirely.
+// `c` points at the output column of weight row 0 of this block.
+template <typename K, typename T, typename TB>
+void gemm_block(T *c, size_t ldc,
+                const T *a, size_t lda,
+                const TB *b, size_t ldb, bool b_packed,
+                const Epilogue<T> &ep,
+                size_t m, size_t n, size_t k) {
+    // Plain float output is accumulated in place; anything else goes through a
+    // float workspace of at most MB x NC so the epilogue (and the rounding to
+    // half precision) happens exactly once per element. A residual may alias
+    // the output, so it must not be overwritten by partial sums either.
+    bool direct = false;
+    if constexpr (std::is_same_v<T, float>) {
+        direct = ep.act == Activation::NONE && !ep.residual;
+    }
+
+    using TA = typename K::a_t;
+    using TP = typename K::b_t;
+    thread_local std::vector<TA> apack;
+    thread_local std::vector<TP> bpack;
+    thread_local std::vector<float> cbuf;
+    apack.resize(MC * KC);
+    if (!b_packed) {
+        bpack.resize(KC * NC);
+    }
+
+    const size_t mb = direct ? m : std::min(m, MB);
+    if (!direct) {
+        cbuf.resize(mb * NC);
+    }
+    K::begin();
+
+    for (size_t i0 = 0; i0 < m; i0 += mb) {
+        const size_t mrows = std::min(mb, m - i0);
+        for (size_t jc = 0; jc < n; jc += NC) {
+            const size_t nc = std::min(NC, n - jc);
+            float *cacc = cbuf.data();
+            size_t ldacc = nc;
+            if constexpr (std::is_same_v<T, float>) {
+                if (direct) {
+                    cacc = c + i0 * ldc + jc;
+                    ldacc = ldc;
+                }
+            }
+
+            for (size_t pc = 0; pc < k; pc += KC) {
+                const size_t kc = std::min(KC, k - pc);
+                if (!b_packed) {
+                    K::pack_cols(bpack.data(), b + jc * ldb + pc, ldb, nc, kc);
+                }
+
+                for (size_t ic = 0; ic < mrows; ic += MC) {
+                    const size_t mc = std::min(MC, mrows - ic);
+                    K::pack_rows(apack.data(), a + (i0 + ic) * lda + pc, lda, mc, kc);
+
+                    for (size_t jr = 0; jr < nc; jr += K::TILE_N) {
+                        const size_t nr = std::min(K::TILE_N, nc - jr);
+                        const TP *bp = bpack.data() + jr * K::b_depth(kc);
+                        if constexpr (std::is_same_v<TP, TB>) {
+                            if (b_packed) {
+                                bp = b + (jc + jr) * k + pc * NR;
+                            }
+                        }
+                        for (size_t ir = 0; ir < mc; ir += K::TILE_M) {
+                            const size_t mr = std::min(K::TILE_M, mc - ir);
+                            const TA *ap = apack.data() + ir * K::a_depth(kc);
+                            float *cp = cacc + (ic + ir) * ldacc + jr;
+                            K::tile(kc, ap, bp, cp, ldacc, pc > 0, mr, nr);
+                        }
+                    }
+                }
+            }
+
+            const Epilogue<T> tile_ep = ep.at(jc, i0);
+            if (!direct) {
+                store_tile(c + i0 * ldc + output_col(ep.act, jc), ldc, cacc, ldacc, tile_ep, mrows, nc);
+            } else if (tile_ep.scale || tile_ep.bias) {
+                store_tile(cacc, ldacc, cacc, ldacc, tile_ep, mrows, nc);
+            }
+        }
+    }
+    K::end();
+}
+
+template <typename K, typename T, typename TB>
+void gemm_parallel(T *c, size_t ldc,
+                   const T *a, size_t lda,
+                   const TB *b, size_t ldb, bool b_packed,
+                   const Epilogue<T> &ep,
+                   size_t m, size_t n, size_t k) {
+    if (k == 0) {
+        std::vector<float> zeros(n, 0.0f);
+        for (size_t i = 0; i < m; ++i) {
+            store_tile(c + i * ldc, ldc, zeros.data(), 0, ep.at(0, i), 1, n);
+        }
+        return;
+    }
+
+    // Split C into a grid of independent blocks, NR-aligned columns first since
+    // N is the large dimension of every projection, then MR-aligned rows when
+    // there are fewer column blocks than threads. SWIGLU blocks hold whole
+    // gate/up pairs.
+    const size_t align = ep.act == Activation::SWIGLU ? std::max(NR, 2 * GATE_UP_BLOCK) : NR;
+    const size_t nthread = device::cpu::threadPool().size();
+    const size_t col_blocks = std::max<size_t>(1, std::min(nthread, (n + align - 1) / align));
+    const size_t mr = K::TILE_M;
+    const size_t row_blocks = std::max<size_t>(1, std::min(nthread / col_blocks, (m + mr - 1) / mr));
+    const size_t ncols = (n + col_blocks * align - 1) / (col_blocks * align) * align;
+    const size_t nrows = (m + row_blocks * mr - 1) / (row_blocks * mr) * mr;
+
+    device::cpu::threadPool().run(col_blocks * row_blocks, [&](size_t task) {
+        const size_t j0 = (task % col_blocks) * ncols;
+        const size_t i0 = (task / col_blocks) * nrows;
+        if (j0 >= n || i0 >= m) {
+            return;
+        }
+        // packed panels are NR * k elements each, and j0 is a multiple of NR
+        const TB *bj = b_packed ? b + j0 * k : b + j0 * ldb;
+        gemm_block<K>(c + i0 * ldc + output_col(ep.act, j0), ldc,
+                   a + i0 * lda, lda,
+                   bj, ldb, b_packed,
+                   ep.at(j0, i0),
+                   std::min(nrows, m - i0), std::min(ncols, n - j0), k);
+    });
+}
+} // namespace
+
+size_t packed_b_size(size_t n, size_t k) {
+    return (n + NR - 1) / NR * NR * k;
+}
+
+template <typename T>
+void pack_b_panels(T *dst, const T *b, size_t ldb, size_t n, size_t k) {
+    const size_t npanel = (n + NR - 1) / NR;
+    device::cpu::parallelFor(0, npanel, 1, [&](size_t p0, size_t p1) {
+        pack_b(dst + p0 * NR * k, b + p0 * NR * ldb, ldb, std::min(n, p1 * NR) - p0 * NR, k);
+    });
+}
+
+template <typename TB>
+void gemm_tile(float *c, size_t ldc, const float *a, size_t lda,
+               const TB *b, ptrdiff_t b_rs, ptrdiff_t b_cs,
+               size_t m, size_t n, size_t k, bool accumulate) {
+    using TP = panel_t<TB>;
+    thread_local std::vector<float> apack;
+    thread_local std::vector<TP> bpack;
+    const size_t npad = (n + NR - 1) / NR * NR;
+    const size_t mpad = (m + MR - 1) / MR * MR;
+    apack.resize(std::max(apack.size(), mpad * KC));
+    bpack.resize(std::max(bpack.size(), npad * KC));
+    if (k == 0 && !accumulate) {
+        for (size_t i = 0; i < m; ++i) {
+            std::fill(c + i * ldc, c + i * ldc + n, 0.0f);
+        }
+    }
+    for (size_t pc = 0; pc < k; pc += KC) {
+        const size_t kc = std::min(KC, k - pc);
+        if (b_cs == 1) {
+            pack_b(bpack.data(), b + pc, static_cast<size_t>(b_rs), n, kc);
+        } else {
+            pack_b_nn(bpack.data(), b + pc * b_cs, static_cast<size_t>(b_cs), n, kc);
+        }
+        pack_a(apack.data(), a + pc, lda, m, kc);
+        for (size_t jr = 0; jr < n; jr += NR) {
+            const size_t nr = std::min(NR, n - jr);
+            for (size_t ir = 0; ir < m; ir += MR) {
+                const size_t mr = std::min(MR, m - ir);
+                FmaKernel<TB>::tile(kc, apack.data() + ir * kc, bpack.data() + jr * kc,
+                                    c + ir * ldc + jr, ldc, accumulate || pc > 0, mr, nr);
+            }
+        }
+    }
+}
+
+template <typename T, typename TB>
+void gemm_nt(T *c, size_t ldc,
+             const T *a, size_t lda,
+             const TB *b, size_t ldb,
+             const Epilogue<T> &ep,
+             size_t m, size_t n, size_t k) {
+    gemm_parallel<FmaKernel<TB>>(c, ldc, a, lda, b, ldb, false, ep, m, n, k);
+}
+
+template <typename T, typename TB>
+void gemm_nt_packed(T *c, size_t ldc,
+                    const T *a, size_t lda,
+                    const TB *bp,
+                    const Epilogue<T> &ep,
+                    size_t m, size_t n, size_t k) {
+    gemm_parallel<FmaKernel<TB>>(c, ldc, a, lda, bp, 0, true, ep, m, n, k);
+}
+
+#if defined(__AVX512BF16__)
+template <typename T>
+void gemm_nt_bf16_dot(T *c, size_t ldc,
+                      const T *a, size_t lda,
+                      const bf16_t *b, size_t ldb,
+                      const Epilogue<T> &ep,
+                      size_t m, size_t n, size_t k) {
+#if defined(__AMX_TILE__) && defined(__AMX_BF16__) && defined(__linux__)
+    if (AmxKernel::available()) {
+        return gemm_parallel<AmxKernel>(c, ldc, a, lda, b, ldb, false, ep, m, n, k);
+    }
+#endif
+    gemm_parallel<Bf16DotKernel>(c, ldc, a, lda, b, ldb, false, ep, m, n, k);
+}
+
+template void gemm_nt_bf16_dot<float>(float *, size_t, const float *, size_t, const bf16_t *, size_t, const Epilogue<float> &, size_t, size_t, size_t);
+template void gemm_nt_bf16_dot<bf16_t>(bf16_t *, size_t, const bf16_t *, size_t, const bf16_t *, size_t, const Epilogue<bf16_t> &, size_t, size_t, size_t);
+#endif
+
+#define LLAISYS_GEMM_INSTANTIATE(T, TB) \
+    template void gemm_nt<T, TB>(T *, size_t, const T *, size_t, const TB *, size_t, const Epilogue<T> &, size_t, size_t, size_t);
+
+LLAISYS_GEMM_INSTANTIATE(float, float)
+LLAISYS_GEMM_INSTANTIATE(bf16_t, bf16_t)
+LLAISYS_GEMM_INSTANTIATE(fp16_t, fp16_t)
+LLAISYS_GEMM_INSTANTIATE(float, bf16_t)
+LLAISYS_GEMM_INSTANTIATE(float, fp16_t)
+LLAISYS_GEMM_INSTANTIATE(bf16_t, float)
+LLAISYS_GEMM_INSTANTIATE(fp16_t, float)
+LLAISYS_GEMM_INSTANTIATE(float, int8_t)
+LLAISYS_GEMM_INSTANTIATE(bf16_t, int8_t)
+LLAISYS_GEMM_INSTANTIATE(fp16_t, int8_t)
+#undef LLAISYS_GEMM_INSTANTIATE
+
+template void pack_b_panels<float>(float *, const float *, size_t, size_t, size_t);
+template void pack_b_panels<bf16_t>(bf16_t *, const bf16_t *, size_t, size_t, size_t);
+template void pack_b_panels<fp16_t>(fp16_t *, const fp16_t *, size_t, size_t, size_t);
+
+template void gemm_tile<float>(float *, size_t, const float *, size_t, const float *, ptrdiff_t, ptrdiff_t, size_t, size_t, size_t, bool);
+template void gemm_tile<bf16_t>(float *, size_t, const float *, size_t, const bf16_t *, ptrdiff_t, ptrdiff_t, size_t, size_t, size_t, bool);
+template void gemm_tile<fp16_t>(float *, size_t, const float *, size_t, const fp16_t *, ptrdiff_t, ptrdiff_t, size_t, size_t, size_t, bool);
+
+#define LLAISYS_GEMM_PACKED_INSTANTIATE(T, TB) \
+    template void gemm_nt_packed<T, TB>(T *, size_t, const T *, size_t, const TB *, const Epilogue<T> &, size_t, size_t, size_t);
+
+LLAISYS_GEMM_PACKED_INSTANTIATE(float, float)
+LLAISYS_GEMM_PACKED_INSTANTIATE(bf16_t, bf16_t)
+LLAISYS_GEMM_PACKED_INSTANTIATE(fp16_t, fp16_t)
+LLAISYS_GEMM_PACKED_INSTANTIATE(float, bf16_t)
+LLAISYS_GEMM_PACKED_INSTANTIATE(float, fp16_t)
+#undef LLAISYS_GEMM_PACKED_INSTANTIATE
+} // namespace llaisys::ops::cpu::gemm
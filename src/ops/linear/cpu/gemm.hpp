@@ -0,0 +1,92 @@
+#pragma once
+#include "llaisys.h"
+
+#include "epilogue.hpp"
+
+#include <cstddef>
+
+// Cache-blocked GEMM engine for CPU.
+//
+// Computes C[M, N] = epilogue(A[M, K] * B[N, K]^T), which is exactly the
+// layout of `linear` (weights are stored [out_features, in_features]).
+// The loop nest follows the usual Goto/BLIS structure:
+//
+//   jc (NC columns, B block in L3) -> pc (KC depth) -> ic (MC rows, A block in L2)
+//     -> jr (NR columns, B micro-panel in L1) -> ir (MR rows) -> micro-kernel
+//
+// A is packed into float MR-row panels, B is packed into NR-column panels in
+// its storage type and widened to float inside the micro-kernel, so the
+// half-precision types move half the bytes of float through the caches.
+// All accumulation is done in float.
+namespace llaisys::ops::cpu::gemm {
+#if defined(__AVX512F__)
+constexpr size_t MR = 8;
+constexpr size_t NR = 32;
+#elif defined(__AVX2__)
+constexpr size_t MR = 6;
+constexpr size_t NR = 16;
+#else
+constexpr size_t MR = 4;
+constexpr size_t NR = 8;
+#endif
+
+// AVX512_BF16 (VDPBF16PS) is available to the BF16 dot-product kernels.
+#if defined(__AVX512BF16__)
+constexpr bool HAS_BF16_DOT = true;
+#else
+constexpr bool HAS_BF16_DOT = false;
+#endif
+
+constexpr size_t KC = 256;
+constexpr size_t MC = MR * 16;
+constexpr size_t NC = NR * 32;
+
+// Row-major C = epilogue(A * B^T). `lda`, `ldb`, `ldc` are row strides in
+// elements and `n` counts rows of B; C has output_col(ep.act, n) columns.
+// B is stored as T, as float for any T (e.g. weights dequantized on the fly),
+// as BF16/F16 under float A and C (F32 activations over half-precision
+// weights), or as int8 codes, which are widened while packing each cache block so the
+// micro-kernel runs at float speed (pair these with `ep.scale`).
+template <typename T, typename TB>
+void gemm_nt(T *c, size_t ldc,
+             const T *a, size_t lda,
+             const TB *b, size_t ldb,
+             const Epilogue<T> &ep,
+             size_t m, size_t n, size_t k);
+
+// Weights can be packed once ahead of time so the hot path never packs B:
+// bp[ceil(n / NR)][k][NR], i.e. NR-column panels over the full depth, zero
+// padded past n. packed_b_size() is the element count of that buffer.
+size_t packed_b_size(size_t n, size_t k);
+
+template <typename T>
+void pack_b_panels(T *bp, const T *b, size_t ldb, size_t n, size_t k);
+
+// Same as gemm_nt with B given in pack_b_panels layout.
+template <typename T, typename TB>
+void gemm_nt_packed(T *c, size_t ldc,
+                    const T *a, size_t lda,
+                    const TB *bp,
+                    const Epilogue<T> &ep,
+                    size_t m, size_t n, size_t k);
+
+// Serial c[m, n] (=|+=) a[m, k] * B for small operands that are already in
+// cache, e.g. attention tiles: no threading and no epilogue, c and a are float.
+// B element (j, p) (output column j, depth p) is b[j * b_rs + p * b_cs], so
+// b_cs == 1 is the [n, k] layout of gemm_nt and b_rs == 1 a row-major [k, n].
+template <typename TB>
+void gemm_tile(float *c, size_t ldc, const float *a, size_t lda,
+               const TB *b, ptrdiff_t b_rs, ptrdiff_t b_cs,
+               size_t m, size_t n, size_t k, bool accumulate);
+
+// gemm_nt over BF16 weights with native BF16 products
+// (LLAISYS_PRECISION_BF16_DOT): A is rounded to BF16 while it is packed and
+// VDPBF16PS accumulates pairs of products in float. Only defined when
+// HAS_BF16_DOT; T is float or bf16_t.
+template <typename T>
+void gemm_nt_bf16_dot(T *c, size_t ldc,
+                      const T *a, size_t lda,
+                      const bf16_t *b, size_t ldb,
+                      const Epilogue<T> &ep,
+                      size_t m, size_t n, size_t k);
+} // namespace llaisys::ops::cpu::gemm
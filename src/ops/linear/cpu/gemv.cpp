@@ -0,0 +1,305 @@
+#include "gemv.hpp"
+
+#include "../../../device/cpu/cpu_thread_pool.hpp"
+#include "../../../utils.hpp"
+#include "../../../utils/simd.hpp"
+
+#include "gemm.hpp"
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+namespace llaisys::ops::cpu::gemm {
+namespace simd = llaisys::utils::simd;
+
+namespace {
+// Rows per task unit: a whole number of gate/up pairs and of packed panels, so
+// every unit runs the epilogue on its own rows only.
+constexpr size_t CHUNK = 2 * GATE_UP_BLOCK;
+static_assert(CHUNK % NR == 0, "gemv chunks must hold whole packed panels");
+// Rows computed together so each x vector loaded feeds several weight streams.
+constexpr size_t ROWS = 4;
+
+template <typename T>
+float dot_tail(const float *x, const T *w, size_t begin, size_t end) {
+    float sum = 0.0f;
+    for (size_t p = begin; p < end; ++p) {
+        sum += x[p] * utils::cast<float>(w[p]);
+    }
+    return sum;
+}
+
+// out[r] = dot(x, w[r]) for R rows of W.
+template <size_t R, typename TW>
+void dot_rows(float *out, const float *x, const TW *w, size_t ldw, size_t k) {
+    const size_t kv = k / (2 * simd::VL) * (2 * simd::VL);
+    simd::vec_t acc[R][2];
+    for (size_t r = 0; r < R; ++r) {
+        acc[r][0] = simd::zero();
+        acc[r][1] = simd::zero();
+    }
+    for (size_t p = 0; p < kv; p += 2 * simd::VL) {
+        simd::vec_t x0 = simd::load(x + p);
+        simd::vec_t x1 = simd::load(x + p + simd::VL);
+        for (size_t r = 0; r < R; ++r) {
+            const TW *row = w + r * ldw + p;
+            acc[r][0] = simd::fmadd(simd::load(row), x0, acc[r][0]);
+            acc[r][1] = simd::fmadd(simd::load(row + simd::VL), x1, acc[r][1]);
+        }
+    }
+    for (size_t r = 0; r < R; ++r) {
+        out[r] = simd::reduce_add(simd::add(acc[r][0], acc[r][1])) + dot_tail(x, w + r * ldw, kv, k);
+    }
+}
+
+// out[i - n0] = dot(x, w[i]) for rows [n0, n1).
+template <typename TW>
+void gemv_rows(float *out, const float *x, const TW *w, size_t ldw, size_t n0, size_t n1, size_t k) {
+    size_t i = n0;
+    for (; i + ROWS <= n1; i += ROWS) {
+        dot_rows<ROWS>(out + i - n0, x, w + i * ldw, ldw, k);
+    }
+    for (; i < n1; ++i) {
+        dot_rows<1>(out + i - n0, x, w + i * ldw, ldw, k);
+    }
+}
+
+// Same for a packed W; n0 is a multiple of NR, and the whole panels covering
+// [n0, n1) are computed (`out` has room for them).
+template <typename TW>
+void gemv_panels(float *out, const float *x, const TW *wp, size_t n0, size_t n1, size_t k) {
+    constexpr size_t NV = NR / simd::VL;
+    for (size_t p = n0 / NR; p * NR < n1; ++p) {
+        const TW *panel = wp + p * NR * k;
+        // two interleaved accumulator sets hide the FMA latency
+        simd::vec_t acc[2][NV];
+        for (size_t v = 0; v < NV; ++v) {
+            acc[0][v] = simd::zero();
+            acc[1][v] = simd::zero();
+        }
+        size_t q = 0;
+        for (; q + 2 <= k; q += 2) {
+            simd::vec_t x0 = simd::set1(x[q]);
+            simd::vec_t x1 = simd::set1(x[q + 1]);
+            for (size_t v = 0; v < NV; ++v) {
+                acc[0][v] = simd::fmadd(simd::load(panel + q * NR + v * simd::VL), x0, acc[0][v]);
+                acc[1][v] = simd::fmadd(simd::load(panel + (q + 1) * NR + v * simd::VL), x1, acc[1][v]);
+            }
+        }
+        for (; q < k; ++q) {
+            simd::vec_t x0 = simd::set1(x[q]);
+            for (size_t v = 0; v < NV; ++v) {
+                acc[0][v] = simd::fmadd(simd::load(panel + q * NR + v * simd::VL), x0, acc[0][v]);
+            }
+        }
+        for (size_t v = 0; v < NV; ++v) {
+            simd::store(out + p * NR - n0 + v * simd::VL, simd::add(acc[0][v], acc[1][v]));
+        }
+    }
+}
+
+#if defined(__AVX512BF16__)
+// out[r] = dot(x, w[r]) for R rows of BF16 W against a BF16 x, 32 pairs of
+// products per VDPBF16PS.
+template <size_t R>
+void dot_rows_bf16(float *out, const bf16_t *x, const bf16_t *w, size_t ldw, size_t k) {
+    constexpr size_t STEP = 2 * 32;
+    const size_t kv = k / STEP * STEP;
+    __m512 acc[R][2];
+    for (size_t r = 0; r < R; ++r) {
+        acc[r][0] = _mm512_setzero_ps();
+        acc[r][1] = _mm512_setzero_ps();
+    }
+    for (size_t p = 0; p < kv; p += STEP) {
+        const __m512bh x0 = (__m512bh)_mm512_loadu_si512(x + p);
+        const __m512bh x1 = (__m512bh)_mm512_loadu_si512(x + p + 32);
+        for (size_t r = 0; r < R; ++r) {
+            const bf16_t *row = w + r * ldw + p;
+            acc[r][0] = _mm512_dpbf16_ps(acc[r][0], (__m512bh)_mm512_loadu_si512(row), x0);
+            acc[r][1] = _mm512_dpbf16_ps(acc[r][1], (__m512bh)_mm512_loadu_si512(row + 32), x1);
+        }
+    }
+    for (size_t r = 0; r < R; ++r) {
+        float sum = simd::reduce_add(simd::add(acc[r][0], acc[r][1]));
+        for (size_t p = kv; p < k; ++p) {
+            sum += utils::cast<float>(x[p]) * utils::cast<float>(w[r * ldw + p]);
+        }
+        out[r] = sum;
+    }
+}
+
+void gemv_rows_bf16(float *out, const bf16_t *x, const bf16_t *w, size_t ldw, size_t n0, size_t n1, size_t k) {
+    size_t i = n0;
+    for (; i + ROWS <= n1; i += ROWS) {
+        dot_rows_bf16<ROWS>(out + i - n0, x, w + i * ldw, ldw, k);
+    }
+    for (; i < n1; ++i) {
+        dot_rows_bf16<1>(out + i - n0, x, w + i * ldw, ldw, k);
+    }
+}
+#endif
+
+// Rows unpacked together per x load; the per-group partial sums of every row
+// are independent FMA chains, which hides the latency of the short groups.
+constexpr size_t Q4_ROWS = simd::VL >= 16 ? 4 : 2;
+
+// out[r] = sum_g scale[g] * (dot(x_g, q_g) - zero[g] * sum(x_g)) for R rows from i
+template <size_t R>
+void gemv_q4_block(float *out, const float *x, const float *xsum, const quant::Q4Weight &w, size_t i, size_t k) {
+    constexpr size_t NV = quant::Q4_CHUNK / simd::VL;
+    const size_t gs = w.group_size;
+    const size_t ngroup = k / gs;
+    simd::vec_t acc[R];
+    float zsum[R];
+    for (size_t r = 0; r < R; ++r) {
+        acc[r] = simd::zero();
+        zsum[r] = 0.0f;
+    }
+    for (size_t g = 0; g < ngroup; ++g) {
+        simd::vec_t d[R][NV];
+        for (size_t r = 0; r < R; ++r) {
+            for (size_t v = 0; v < NV; ++v) {
+                d[r][v] = simd::zero();
+            }
+        }
+        for (size_t c = g * gs; c < (g + 1) * gs; c += quant::Q4_CHUNK) {
+            simd::vec_t xv[NV];
+            for (size_t v = 0; v < NV; ++v) {
+                xv[v] = simd::load(x + c + v * simd::VL);
+            }
+            for (size_t r = 0; r < R; ++r) {
+                simd::vec_t q[NV];
+                simd::load_q4x32(w.codes + ((i + r) * k + c) / 2, q);
+                for (size_t v = 0; v < NV; ++v) {
+                    d[r][v] = simd::fmadd(q[v], xv[v], d[r][v]);
+                }
+            }
+        }
+        for (size_t r = 0; r < R; ++r) {
+            for (size_t v = 1; v < NV; ++v) {
+                d[r][0] = simd::add(d[r][0], d[r][v]);
+            }
+            const size_t sg = (i + r) * ngroup + g;
+            const float s = utils::cast<float>(w.scales[sg]);
+            acc[r] = simd::fmadd(simd::set1(s), d[r][0], acc[r]);
+            zsum[r] += s * (w.zeros ? w.zeros[sg] : quant::Q4_ZERO) * xsum[g];
+        }
+    }
+    for (size_t r = 0; r < R; ++r) {
+        out[r] = simd::reduce_add(acc[r]) - zsum[r];
+    }
+}
+
+void gemv_q4_rows(float *out, const float *x, const float *xsum, const quant::Q4Weight &w, size_t n0, size_t n1, size_t k) {
+    size_t i = n0;
+    for (; i + Q4_ROWS <= n1; i += Q4_ROWS) {
+        gemv_q4_block<Q4_ROWS>(out + i - n0, x, xsum, w, i, k);
+    }
+    for (; i < n1; ++i) {
+        gemv_q4_block<1>(out + i - n0, x, xsum, w, i, k);
+    }
+}
+
+// x widened into the calling thread's scratch, followed by `extra` more
+// floats; the scratch only grows, so a warm GEMV allocates nothing. Tasks
+// must use the returned pointer: their own thread_local is another buffer.
+template <typename T>
+float *widen(const T *x, size_t k, size_t extra = 0) {
+    thread_local std::vector<float> xf;
+    xf.resize(std::max(xf.size(), k + extra));
+    utils::convert_n(xf.data(), x, k);
+    return xf.data();
+}
+
+// Splits the N weight rows into CHUNK-row units across the pool. `rows(out,
+// n0, n1)` leaves the raw dot products of rows [n0, n1) in a float buffer that
+// is still in L1 when the epilogue turns it into outputs.
+template <typename T, typename F>
+void gemv_drive(T *y, const Epilogue<T> &ep, size_t n, F &&rows) {
+    const size_t nchunk = (n + CHUNK - 1) / CHUNK;
+    device::cpu::parallelFor(0, nchunk, 1, [&](size_t c0, size_t c1) {
+        alignas(64) float sums[CHUNK];
+        for (size_t c = c0; c < c1; ++c) {
+            const size_t n0 = c * CHUNK;
+            const size_t n1 = std::min(n, n0 + CHUNK);
+            rows(sums, n0, n1);
+            store_tile(y + output_col(ep.act, n0), 0, sums, CHUNK, ep.at(n0), 1, n1 - n0);
+        }
+    });
+}
+} // namespace
+
+template <typename T, typename TW>
+void gemv_nt(T *y, const T *x, const TW *w, size_t ldw, const Epilogue<T> &ep, size_t n, size_t k) {
+    // x is widened once and shared read-only by every task.
+    const float *xf = widen(x, k);
+    gemv_drive(y, ep, n, [&](float *out, size_t n0, size_t n1) {
+        gemv_rows(out, xf, w, ldw, n0, n1, k);
+    });
+}
+
+template <typename T, typename TW>
+void gemv_nt_packed(T *y, const T *x, const TW *wp, const Epilogue<T> &ep, size_t n, size_t k) {
+    const float *xf = widen(x, k);
+    gemv_drive(y, ep, n, [&](float *out, size_t n0, size_t n1) {
+        gemv_panels(out, xf, wp, n0, n1, k);
+    });
+}
+
+template <typename T>
+void gemv_nt_q4(T *y, const T *x, const quant::Q4Weight &w, const Epilogue<T> &ep, size_t n, size_t k) {
+    // the group sums of x live right after it in the scratch
+    const size_t ngroup = k / w.group_size;
+    float *xf = widen(x, k, ngroup);
+    float *xsum = xf + k;
+    std::fill(xsum, xsum + ngroup, 0.0f);
+    for (size_t p = 0; p < k; ++p) {
+        xsum[p / w.group_size] += xf[p];
+    }
+    gemv_drive(y, ep, n, [&](float *out, size_t n0, size_t n1) {
+        gemv_q4_rows(out, xf, xsum, w, n0, n1, k);
+    });
+}
+
+#if defined(__AVX512BF16__)
+template <typename T>
+void gemv_nt_bf16_dot(T *y, const T *x, const bf16_t *w, size_t ldw, const Epilogue<T> &ep, size_t n, size_t k) {
+    // x is rounded to BF16 once, like every A row of the BF16 GEMM
+    thread_local std::vector<bf16_t> scratch;
+    scratch.resize(std::max(scratch.size(), k));
+    bf16_t *xb = scratch.data();
+    if constexpr (std::is_same_v<T, bf16_t>) {
+        std::copy(x, x + k, xb);
+    } else {
+        utils::convert_n(xb, widen(x, k), k);
+    }
+    gemv_drive(y, ep, n, [&](float *out, size_t n0, size_t n1) {
+        gemv_rows_bf16(out, xb, w, ldw, n0, n1, k);
+    });
+}
+
+template void gemv_nt_bf16_dot<float>(float *, const float *, const bf16_t *, size_t, const Epilogue<float> &, size_t, size_t);
+template void gemv_nt_bf16_dot<bf16_t>(bf16_t *, const bf16_t *, const bf16_t *, size_t, const Epilogue<bf16_t> &, size_t, size_t);
+#endif
+
+#define LLAISYS_GEMV_INSTANTIATE(T, TW)                                                                               \
+    template void gemv_nt<T, TW>(T *, const T *, const TW *, size_t, const Epilogue<T> &, size_t, size_t);           \
+    template void gemv_nt_packed<T, TW>(T *, const T *, const TW *, const Epilogue<T> &, size_t, size_t);
+
+LLAISYS_GEMV_INSTANTIATE(float, float)
+LLAISYS_GEMV_INSTANTIATE(bf16_t, bf16_t)
+LLAISYS_GEMV_INSTANTIATE(fp16_t, fp16_t)
+LLAISYS_GEMV_INSTANTIATE(float, bf16_t)
+LLAISYS_GEMV_INSTANTIATE(float, fp16_t)
+#undef LLAISYS_GEMV_INSTANTIATE
+
+#define LLAISYS_GEMV_QUANT_INSTANTIATE(T)                                                                            \
+    template void gemv_nt<T, int8_t>(T *, const T *, const int8_t *, size_t, const Epilogue<T> &, size_t, size_t);   \
+    template void gemv_nt_q4<T>(T *, const T *, const quant::Q4Weight &, const Epilogue<T> &, size_t, size_t);
+
+LLAISYS_GEMV_QUANT_INSTANTIATE(float)
+LLAISYS_GEMV_QUANT_INSTANTIATE(bf16_t)
+LLAISYS_GEMV_QUANT_INSTANTIATE(fp16_t)
+#undef LLAISYS_GEMV_QUANT_INSTANTIATE
+} // namespace llaisys::ops::cpu::gemm
@@ -0,0 +1,38 @@
+#pragma once
+#include "llaisys.h"
+
+#include "epilogue.hpp"
+#include "quant.hpp"
+
+#include <cstddef>
+
+// Matrix-vector product for single-row linear (the decode step).
+//
+// y = epilogue(W[N, K] * x[K]). This is bound by streaming W from memory, so
+// N is split across the CPU thread pool and every weight row is read exactly
+// once with vector FMAs against an x that stays in L1. y has
+// output_col(ep.act, n) elements.
+namespace llaisys::ops::cpu::gemm {
+// `ldw` is the row stride of W in elements. W is stored as T, as BF16/F16
+// under a float x and y, or as int8 codes widened in registers (weight-only
+// INT8, with per-row `ep.scale`), a quarter of the float bytes per token.
+template <typename T, typename TW>
+void gemv_nt(T *y, const T *x, const TW *w, size_t ldw, const Epilogue<T> &ep, size_t n, size_t k);
+
+// Same with W in gemm::pack_b_panels layout: each task walks whole NR-row
+// panels front to back, so the stream is still read once and no horizontal
+// reduction is needed.
+template <typename T, typename TW>
+void gemv_nt_packed(T *y, const T *x, const TW *wp, const Epilogue<T> &ep, size_t n, size_t k);
+
+// BF16 W against x rounded to BF16, multiplied with VDPBF16PS and summed in
+// float (see gemm_nt_bf16_dot). Only defined when HAS_BF16_DOT.
+template <typename T>
+void gemv_nt_bf16_dot(T *y, const T *x, const bf16_t *w, size_t ldw, const Epilogue<T> &ep, size_t n, size_t k);
+
+// 4-bit group quantized W (see quant::Q4Weight): nibbles are unpacked in
+// registers, each group's partial dot is scaled once, and the zero point is
+// folded in through per-group sums of x. An eighth of the float bytes per token.
+template <typename T>
+void gemv_nt_q4(T *y, const T *x, const quant::Q4Weight &w, const Epilogue<T> &ep, size_t n, size_t k);
+} // namespace llaisys::ops::cpu::gemm
@@ -0,0 +1,290 @@
+#include "linear_cpu.hpp"
+
+#include "../../../utils.hpp"
+
+#include "gemm.hpp"
+#include "gemv.hpp"
+#include "quant.hpp"
+
+#include "../../../device/cpu/cpu_thread_pool.hpp"
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+template <typename T>
+llaisys::ops::cpu::gemm::Epilogue<T> epilogue_(const llaisys::ops::cpu::LinearEpilogue &ep, const float *scale, size_t n) {
+    return {scale,
+            reinterpret_cast<const T *>(ep.bias),
+            ep.act,
+            reinterpret_cast<const T *>(ep.residual),
+            llaisys::ops::cpu::gemm::output_col(ep.act, n)};
+}
+
+template <typename T, typename TW>
+void linear_(T *out, const T *in, const TW *weight, const llaisys::ops::cpu::gemm::Epilogue<T> &ep,
+             size_t m, size_t n, size_t k, bool weight_packed, bool bf16_dot) {
+    using namespace llaisys::ops::cpu::gemm;
+#if defined(__AVX512BF16__)
+    if constexpr (std::is_same_v<TW, llaisys::bf16_t>) {
+        if (bf16_dot && !weight_packed) {
+            return m == 1 ? gemv_nt_bf16_dot(out, in, weight, k, ep, n, k)
+                          : gemm_nt_bf16_dot(out, output_col(ep.act, n), in, k, weight, k, ep, m, n, k);
+        }
+    }
+#endif
+    if (m == 1) {
+        // decode: memory bound, weights are streamed once without packing
+        return weight_packed ? gemv_nt_packed(out, in, weight, ep, n, k)
+                             : gemv_nt(out, in, weight, k, ep, n, k);
+    }
+    const size_t ldc = output_col(ep.act, n);
+    if (weight_packed) {
+        return gemm_nt_packed(out, ldc, in, k, weight, ep, m, n, k);
+    }
+    gemm_nt(out, ldc, in, k, weight, k, ep, m, n, k);
+}
+
+template <typename T>
+void linear_q8_(T *out, const T *in, const int8_t *weight, const llaisys::ops::cpu::gemm::Epilogue<T> &ep,
+                size_t m, size_t n, size_t k) {
+    using namespace llaisys::ops::cpu::gemm;
+    if (m == 1) {
+        return gemv_nt(out, in, weight, k, ep, n, k);
+    }
+    gemm_nt(out, output_col(ep.act, n), in, k, weight, k, ep, m, n, k);
+}
+
+template <typename T>
+void linear_q4_(T *out, const T *in, const llaisys::ops::cpu::quant::Q4Weight &weight,
+                const llaisys::ops::cpu::gemm::Epilogue<T> &ep, size_t m, size_t n, size_t k) {
+    using namespace llaisys::ops::cpu;
+    if (m == 1) {
+        return gemm::gemv_nt_q4(out, in, weight, ep, n, k);
+    }
+    // Prefill is compute bound: dequantize a slab of rows at a time (a few MB,
+    // aligned to panels and gate/up pairs) to float and run the regular GEMM on it.
+    const size_t align = std::max(gemm::NR, 2 * gemm::GATE_UP_BLOCK);
+    const size_t rows = std::max(align, (size_t(4) << 20) / (k * sizeof(float)) / align * align);
+    const size_t ldc = gemm::output_col(ep.act, n);
+    thread_local std::vector<float> slab;
+    slab.resize(std::min(rows, n) * k);
+    // the slab is the caller's: workers reach it through this pointer, not their own thread_local
+    float *buf = slab.data();
+    for (size_t j0 = 0; j0 < n; j0 += rows) {
+        const size_t nb = std::min(rows, n - j0);
+        llaisys::device::cpu::parallelFor(0, nb, 16, [&](size_t r0, size_t r1) {
+            quant::dequantize_q4(buf + r0 * k, weight, j0 + r0, j0 + r1, k);
+        });
+        gemm::gemm_nt(out + gemm::output_col(ep.act, j0), ldc, in, k, buf, k, ep.at(j0), m, nb, k);
+    }
+}
+
+namespace {
+// a column of the product and its value; as a heap under `worse`, the root is
+// the worst one kept: the smallest value, then the highest column
+using Candidate = std::pair<float, int64_t>;
+
+bool worse(const Candidate &a, const Candidate &b) {
+    return a.first > b.first || (a.first == b.first && a.second < b.second);
+}
+
+template <typename T>
+void linear_topk_(int64_t *out_idx, float *out_val, const llaisys::ops::cpu::LinearTile &tile, size_t m, size_t n,
+                  size_t topk) {
+    using llaisys::ops::cpu::gemm::NC;
+    const size_t ntile = (n + NC - 1) / NC;
+    const size_t nshard = std::min(llaisys::device::cpu::threadPool().size(), ntile);
+    // Every row of a shard sees the same columns, so all its heaps hold
+    // min(topk, columns so far) candidates; row i of shard s keeps them at
+    // part[(s * m + i) * topk]. Columns arrive in increasing order: one equal
+    // to the root is never better.
+    // The candidates are the caller's scratch, grown as needed: shards reach
+    // them through these pointers, never through their own thread_locals.
+    thread_local std::vector<Candidate> part_buf, merged;
+    thread_local std::vector<size_t> kept_buf;
+    part_buf.resize(std::max(part_buf.size(), nshard * m * topk));
+    kept_buf.resize(std::max(kept_buf.size(), nshard));
+    Candidate *part = part_buf.data();
+    size_t *kept = kept_buf.data();
+    const auto shard = [&](size_t s) {
+        thread_local std::vector<T> out;
+        thread_local std::vector<float> x;
+        out.resize(m * NC);
+        x.resize(NC);
+        const size_t j_end = std::min(n, ntile * (s + 1) / nshard * NC);
+        size_t c = 0;
+        for (size_t j0 = ntile * s / nshard * NC; j0 < j_end; j0 += NC) {
+            const size_t w = std::min(NC, j_end - j0);
+            tile(reinterpret_cast<std::byte *>(out.data()), j0, j0 + w);
+            size_t c_row = c;
+            for (size_t i = 0; i < m; ++i) {
+                Candidate *heap = part + (s * m + i) * topk;
+                llaisys::utils::convert_n(x.data(), out.data() + i * w, w);
+                c_row = c;
+                for (size_t j = 0; j < w; ++j) {
+                    if (c_row < topk) {
+                        heap[c_row++] = {x[j], static_cast<int64_t>(j0 + j)};
+                        std::push_heap(heap, heap + c_row, worse);
+                    } else if (x[j] > heap[0].first) {
+                        std::pop_heap(heap, heap + topk, worse);
+                        heap[topk - 1] = {x[j], static_cast<int64_t>(j0 + j)};
+                        std::push_heap(heap, heap + topk, worse);
+                    }
+                }
+            }
+            c = c_row;
+        }
+        kept[s] = c;
+    };
+    // one reference fits in the std::function, the capture list would be allocated
+    llaisys::device::cpu::threadPool().run(nshard, [&shard](size_t s) { shard(s); });
+
+    for (size_t i = 0; i < m; ++i) {
+        merged.clear();
+        for (size_t s = 0; s < nshard; ++s) {
+            const Candidate *heap = part + (s * m + i) * topk;
+            merged.insert(merged.end(), heap, heap + kept[s]);
+        }
+        std::partial_sort(merged.begin(), merged.begin() + topk, merged.end(), worse);
+        for (size_t t = 0; t < topk; ++t) {
+            out_val[i * topk + t] = merged[t].first;
+            out_idx[i * topk + t] = merged[t].second;
+        }
+    }
+}
+} // namespace
+
+namespace llaisys::ops::cpu {
+void linear(std::byte *out, const std::byte *in, const std::byte *weight, const LinearEpilogue &ep,
+            llaisysDataType_t type, llaisysDataType_t weight_type, size_t m, size_t n, size_t k,
+            bool weight_packed, bool bf16_dot) {
+    if (type == LLAISYS_DTYPE_F32 && weight_type != type) {
+        // F32 activations over half-precision weights
+        auto *y = reinterpret_cast<float *>(out);
+        const auto *x = reinterpret_cast<const float *>(in);
+        switch (weight_type) {
+        case LLAISYS_DTYPE_BF16:
+            return linear_(y, x, reinterpret_cast<const llaisys::bf16_t *>(weight), epilogue_<float>(ep, nullptr, n),
+                           m, n, k, weight_packed, bf16_dot);
+        case LLAISYS_DTYPE_F16:
+            return linear_(y, x, reinterpret_cast<const llaisys::fp16_t *>(weight), epilogue_<float>(ep, nullptr, n),
+                           m, n, k, weight_packed, bf16_dot);
+        default:
+            EXCEPTION_UNSUPPORTED_DATATYPE(weight_type);
+        }
+    }
+    ASSERT(weight_type == type, "Linear: weight dtype must match the activations, or be BF16/F16 under F32.");
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return linear_(reinterpret_cast<float *>(out), reinterpret_cast<const float *>(in),
+                       reinterpret_cast<const float *>(weight), epilogue_<float>(ep, nullptr, n),
+                       m, n, k, weight_packed, bf16_dot);
+    case LLAISYS_DTYPE_BF16:
+        return linear_(reinterpret_cast<llaisys::bf16_t *>(out), reinterpret_cast<const llaisys::bf16_t *>(in),
+                       reinterpret_cast<const llaisys::bf16_t *>(weight), epilogue_<llaisys::bf16_t>(ep, nullptr, n),
+                       m, n, k, weight_packed, bf16_dot);
+    case LLAISYS_DTYPE_F16:
+        return linear_(reinterpret_cast<llaisys::fp16_t *>(out), reinterpret_cast<const llaisys::fp16_t *>(in),
+                       reinterpret_cast<const llaisys::fp16_t *>(weight), epilogue_<llaisys::fp16_t>(ep, nullptr, n),
+                       m, n, k, weight_packed, bf16_dot);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+
+size_t linear_packed_numel(size_t n, size_t k) {
+    return gemm::packed_b_size(n, k);
+}
+
+void linear_pack_weight(std::byte *packed, const std::byte *weight, llaisysDataType_t type, size_t n, size_t k) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return gemm::pack_b_panels(reinterpret_cast<float *>(packed), reinterpret_cast<const float *>(weight), k, n, k);
+    case LLAISYS_DTYPE_BF16:
+        return gemm::pack_b_panels(reinterpret_cast<llaisys::bf16_t *>(packed),
+                                   reinterpret_cast<const llaisys::bf16_t *>(weight), k, n, k);
+    case LLAISYS_DTYPE_F16:
+        return gemm::pack_b_panels(reinterpret_cast<llaisys::fp16_t *>(packed),
+                                   reinterpret_cast<const llaisys::fp16_t *>(weight), k, n, k);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+
+void linear_q8(std::byte *out, const std::byte *in, const int8_t *weight, const float *scale, const LinearEpilogue &ep,
+               llaisysDataType_t type, size_t m, size_t n, size_t k) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return linear_q8_(reinterpret_cast<float *>(out), reinterpret_cast<const float *>(in), weight,
+                          epilogue_<float>(ep, scale, n), m, n, k);
+    case LLAISYS_DTYPE_BF16:
+        return linear_q8_(reinterpret_cast<llaisys::bf16_t *>(out), reinterpret_cast<const llaisys::bf16_t *>(in), weight,
+                          epilogue_<llaisys::bf16_t>(ep, scale, n), m, n, k);
+    case LLAISYS_DTYPE_F16:
+        return linear_q8_(reinterpret_cast<llaisys::fp16_t *>(out), reinterpret_cast<const llaisys::fp16_t *>(in), weight,
+                          epilogue_<llaisys::fp16_t>(ep, scale, n), m, n, k);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+
+void linear_quantize_q8(int8_t *q, float *scale, const std::byte *weight, llaisysDataType_t type, size_t n, size_t k) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return quant::quantize_q8(q, scale, reinterpret_cast<const float *>(weight), n, k);
+    case LLAISYS_DTYPE_BF16:
+        return quant::quantize_q8(q, scale, reinterpret_cast<const llaisys::bf16_t *>(weight), n, k);
+    case LLAISYS_DTYPE_F16:
+        return quant::quantize_q8(q, scale, reinterpret_cast<const llaisys::fp16_t *>(weight), n, k);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+
+void linear_q4(std::byte *out, const std::byte *in, const quant::Q4Weight &weight, const LinearEpilogue &ep,
+               llaisysDataType_t type, size_t m, size_t n, size_t k) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return linear_q4_(reinterpret_cast<float *>(out), reinterpret_cast<const float *>(in), weight,
+                          epilogue_<float>(ep, nullptr, n), m, n, k);
+    case LLAISYS_DTYPE_BF16:
+        return linear_q4_(reinterpret_cast<llaisys::bf16_t *>(out), reinterpret_cast<const llaisys::bf16_t *>(in), weight,
+                          epilogue_<llaisys::bf16_t>(ep, nullptr, n), m, n, k);
+    case LLAISYS_DTYPE_F16:
+        return linear_q4_(reinterpret_cast<llaisys::fp16_t *>(out), reinterpret_cast<const llaisys::fp16_t *>(in), weight,
+                          epilogue_<llaisys::fp16_t>(ep, nullptr, n), m, n, k);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+
+void linear_quantize_q4(uint8_t *codes, fp16_t *scales, uint8_t *zeros, const std::byte *weight, llaisysDataType_t type,
+                        size_t n, size_t k, size_t group_size) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return quant::quantize_q4(codes, scales, zeros, reinterpret_cast<const float *>(weight), n, k, group_size);
+    case LLAISYS_DTYPE_BF16:
+        return quant::quantize_q4(codes, scales, zeros, reinterpret_cast<const llaisys::bf16_t *>(weight), n, k, group_size);
+    case LLAISYS_DTYPE_F16:
+        return quant::quantize_q4(codes, scales, zeros, reinterpret_cast<const llaisys::fp16_t *>(weight), n, k, group_size);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+
+void linear_topk(int64_t *out_idx, float *out_val, const LinearTile &tile, llaisysDataType_t type, size_t m, size_t n,
+                 size_t topk) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return linear_topk_<float>(out_idx, out_val, tile, m, n, topk);
+    case LLAISYS_DTYPE_BF16:
+        return linear_topk_<llaisys::bf16_t>(out_idx, out_val, tile, m, n, topk);
+    case LLAISYS_DTYPE_F16:
+        return linear_topk_<llaisys::fp16_t>(out_idx, out_val, tile, m, n, topk);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+} // namespace llaisys::ops::cpu
@@ -0,0 +1,55 @@
+#pragma once
+#include "llaisys.h"
+
+#include "epilogue.hpp"
+#include "quant.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace llaisys::ops::cpu {
+// Epilogue operands in the dtype of out (see gemm::Epilogue). With SWIGLU the
+// weight holds n / 2 gate/up pairs stacked as described by gemm::GATE_UP_BLOCK
+// and out is [m, n / 2]. `residual` is contiguous with the shape of out.
+struct LinearEpilogue {
+    const std::byte *bias = nullptr;
+    const std::byte *residual = nullptr;
+    gemm::Activation act = gemm::Activation::NONE;
+};
+
+// `type` is the dtype of out/in/bias; `weight_type` is the same, or BF16/F16
+// under F32 activations. `weight_packed`: weight is in the layout written by
+// linear_pack_weight. `bf16_dot`: plain BF16 weights may use native BF16
+// products (LLAISYS_PRECISION_BF16_DOT) when the build targets AVX512_BF16.
+void linear(std::byte *out, const std::byte *in, const std::byte *weight, const LinearEpilogue &ep,
+            llaisysDataType_t type, llaisysDataType_t weight_type, size_t m, size_t n, size_t k,
+            bool weight_packed = false, bool bf16_dot = false);
+
+// Elements of `type` needed to hold an [n, k] weight once packed.
+size_t linear_packed_numel(size_t n, size_t k);
+void linear_pack_weight(std::byte *packed, const std::byte *weight, llaisysDataType_t type, size_t n, size_t k);
+
+// Weight-only INT8: `weight` is [n, k] int8 codes with per-row `scale`.
+// `type` is the dtype of out/in/bias.
+void linear_q8(std::byte *out, const std::byte *in, const int8_t *weight, const float *scale, const LinearEpilogue &ep,
+               llaisysDataType_t type, size_t m, size_t n, size_t k);
+void linear_quantize_q8(int8_t *q, float *scale, const std::byte *weight, llaisysDataType_t type, size_t n, size_t k);
+
+// 4-bit group quantized weight, see quant::Q4Weight.
+void linear_q4(std::byte *out, const std::byte *in, const quant::Q4Weight &weight, const LinearEpilogue &ep,
+               llaisysDataType_t type, size_t m, size_t n, size_t k);
+void linear_quantize_q4(uint8_t *codes, fp16_t *scales, uint8_t *zeros, const std::byte *weight, llaisysDataType_t type,
+                        size_t n, size_t k, size_t group_size);
+
+// tile(out, j0, j1) writes columns [j0, j1) of an [m, n] product of dtype
+// `type` to out[m, j1 - j0]; j0 is always a multiple of gemm::NC, so packed
+// weights can be entered at a panel boundary.
+using LinearTile = std::function<void(std::byte *out, size_t j0, size_t j1)>;
+
+// Per-row top-k of the [m, n] product (see ops::linear_topk): threads each
+// own a shard of columns, produced one cache-sized tile at a time and folded
+// into a running top-k, and their candidates are merged at the end.
+void linear_topk(int64_t *out_idx, float *out_val, const LinearTile &tile, llaisysDataType_t type, size_t m, size_t n,
+                 size_t topk);
+} // namespace llaisys::ops::cpu
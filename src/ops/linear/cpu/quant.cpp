@@ -0,0 +1,102 @@
+#include "quant.hpp"
+
+#include "../../../device/cpu/cpu_thread_pool.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace llaisys::ops::cpu::quant {
+template <typename T>
+void quantize_q8(int8_t *q, float *scale, const T *w, size_t n, size_t k) {
+    device::cpu::parallelFor(0, n, 16, [&](size_t n0, size_t n1) {
+        for (size_t i = n0; i < n1; ++i) {
+            const T *row = w + i * k;
+            float amax = 0.0f;
+            for (size_t p = 0; p < k; ++p) {
+                amax = std::max(amax, std::fabs(utils::cast<float>(row[p])));
+            }
+            const float s = amax / 127.0f;
+            const float inv = s > 0.0f ? 1.0f / s : 0.0f;
+            for (size_t p = 0; p < k; ++p) {
+                float v = std::nearbyint(utils::cast<float>(row[p]) * inv);
+                q[i * k + p] = static_cast<int8_t>(std::clamp(v, -127.0f, 127.0f));
+            }
+            scale[i] = s;
+        }
+    });
+}
+
+template <typename T>
+void quantize_q4(uint8_t *codes, fp16_t *scales, uint8_t *zeros, const T *w, size_t n, size_t k, size_t group_size) {
+    const size_t ngroup = k / group_size;
+    device::cpu::parallelFor(0, n, 16, [&](size_t n0, size_t n1) {
+        uint8_t q[Q4_CHUNK];
+        for (size_t i = n0; i < n1; ++i) {
+            for (size_t g = 0; g < ngroup; ++g) {
+                const T *src = w + i * k + g * group_size;
+                float lo = 0.0f;
+                float hi = 0.0f;
+                for (size_t p = 0; p < group_size; ++p) {
+                    float v = utils::cast<float>(src[p]);
+                    lo = std::min(lo, v);
+                    hi = std::max(hi, v);
+                }
+                float s = 0.0f;
+                uint8_t z = Q4_ZERO;
+                if (zeros) {
+                    // asymmetric: [lo, hi] (which always contains 0) onto [0, 15]
+                    s = (hi - lo) / 15.0f;
+                    z = s > 0.0f ? static_cast<uint8_t>(std::clamp(std::nearbyint(-lo / s), 0.0f, 15.0f)) : 0;
+                    zeros[i * ngroup + g] = z;
+                } else {
+                    s = std::max(-lo, hi) / 7.0f;
+                }
+                // quantize against the scale as stored, so rounding to fp16 is accounted for
+                const fp16_t sh = utils::cast<fp16_t>(s);
+                scales[i * ngroup + g] = sh;
+                const float sf = utils::cast<float>(sh);
+                const float inv = sf > 0.0f ? 1.0f / sf : 0.0f;
+
+                uint8_t *dst = codes + (i * k + g * group_size) / 2;
+                for (size_t c = 0; c < group_size; c += Q4_CHUNK) {
+                    for (size_t j = 0; j < Q4_CHUNK; ++j) {
+                        float v = std::nearbyint(utils::cast<float>(src[c + j]) * inv) + z;
+                        q[j] = static_cast<uint8_t>(std::clamp(v, 0.0f, 15.0f));
+                    }
+                    for (size_t j = 0; j < Q4_CHUNK / 2; ++j) {
+                        dst[c / 2 + j] = static_cast<uint8_t>(q[j] | (q[j + Q4_CHUNK / 2] << 4));
+                    }
+                }
+            }
+        }
+    });
+}
+
+void dequantize_q4(float *w, const Q4Weight &q, size_t n0, size_t n1, size_t k) {
+    const size_t ngroup = k / q.group_size;
+    for (size_t i = n0; i < n1; ++i) {
+        for (size_t g = 0; g < ngroup; ++g) {
+            const float s = utils::cast<float>(q.scales[i * ngroup + g]);
+            const float z = q.zeros ? q.zeros[i * ngroup + g] : Q4_ZERO;
+            const uint8_t *src = q.codes + (i * k + g * q.group_size) / 2;
+            float *dst = w + (i - n0) * k + g * q.group_size;
+            for (size_t c = 0; c < q.group_size; c += Q4_CHUNK) {
+                for (size_t j = 0; j < Q4_CHUNK / 2; ++j) {
+                    uint8_t b = src[c / 2 + j];
+                    dst[c + j] = s * ((b & 0x0F) - z);
+                    dst[c + j + Q4_CHUNK / 2] = s * ((b >> 4) - z);
+                }
+            }
+        }
+    }
+}
+
+template void quantize_q8<float>(int8_t *, float *, const float *, size_t, size_t);
+template void quantize_q8<bf16_t>(int8_t *, float *, const bf16_t *, size_t, size_t);
+template void quantize_q8<fp16_t>(int8_t *, float *, const fp16_t *, size_t, size_t);
+
+template void quantize_q4<float>(uint8_t *, fp16_t *, uint8_t *, const float *, size_t, size_t, size_t);
+template void quantize_q4<bf16_t>(uint8_t *, fp16_t *, uint8_t *, const bf16_t *, size_t, size_t, size_t);
+template void quantize_q4<fp16_t>(uint8_t *, fp16_t *, uint8_t *, const fp16_t *, size_t, size_t, size_t);
+
+} // namespace llaisys::ops::cpu::quant
@@ -0,0 +1,38 @@
+#pragma once
+#include "llaisys.h"
+
+#include "../../../utils.hpp"
+
+#include <cstddef>
+
+// Weight-only quantization of linear weights, done once at load time.
+namespace llaisys::ops::cpu::quant {
+// Symmetric per-output-channel INT8: scale[i] = max|w[i, :]| / 127 and
+// q[i, p] = round(w[i, p] / scale[i]). All-zero rows get scale 0.
+template <typename T>
+void quantize_q8(int8_t *q, float *scale, const T *w, size_t n, size_t k);
+
+// 4-bit group quantization: every `group_size` consecutive weights of a row
+// share one fp16 scale and a zero point, w = scale * (q - zero) with q in
+// [0, 15]. Without explicit zero points the zero is 8 (symmetric).
+//
+// Codes are stored row by row, two per byte, in chunks of 32: byte j of a
+// chunk holds code j in the low nibble and code j + 16 in the high nibble, so
+// one 16-byte load unpacks into in-order float vectors.
+constexpr size_t Q4_CHUNK = 32;
+constexpr uint8_t Q4_ZERO = 8;
+
+struct Q4Weight {
+    const uint8_t *codes;  // [n, k / 2]
+    const fp16_t *scales;  // [n, k / group_size]
+    const uint8_t *zeros;  // [n, k / group_size], or null for Q4_ZERO
+    size_t group_size;     // multiple of Q4_CHUNK dividing k
+};
+
+// `zeros` may be null to quantize symmetrically.
+template <typename T>
+void quantize_q4(uint8_t *codes, fp16_t *scales, uint8_t *zeros, const T *w, size_t n, size_t k, size_t group_size);
+
+// Rows [n0, n1) of W back to float, written to w[0 .. (n1 - n0) * k).
+void dequantize_q4(float *w, const Q4Weight &q, size_t n0, size_t n1, size_t k);
+} // namespace llaisys::ops::cpu::quant
@@ -1,63 +1,344 @@
 #include "op.hpp"
 
+#include "../../core/llaisys_core.hpp"
+#include "../../utils.hpp"
+
+#include "cpu/linear_cpu.hpp"
+
 namespace llaisys::ops {
-    template <typename T>
-    void linear_(tensor_t out, tensor_t in, tensor_t weight, tensor_t bias) {
-            // 1. 获取矩阵维度
-        // in: [M, K]
-        // weight: [N, K]
-        // out: [M, N]
-        size_t M = in->shape()[0];      // Batch size 或 Sequence length
-        size_t K = in->shape()[1];      // Input features
-        size_t N = weight->shape()[0];  // Output features
-
-        // 2. 获取数据指针
-        T* out_ptr = reinterpret_cast<T*>(out->data());
-        const T* in_ptr = reinterpret_cast<const T*>(in->data());
-        const T* w_ptr = reinterpret_cast<const T*>(weight->data());
-        
-        // 3. 处理 bias (它是可选的)
-        // 检查 bias 是否存在且不为空
-        const T* b_ptr = (bias && bias->numel() > 0) ? reinterpret_cast<const T*>(bias->data()) : nullptr;
-
-        // 4. 核心循环：矩阵乘法 (Matrix Multiplication)
-        // Y[m, n] = dot(X[m, :], W[n, :]) + b[n]
-        for (size_t m = 0; m < M; ++m) {
-            for (size_t n = 0; n < N; ++n) {
-                float sum = 0.0f;
-                
-                // 计算点积 (Dot Product)
-                // 注意：由于 weight 是 [N, K]存储的，它的第 n 行就是连续的 K 个数
-                // 这对 CPU 缓存非常友好，不需要手动转置
-                for (size_t k = 0; k < K; ++k) {
-                    float x_val = utils::cast<float>(in_ptr[m * K + k]);
-                    float w_val = utils::cast<float>(w_ptr[n * K + k]);
-                    sum += x_val * w_val;
-                }
-                
-                // 加上 bias
-                if (b_ptr) {
-                    sum += utils::cast<float>(b_ptr[n]);
-                }
-                
-                // 写入结果
-                out_ptr[m * N + n] = utils::cast<T>(sum);
-            }
+namespace {
+cpu::gemm::Activation cpu_activation(llaisysActivation_t act) {
+    switch (act) {
+    case LLAISYS_ACTIVATION_NONE:
+        return cpu::gemm::Activation::NONE;
+    case LLAISYS_ACTIVATION_RELU:
+        return cpu::gemm::Activation::RELU;
+    case LLAISYS_ACTIVATION_SILU:
+        return cpu::gemm::Activation::SILU;
+    case LLAISYS_ACTIVATION_GELU:
+        return cpu::gemm::Activation::GELU;
+    case LLAISYS_ACTIVATION_SWIGLU:
+        return cpu::gemm::Activation::SWIGLU;
+    default:
+        CHECK_ARGUMENT(false, "Linear: unknown activation.");
+        return cpu::gemm::Activation::NONE;
+    }
+}
+} // namespace
+
+void linear(tensor_t out, tensor_t in, tensor_t weight, const LinearEpilogue &epilogue) {
+    // bias and residual are optional
+    const tensor_t &bias = epilogue.bias;
+    const tensor_t &residual = epilogue.residual;
+    bool has_bias = bias && bias->numel() > 0;
+    bool has_residual = residual != nullptr;
+    bool weight_packed = weight->layout() == TensorLayout::LINEAR_PACKED;
+    bool weight_q8 = weight->quant().scheme == QuantScheme::INT8_CHANNEL;
+    bool weight_q4 = weight->quant().scheme == QuantScheme::Q4_GROUP;
+    cpu::gemm::Activation act = cpu_activation(epilogue.activation);
+    CHECK_SAME_DEVICE(out, in, weight);
+    if (weight_q8) {
+        CHECK_SAME_DTYPE(out->dtype(), in->dtype());
+        CHECK_SAME_DTYPE(weight->dtype(), LLAISYS_DTYPE_I8);
+    } else if (weight_q4) {
+        CHECK_SAME_DTYPE(out->dtype(), in->dtype());
+        CHECK_SAME_DTYPE(weight->dtype(), LLAISYS_DTYPE_U8);
+        ASSERT(weight->layout() == TensorLayout::NIBBLE_PACKED, "Linear: Q4 weight must be nibble packed.");
+    } else {
+        ASSERT(!weight->isQuantized(), "Linear: unsupported weight quantization.");
+        CHECK_SAME_DTYPE(out->dtype(), in->dtype());
+        // F32 activations may run over BF16/F16 weights
+        if (!(in->dtype() == LLAISYS_DTYPE_F32
+              && (weight->dtype() == LLAISYS_DTYPE_BF16 || weight->dtype() == LLAISYS_DTYPE_F16))) {
+            CHECK_SAME_DTYPE(in->dtype(), weight->dtype());
+        }
+    }
+    ASSERT(out->ndim() == 2 && in->ndim() == 2 && weight->ndim() == 2, "Linear: out, in and weight must be 2D.");
+    ASSERT(out->isContiguous() && in->isContiguous() && (weight_packed || weight_q4 || weight->isContiguous()),
+           "Linear: all tensors must be contiguous.");
+
+    size_t m = in->shape()[0];
+    size_t k = in->shape()[1];
+    size_t n = weight->shape()[0];
+    CHECK_ARGUMENT(weight->shape()[1] == k, "Linear: in and weight must share the reduction dimension.");
+    if (act == cpu::gemm::Activation::SWIGLU) {
+        CHECK_ARGUMENT(n % 2 == 0, "Linear: a stacked gate/up weight must have an even number of rows.");
+        CHECK_ARGUMENT(out->shape()[0] == m && out->shape()[1] == n / 2,
+                       "Linear: SwiGLU output shape must be [in.shape[0], weight.shape[0] / 2].");
+    } else {
+        CHECK_ARGUMENT(out->shape()[0] == m && out->shape()[1] == n, "Linear: output shape must be [in.shape[0], weight.shape[0]].");
+    }
+    if (has_bias) {
+        CHECK_SAME_DEVICE(out, bias);
+        CHECK_SAME_DTYPE(out->dtype(), bias->dtype());
+        CHECK_ARGUMENT(bias->ndim() == 1 && bias->shape()[0] == n, "Linear: bias must be 1D of length weight.shape[0].");
+        ASSERT(bias->isContiguous(), "Linear: bias must be contiguous.");
+    }
+    if (has_residual) {
+        CHECK_SAME_DEVICE(out, residual);
+        CHECK_SAME_DTYPE(out->dtype(), residual->dtype());
+        CHECK_SAME_SHAPE(out->shape(), residual->shape());
+        ASSERT(residual->isContiguous(), "Linear: residual must be contiguous.");
+    }
+    cpu::LinearEpilogue ep{has_bias ? bias->data() : nullptr, has_residual ? residual->data() : nullptr, act};
+
+    // always support cpu calculation
+    if (out->deviceType() == LLAISYS_DEVICE_CPU) {
+        if (weight_q8) {
+            return cpu::linear_q8(out->data(), in->data(), reinterpret_cast<const int8_t *>(weight->data()),
+                                  reinterpret_cast<const float *>(weight->quant().scales->data()), ep,
+                                  out->dtype(), m, n, k);
+        }
+        if (weight_q4) {
+            const auto &q = weight->quant();
+            cpu::quant::Q4Weight w{reinterpret_cast<const uint8_t *>(weight->data()),
+                                   reinterpret_cast<const fp16_t *>(q.scales->data()),
+                                   q.zeros ? reinterpret_cast<const uint8_t *>(q.zeros->data()) : nullptr,
+                                   q.group_size};
+            return cpu::linear_q4(out->data(), in->data(), w, ep, out->dtype(), m, n, k);
         }
+        const bool bf16_dot = llaisys::core::context().precision() == LLAISYS_PRECISION_BF16_DOT;
+        return cpu::linear(out->data(), in->data(), weight->data(), ep, out->dtype(), weight->dtype(), m, n, k,
+                           weight_packed, bf16_dot);
     }
+
+    llaisys::core::context().setDevice(out->deviceType(), out->deviceId());
+
+    // the CPU returned above
+    switch (out->deviceType()) {
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+
 void linear(tensor_t out, tensor_t in, tensor_t weight, tensor_t bias) {
-    switch (in->dtype()) {
-        case LLAISYS_DTYPE_F32:
-            linear_<float>(out, in, weight, bias);
-            break;
-        case LLAISYS_DTYPE_F16:
-            linear_<fp16_t>(out, in, weight, bias);
-            break;
-        case LLAISYS_DTYPE_BF16:
-            linear_<bf16_t>(out, in, weight, bias);
-            break;
-        default:
-            break;
+    linear(out, in, weight, LinearEpilogue{bias});
+}
+
+void linear_swiglu(tensor_t out, tensor_t in, tensor_t gate_up, tensor_t bias) {
+    linear(out, in, gate_up, LinearEpilogue{bias, nullptr, LLAISYS_ACTIVATION_SWIGLU});
+}
+
+void linear_topk(tensor_t out_idx, tensor_t out_val, tensor_t in, tensor_t weight, size_t k) {
+    bool weight_packed = weight->layout() == TensorLayout::LINEAR_PACKED;
+    bool weight_q8 = weight->quant().scheme == QuantScheme::INT8_CHANNEL;
+    bool weight_q4 = weight->quant().scheme == QuantScheme::Q4_GROUP;
+    CHECK_SAME_DEVICE(out_idx, out_val, in, weight);
+    CHECK_SAME_DTYPE(out_idx->dtype(), LLAISYS_DTYPE_I64);
+    CHECK_SAME_DTYPE(out_val->dtype(), LLAISYS_DTYPE_F32);
+    if (weight_q8) {
+        CHECK_SAME_DTYPE(weight->dtype(), LLAISYS_DTYPE_I8);
+    } else if (weight_q4) {
+        CHECK_SAME_DTYPE(weight->dtype(), LLAISYS_DTYPE_U8);
+        ASSERT(weight->layout() == TensorLayout::NIBBLE_PACKED, "Linear: Q4 weight must be nibble packed.");
+    } else {
+        ASSERT(!weight->isQuantized(), "Linear: unsupported weight quantization.");
+        if (!(in->dtype() == LLAISYS_DTYPE_F32
+              && (weight->dtype() == LLAISYS_DTYPE_BF16 || weight->dtype() == LLAISYS_DTYPE_F16))) {
+            CHECK_SAME_DTYPE(in->dtype(), weight->dtype());
+        }
+    }
+    ASSERT(out_idx->ndim() == 2 && out_val->ndim() == 2 && in->ndim() == 2 && weight->ndim() == 2,
+           "Linear: out_idx, out_val, in and weight must be 2D.");
+    ASSERT(out_idx->isContiguous() && out_val->isContiguous() && in->isContiguous()
+               && (weight_packed || weight_q4 || weight->isContiguous()),
+           "Linear: all tensors must be contiguous.");
+
+    size_t m = in->shape()[0];
+    size_t kd = in->shape()[1];
+    size_t n = weight->shape()[0];
+    CHECK_ARGUMENT(weight->shape()[1] == kd, "Linear: in and weight must share the reduction dimension.");
+    CHECK_ARGUMENT(k > 0 && k <= n, "Linear: top-k needs 0 < k <= weight.shape[0].");
+    CHECK_SAME_SHAPE(out_idx->shape(), out_val->shape());
+    CHECK_ARGUMENT(out_idx->shape()[0] == m && out_idx->shape()[1] == k, "Linear: top-k outputs must be [in.shape[0], k].");
+    if (m == 0) {
+        return;
+    }
+
+    switch (in->deviceType()) {
+    case LLAISYS_DEVICE_CPU: {
+        // each tile is the plain linear of a slice of weight rows, passed by
+        // reference so the LinearTile holding it allocates nothing
+        int64_t *idx = reinterpret_cast<int64_t *>(out_idx->data());
+        float *val = reinterpret_cast<float *>(out_val->data());
+        const std::byte *x = in->data();
+        const llaisysDataType_t type = in->dtype();
+        if (weight_q8) {
+            const auto *codes = reinterpret_cast<const int8_t *>(weight->data());
+            const auto *scales = reinterpret_cast<const float *>(weight->quant().scales->data());
+            const auto tile = [=](std::byte *out, size_t j0, size_t j1) {
+                cpu::linear_q8(out, x, codes + j0 * kd, scales + j0, {}, type, m, j1 - j0, kd);
+            };
+            return cpu::linear_topk(idx, val, std::cref(tile), type, m, n, k);
+        }
+        if (weight_q4) {
+            const auto &q = weight->quant();
+            const size_t ngroup = kd / q.group_size;
+            cpu::quant::Q4Weight w{reinterpret_cast<const uint8_t *>(weight->data()),
+                                   reinterpret_cast<const fp16_t *>(q.scales->data()),
+                                   q.zeros ? reinterpret_cast<const uint8_t *>(q.zeros->data()) : nullptr,
+                                   q.group_size};
+            const auto tile = [=](std::byte *out, size_t j0, size_t j1) {
+                cpu::quant::Q4Weight rows{w.codes + j0 * kd / 2, w.scales + j0 * ngroup,
+                                          w.zeros ? w.zeros + j0 * ngroup : nullptr, w.group_size};
+                cpu::linear_q4(out, x, rows, {}, type, m, j1 - j0, kd);
+            };
+            return cpu::linear_topk(idx, val, std::cref(tile), type, m, n, k);
+        }
+        // packed panels are [NR][k] blocks, so row j0 (a multiple of NR) starts at j0 * k too
+        const std::byte *wd = weight->data();
+        const llaisysDataType_t weight_type = weight->dtype();
+        const size_t row = kd * weight->elementSize();
+        const bool bf16_dot = llaisys::core::context().precision() == LLAISYS_PRECISION_BF16_DOT;
+        const auto tile = [=](std::byte *out, size_t j0, size_t j1) {
+            cpu::linear(out, x, wd + j0 * row, {}, type, weight_type, m, j1 - j0, kd, weight_packed, bf16_dot);
+        };
+        return cpu::linear_topk(idx, val, std::cref(tile), type, m, n, k);
+    }
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+
+tensor_t linear_concat(const std::vector<tensor_t> &parts) {
+    CHECK_ARGUMENT(!parts.empty(), "Linear: nothing to concatenate.");
+    const auto &first = parts[0];
+    ASSERT(first->ndim() == 1 || first->ndim() == 2, "Linear: only weights and biases can be concatenated.");
+    size_t rows = 0;
+    for (const auto &p : parts) {
+        CHECK_SAME_DEVICE(first, p);
+        CHECK_SAME_DTYPE(first->dtype(), p->dtype());
+        ASSERT(p->isContiguous(), "Linear: concatenated tensors must be contiguous.");
+        CHECK_ARGUMENT(p->ndim() == first->ndim() && (p->ndim() == 1 || p->shape()[1] == first->shape()[1]),
+                       "Linear: concatenated tensors must agree on every dimension but the first.");
+        rows += p->shape()[0];
+    }
+
+    std::vector<size_t> shape = first->shape();
+    shape[0] = rows;
+    auto fused = Tensor::create(shape, first->dtype(), first->deviceType(), first->deviceId());
+    llaisys::core::context().setDevice(first->deviceType(), first->deviceId());
+    size_t offset = 0;
+    for (const auto &p : parts) {
+        size_t bytes = p->numel() * p->elementSize();
+        llaisys::core::context().runtime().api()->memcpy_sync(fused->data() + offset, p->data(), bytes, LLAISYS_MEMCPY_D2D);
+        offset += bytes;
+    }
+    return fused;
+}
+
+tensor_t linear_stack_gate_up(tensor_t gate, tensor_t up) {
+    CHECK_SAME_DEVICE(gate, up);
+    CHECK_SAME_DTYPE(gate->dtype(), up->dtype());
+    ASSERT(gate->ndim() == 1 || gate->ndim() == 2, "Linear: only weights and biases can be stacked.");
+    ASSERT(gate->isContiguous() && up->isContiguous(), "Linear: stacked tensors must be contiguous.");
+    ASSERT(!gate->isQuantized() && !up->isQuantized() && gate->layout() == TensorLayout::STRIDED
+               && up->layout() == TensorLayout::STRIDED,
+           "Linear: stack gate/up before packing or quantizing them.");
+    CHECK_ARGUMENT(gate->shape() == up->shape(), "Linear: gate and up projections must have the same shape.");
+
+    std::vector<size_t> shape = gate->shape();
+    const size_t rows = shape[0];
+    shape[0] = 2 * rows;
+    auto stacked = Tensor::create(shape, gate->dtype(), gate->deviceType(), gate->deviceId());
+    llaisys::core::context().setDevice(gate->deviceType(), gate->deviceId());
+    const auto *api = llaisys::core::context().runtime().api();
+    const size_t row_bytes = rows == 0 ? 0 : gate->numel() / rows * gate->elementSize();
+    std::byte *dst = stacked->data();
+    for (size_t r = 0; r < rows; r += cpu::gemm::GATE_UP_BLOCK) {
+        const size_t bytes = std::min(cpu::gemm::GATE_UP_BLOCK, rows - r) * row_bytes;
+        api->memcpy_sync(dst, gate->data() + r * row_bytes, bytes, LLAISYS_MEMCPY_D2D);
+        api->memcpy_sync(dst + bytes, up->data() + r * row_bytes, bytes, LLAISYS_MEMCPY_D2D);
+        dst += 2 * bytes;
+    }
+    return stacked;
+}
+
+tensor_t linear_pack_weight(tensor_t weight) {
+    ASSERT(weight->ndim() == 2, "Linear: weight must be 2D.");
+    ASSERT(weight->isContiguous(), "Linear: weight must be contiguous to be packed.");
+    ASSERT(!weight->isQuantized(), "Linear: quantized weights are consumed unpacked.");
+    size_t n = weight->shape()[0];
+    size_t k = weight->shape()[1];
+
+    switch (weight->deviceType()) {
+    case LLAISYS_DEVICE_CPU: {
+        auto packed = Tensor::create({cpu::linear_packed_numel(n, k)}, weight->dtype(), weight->deviceType(), weight->deviceId());
+        cpu::linear_pack_weight(packed->data(), weight->data(), weight->dtype(), n, k);
+        return packed->withLayout(TensorLayout::LINEAR_PACKED, weight->shape());
+    }
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        // device kernels consume the plain layout
+        return weight;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+tensor_t linear_quantize_int8(tensor_t weight) {
+    ASSERT(weight->ndim() == 2, "Linear: weight must be 2D.");
+    ASSERT(weight->isContiguous(), "Linear: weight must be contiguous to be quantized.");
+    size_t n = weight->shape()[0];
+    size_t k = weight->shape()[1];
+
+    switch (weight->deviceType()) {
+    case LLAISYS_DEVICE_CPU: {
+        auto codes = Tensor::create({n, k}, LLAISYS_DTYPE_I8, weight->deviceType(), weight->deviceId());
+        auto scales = Tensor::create({n}, LLAISYS_DTYPE_F32, weight->deviceType(), weight->deviceId());
+        cpu::linear_quantize_q8(reinterpret_cast<int8_t *>(codes->data()), reinterpret_cast<float *>(scales->data()),
+                                weight->data(), weight->dtype(), n, k);
+        return codes->withQuant(TensorQuant{QuantScheme::INT8_CHANNEL, scales});
+    }
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return weight;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+
+tensor_t linear_quantize_q4(tensor_t weight, size_t group_size, llaisysQ4Mode_t mode) {
+    ASSERT(weight->ndim() == 2, "Linear: weight must be 2D.");
+    ASSERT(weight->isContiguous(), "Linear: weight must be contiguous to be quantized.");
+    size_t n = weight->shape()[0];
+    size_t k = weight->shape()[1];
+    CHECK_ARGUMENT(group_size > 0 && group_size % cpu::quant::Q4_CHUNK == 0 && k % group_size == 0,
+                   "Linear: Q4 group size must be a multiple of 32 that divides in_features.");
+    CHECK_ARGUMENT(mode == LLAISYS_Q4_SYMMETRIC || mode == LLAISYS_Q4_ZERO_POINT, "Linear: invalid Q4 mode.");
+    size_t ngroup = k / group_size;
+
+    switch (weight->deviceType()) {
+    case LLAISYS_DEVICE_CPU: {
+        auto codes = Tensor::create({n * k / 2}, LLAISYS_DTYPE_U8, weight->deviceType(), weight->deviceId());
+        auto scales = Tensor::create({n, ngroup}, LLAISYS_DTYPE_F16, weight->deviceType(), weight->deviceId());
+        tensor_t zeros = mode == LLAISYS_Q4_ZERO_POINT ? Tensor::create({n, ngroup}, LLAISYS_DTYPE_U8, weight->deviceType(), weight->deviceId())
+                                    : nullptr;
+        cpu::linear_quantize_q4(reinterpret_cast<uint8_t *>(codes->data()), reinterpret_cast<fp16_t *>(scales->data()),
+                                zeros ? reinterpret_cast<uint8_t *>(zeros->data()) : nullptr,
+                                weight->data(), weight->dtype(), n, k, group_size);
+        return codes->withLayout(TensorLayout::NIBBLE_PACKED, weight->shape())
+            ->withQuant(TensorQuant{QuantScheme::Q4_GROUP, scales, zeros, group_size});
+    }
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return weight;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
     }
 }
 } // namespace llaisys::ops
@@ -1,7 +1,67 @@
 #pragma once
 
+#include "llaisys/ops.h"
+
 #include "../../tensor/tensor.hpp"
 
 namespace llaisys::ops {
+// Work fused into the single store of linear's output:
+// out = activation(in * weight^T + bias) + residual.
+struct LinearEpilogue {
+    tensor_t bias;     // [N], optional
+    tensor_t residual; // shape of out, optional; may be `out` itself for an in-place residual add
+    llaisysActivation_t activation = LLAISYS_ACTIVATION_NONE;
+};
+
+// out, in, bias and residual share a dtype. The weight has it too or, to keep
+// activations in F32 between layers, is BF16/F16 under F32 activations. BF16
+// weights follow the calling thread's llaisysPrecision_t.
+void linear(tensor_t out, tensor_t in, tensor_t weight, const LinearEpilogue &epilogue);
 void linear(tensor_t out, tensor_t in, tensor_t weight, tensor_t bias);
-}
+
+// The k largest values of each row of in * weight^T, best first (equal
+// values by lowest column): out_idx (I64) and out_val (F32) are [M, k], and
+// k == 1 is argmax. The [M, N] product itself is never written: threads each
+// take a shard of weight rows, compute it a tile at a time into a buffer that
+// stays in cache and keep a running top-k, merged at the end. Meant for the
+// LM head, whose vocabulary-sized logits are otherwise written once and read
+// back by argmax/sampling. `weight` is anything linear takes.
+void linear_topk(tensor_t out_idx, tensor_t out_val, tensor_t in, tensor_t weight, size_t k);
+
+// Stacks [N_i, K] weights (or [N_i] biases) along the output dimension, so
+// several projections of the same input run as one linear. The outputs of
+// the parts are then consecutive column ranges of the fused output, e.g.
+// out->view({seq, nh + 2 * nkvh, dh})->slice(1, ...) gives Q, K and V heads
+// without copies.
+tensor_t linear_concat(const std::vector<tensor_t> &parts);
+
+// out[M, N / 2] = silu(in * gate^T) * (in * up^T), with gate and up computed
+// by one pass over `gate_up` (as stacked by linear_stack_gate_up) and combined
+// while the accumulators are still in registers/L1, so neither intermediate
+// is ever written out. `gate_up` may be packed or quantized like any weight;
+// `bias` (optional) is stacked the same way. Same as linear with
+// LLAISYS_ACTIVATION_SWIGLU.
+void linear_swiglu(tensor_t out, tensor_t in, tensor_t gate_up, tensor_t bias);
+
+// Interleaves two [N, K] weights (or [N] biases) in blocks of 32 rows, the
+// order the SwiGLU epilogue consumes: gate[0:32], up[0:32], gate[32:64], ...
+tensor_t linear_stack_gate_up(tensor_t gate, tensor_t up);
+
+// One-time repack of an [N, K] weight into the layout the CPU GEMM/GEMV
+// kernels consume directly. The result keeps the logical shape, is tagged
+// TensorLayout::LINEAR_PACKED and can only be used as `weight` of linear.
+tensor_t linear_pack_weight(tensor_t weight);
+
+// Weight-only INT8 quantization with one F32 scale per output channel. The
+// result is an I8 [N, K] tensor tagged QuantScheme::INT8_CHANNEL; linear
+// takes it as `weight` with out/in/bias in the original float dtype and
+// dequantizes inside the kernel.
+tensor_t linear_quantize_int8(tensor_t weight);
+
+// Weight-only 4-bit quantization in groups of `group_size` (a multiple of 32,
+// e.g. 32 or 128) along K, with F16 scales and, for LLAISYS_Q4_ZERO_POINT, a
+// U8 zero point per group. Returns a NIBBLE_PACKED U8 tensor of logical shape
+// [N, K] tagged QuantScheme::Q4_GROUP, consumed by linear like the INT8
+// weights.
+tensor_t linear_quantize_q4(tensor_t weight, size_t group_size, llaisysQ4Mode_t mode);
+} // namespace llaisys::ops
@@ -1,6 +1,8 @@
 #include "op.hpp"
 #include "../../utils.hpp"
+#include <algorithm>
 #include <cmath> // 需要用到 std::sqrt
+#include <vector>
 
 namespace llaisys::ops {
 
@@ -17,6 +19,14 @@ void rms_norm_cpu(tensor_t out, tensor_t in, tensor_t weight, float eps) {
     const T* in_ptr = reinterpret_cast<const T*>(in->data());
     const T* w_ptr = reinterpret_cast<const T*>(weight->data());
 
+    // weight and each row are widened to float once, results narrowed once per
+    // row; the scratch only grows, so a warm call allocates nothing
+    thread_local std::vector<float> scratch;
+    scratch.resize(std::max(scratch.size(), 2 * N));
+    float *w_f = scratch.data();
+    float *row_f = w_f + N;
+    utils::convert_n(w_f, w_ptr, N);
+
     // 3. 逐行处理
     for (size_t i = 0; i < M; ++i) {
         float sum_sq = 0.0f;
@@ -24,10 +34,11 @@ void rms_norm_cpu(tensor_t out, tensor_t in, tensor_t weight, float eps) {
         // 定位到当前行的起始位置
         const T* row_in = in_ptr + i * N;
         T* row_out = out_ptr + i * N;
+        utils::convert_n(row_f, row_in, N);
 
         // --- 步骤 A: 计算平方和 ---
         for (size_t j = 0; j < N; ++j) {
-            float val = utils::cast<float>(row_in[j]);
+            float val = row_f[j];
             sum_sq += val * val;
         }
 
@@ -38,14 +49,15 @@ void rms_norm_cpu(tensor_t out, tensor_t in, tensor_t weight, float eps) {
 
         // --- 步骤 C: 归一化并乘以权重 ---
         for (size_t j = 0; j < N; ++j) {
-            float val = utils::cast<float>(row_in[j]);
-            float w = utils::cast<float>(w_ptr[j]);
+            float val = row_f[j];
+            float w = w_f[j];
             
             // 公式: out = (in * scale) * weight
             float res = val * scale * w;
             
-            row_out[j] = utils::cast<T>(res);
+            row_f[j] = res;
         }
+        utils::convert_n(row_out, row_f, N);
     }
 }
 
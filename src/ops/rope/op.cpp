@@ -1,64 +1,103 @@
 #include "op.hpp"
 #include "../../utils.hpp"
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 namespace llaisys::ops {
 
+namespace {
+// Rotates the pairs (j, j + dh / 2) of `nhead` heads at one position by the
+// angles whose cos/sin are given, widening each head into `src` and
+// narrowing the result back in one call.
 template <typename T>
-void rope_cpu(tensor_t out, tensor_t in, tensor_t pos_ids, float theta) {
-    size_t seqlen = in->shape()[0];
-    size_t nhead = in->shape()[1];
-    size_t head_dim = in->shape()[2];
-    size_t half_dim = head_dim / 2;
-
-    T* out_ptr = reinterpret_cast<T*>(out->data());
-    const T* in_ptr = reinterpret_cast<const T*>(in->data());
-    const int64_t* pos_ptr = reinterpret_cast<const int64_t*>(pos_ids->data());
-
-    for (size_t s = 0; s < seqlen; ++s) {
-        int64_t pos = pos_ptr[s];
-        
-        for (size_t h = 0; h < nhead; ++h) {
-            size_t offset = (s * nhead + h) * head_dim;
+void rotate_heads(T *out, ptrdiff_t out_s1, const T *in, ptrdiff_t in_s1, size_t nhead, size_t head_dim,
+                  const double *cos_val, const double *sin_val, float *src, float *dst) {
+    const size_t half_dim = head_dim / 2;
+    for (size_t h = 0; h < nhead; ++h) {
+        utils::convert_n(src, in + h * in_s1, head_dim);
+        for (size_t j = 0; j < half_dim; ++j) {
+            const float a = src[j];
+            const float b = src[j + half_dim];
+            dst[j] = (float)(a * cos_val[j] - b * sin_val[j]);
+            dst[j + half_dim] = (float)(b * cos_val[j] + a * sin_val[j]);
+        }
+        utils::convert_n(out + h * out_s1, dst, head_dim);
+    }
+}
 
-            for (size_t j = 0; j < half_dim; ++j) {
-                // --- 修改点：使用 double 进行高精度计算 ---
-                // 这里的 theta 和 j 计算如果用 float 会有累积误差
-                double freq = std::pow((double)theta, -2.0 * (double)j / (double)head_dim);
-                double angle = (double)pos * freq;
-                
-                double cos_val = std::cos(angle);
-                double sin_val = std::sin(angle);
+// Rotates every row s of in [seqlen, nhead, head_dim] to position pos(s).
+// The angles are computed in double once per position and shared by its heads.
+template <typename T, typename Pos>
+void rope_cpu(tensor_t out, tensor_t in, float theta, Pos pos) {
+    const size_t seqlen = in->shape()[0];
+    const size_t nhead = in->shape()[1];
+    const size_t head_dim = in->shape()[2];
+    const size_t half_dim = head_dim / 2;
 
-                // 读取时转为 float 即可 (输入本身精度有限)
-                float a = utils::cast<float>(in_ptr[offset + j]);
-                float b = utils::cast<float>(in_ptr[offset + j + half_dim]);
+    T *out_ptr = reinterpret_cast<T *>(out->data());
+    const T *in_ptr = reinterpret_cast<const T *>(in->data());
+    // in/out may be head views of a wider buffer (e.g. slices of a fused QKV output)
+    const ptrdiff_t in_s0 = in->strides()[0], in_s1 = in->strides()[1];
+    const ptrdiff_t out_s0 = out->strides()[0], out_s1 = out->strides()[1];
 
-                // 运算使用高精度
-                float a_out = (float)(a * cos_val - b * sin_val);
-                float b_out = (float)(b * cos_val + a * sin_val);
+    // per-thread scratch that only grows: a warm call allocates nothing
+    thread_local std::vector<double> angles;
+    thread_local std::vector<float> work;
+    angles.resize(std::max(angles.size(), 3 * half_dim));
+    work.resize(std::max(work.size(), 2 * head_dim));
+    double *freq = angles.data(), *cos_val = freq + half_dim, *sin_val = cos_val + half_dim;
+    float *src = work.data(), *dst = src + head_dim;
+    for (size_t j = 0; j < half_dim; ++j) {
+        freq[j] = std::pow((double)theta, -2.0 * (double)j / (double)head_dim);
+    }
 
-                out_ptr[offset + j] = utils::cast<T>(a_out);
-                out_ptr[offset + j + half_dim] = utils::cast<T>(b_out);
+    int64_t last = 0;
+    for (size_t s = 0; s < seqlen; ++s) {
+        const int64_t p = pos(s);
+        if (s == 0 || p != last) {
+            for (size_t j = 0; j < half_dim; ++j) {
+                const double angle = (double)p * freq[j];
+                cos_val[j] = std::cos(angle);
+                sin_val[j] = std::sin(angle);
             }
+            last = p;
         }
+        rotate_heads(out_ptr + s * out_s0, out_s1, in_ptr + s * in_s0, in_s1, nhead, head_dim,
+                     cos_val, sin_val, src, dst);
     }
 }
 
-void rope(tensor_t out, tensor_t in, tensor_t pos_ids, float theta) {
+template <typename Pos>
+void rope_dispatch(tensor_t out, tensor_t in, float theta, Pos pos) {
+    ASSERT(in->ndim() == 3 && out->ndim() == 3, "RoPE: tensors must be [seq, head, dim].");
+    CHECK_SAME_SHAPE(out->shape(), in->shape());
+    CHECK_SAME_DTYPE(out->dtype(), in->dtype());
+    ASSERT(in->strides()[2] == 1 && out->strides()[2] == 1, "RoPE: head dimension must be contiguous.");
+    CHECK_ARGUMENT(in->shape()[2] % 2 == 0, "RoPE: head dimension must be even.");
     switch (in->dtype()) {
-        case LLAISYS_DTYPE_F32:
-            rope_cpu<float>(out, in, pos_ids, theta);
-            break;
-        case LLAISYS_DTYPE_F16:
-            rope_cpu<fp16_t>(out, in, pos_ids, theta);
-            break;
-        case LLAISYS_DTYPE_BF16:
-            rope_cpu<bf16_t>(out, in, pos_ids, theta);
-            break;
-        default:
-            break;
+    case LLAISYS_DTYPE_F32:
+        return rope_cpu<float>(out, in, theta, pos);
+    case LLAISYS_DTYPE_F16:
+        return rope_cpu<fp16_t>(out, in, theta, pos);
+    case LLAISYS_DTYPE_BF16:
+        return rope_cpu<bf16_t>(out, in, theta, pos);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(in->dtype());
     }
 }
+} // namespace
+
+void rope(tensor_t out, tensor_t in, tensor_t pos_ids, float theta) {
+    ASSERT(pos_ids->dtype() == LLAISYS_DTYPE_I64 && pos_ids->ndim() == 1 && pos_ids->isContiguous(),
+           "RoPE: pos_ids must be a contiguous I64 vector.");
+    CHECK_ARGUMENT(pos_ids->shape()[0] == in->shape()[0], "RoPE: one position per row.");
+    const int64_t *pos_ptr = reinterpret_cast<const int64_t *>(pos_ids->data());
+    rope_dispatch(out, in, theta, [pos_ptr](size_t s) { return pos_ptr[s]; });
+}
+
+void rope_shift(tensor_t out, tensor_t in, int64_t delta, float theta) {
+    rope_dispatch(out, in, theta, [delta](size_t) { return delta; });
+}
 
 } // namespace llaisys::ops
\ No newline at end of file
@@ -4,4 +4,8 @@
 
 namespace llaisys::ops {
 void rope(tensor_t out, tensor_t in, tensor_t pos_ids, float theta);
+// Moves rows of in [seq, head, dim] already rotated to position p to position
+// p + delta (RoPE rotations compose), e.g. to re-base cached keys after the
+// tokens before them are evicted. out may be in.
+void rope_shift(tensor_t out, tensor_t in, int64_t delta, float theta);
 }
@@ -0,0 +1,198 @@
+#include "sample_cpu.hpp"
+
+#include "../../../device/cpu/cpu_thread_pool.hpp"
+#include "../../../utils.hpp"
+#include "../../../utils/simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+// A row is widened to float once; its max and, when the whole vocabulary is
+// in play, its softmax mass are SIMD passes over it. Top-k is a partial
+// selection: one pass keeping the best k in a min-heap, whose root is almost
+// never beaten past the first few thousand tokens, then a sort of those k.
+// Without a top-k limit, the nucleus is found by selecting the best
+// NUCLEUS_FIRST tokens and growing the selection by NUCLEUS_GROWTH until it
+// holds top_p of the mass, so a peaked distribution never sorts the
+// vocabulary.
+namespace {
+namespace simd = llaisys::utils::simd;
+
+constexpr size_t NUCLEUS_FIRST = 64;
+constexpr size_t NUCLEUS_GROWTH = 4;
+
+// splitmix64: every state, 0 included, is a valid seed
+uint64_t next_u64(uint64_t &state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// uniform in [0, 1)
+float uniform(uint64_t &state) {
+    return static_cast<float>(next_u64(state) >> 40) * 0x1p-24f;
+}
+
+float max_n(const float *x, size_t n) {
+    size_t i = 0;
+    float m = -INFINITY;
+    if (n >= simd::VL) {
+        simd::vec_t mv = simd::load(x);
+        for (i = simd::VL; i + simd::VL <= n; i += simd::VL) {
+            mv = simd::max(mv, simd::load(x + i));
+        }
+        m = simd::reduce_max(mv);
+    }
+    for (; i < n; ++i) {
+        m = std::max(m, x[i]);
+    }
+    return m;
+}
+
+// e[0, n) = exp((x - m) * inv_t); returns the sum
+float exp_sum(float *e, const float *x, float m, float inv_t, size_t n) {
+    const simd::vec_t scale = simd::set1(inv_t), shift = simd::set1(-m * inv_t);
+    simd::vec_t sv = simd::zero();
+    size_t i = 0;
+    for (; i + simd::VL <= n; i += simd::VL) {
+        const simd::vec_t ev = simd::exp(simd::fmadd(simd::load(x + i), scale, shift));
+        simd::store(e + i, ev);
+        sv = simd::add(sv, ev);
+    }
+    float sum = simd::reduce_add(sv);
+    for (; i < n; ++i) {
+        e[i] = std::exp((x[i] - m) * inv_t);
+        sum += e[i];
+    }
+    return sum;
+}
+
+struct Workspace {
+    std::vector<float> x, p;
+    std::vector<int32_t> idx;
+    std::vector<std::pair<float, int32_t>> heap;
+};
+
+// idx[0, c) = the indices of the c largest x, largest first (ties: lowest index)
+void select_top(Workspace &ws, size_t voc, size_t c) {
+    const float *x = ws.x.data();
+    int32_t *idx = ws.idx.data();
+    // the root is the worst kept: smallest value, then highest index
+    const auto worse = [](const std::pair<float, int32_t> &a, const std::pair<float, int32_t> &b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    };
+    auto &heap = ws.heap;
+    heap.clear();
+    for (size_t i = 0; i < c; ++i) {
+        heap.emplace_back(x[i], static_cast<int32_t>(i));
+    }
+    std::make_heap(heap.begin(), heap.end(), worse);
+    for (size_t i = c; i < voc; ++i) {
+        if (x[i] > heap.front().first) {
+            std::pop_heap(heap.begin(), heap.end(), worse);
+            heap.back() = {x[i], static_cast<int32_t>(i)};
+            std::push_heap(heap.begin(), heap.end(), worse);
+        }
+    }
+    std::sort_heap(heap.begin(), heap.end(), worse);
+    for (size_t i = 0; i < c; ++i) {
+        idx[i] = heap[i].second;
+    }
+}
+
+int64_t sample_row(Workspace &ws, size_t voc, uint64_t &state, size_t top_k, float top_p, float temperature) {
+    const float *x = ws.x.data();
+    const float m = max_n(x, voc);
+    if (top_k == 1 || temperature <= 0.0f) {
+        return std::find(x, x + voc, m) - x;
+    }
+    const float inv_t = 1.0f / temperature;
+    const size_t k = top_k == 0 ? voc : std::min(top_k, voc);
+    float *p = ws.p.data();
+
+    // the whole distribution: one draw against the running sum
+    if (k == voc && top_p >= 1.0f) {
+        const float target = uniform(state) * exp_sum(p, x, m, inv_t, voc);
+        float cum = 0.0f;
+        size_t last = 0;
+        for (size_t i = 0; i < voc; ++i) {
+            if (p[i] > 0.0f) {
+                cum += p[i];
+                last = i;
+                if (cum > target) {
+                    return i;
+                }
+            }
+        }
+        return last; // rounding left target at the very end
+    }
+
+    // mass the nucleus is a share of: the top-k tokens, else all of them
+    const float total = k < voc ? 0.0f : exp_sum(p, x, m, inv_t, voc);
+    const int32_t *idx = ws.idx.data();
+    size_t kept = 0;
+    float cum = 0.0f;
+    for (size_t c = k < voc ? k : std::min(NUCLEUS_FIRST, voc);; c = std::min(c * NUCLEUS_GROWTH, voc)) {
+        select_top(ws, voc, c);
+        for (size_t i = 0; i < c; ++i) {
+            p[i] = std::exp((x[idx[i]] - m) * inv_t);
+        }
+        const float mass = top_p * (k < voc ? std::accumulate(p, p + c, 0.0f) : total);
+        kept = 0;
+        cum = 0.0f;
+        while (kept < c && cum < mass) {
+            cum += p[kept++];
+        }
+        if (cum >= mass || c == k) {
+            break;
+        }
+    }
+    kept = std::max<size_t>(kept, 1);
+    const float target = uniform(state) * cum;
+    float run = 0.0f;
+    for (size_t i = 0; i < kept; ++i) {
+        run += p[i];
+        if (run > target) {
+            return idx[i];
+        }
+    }
+    return idx[kept - 1];
+}
+
+template <typename T>
+void sample_(int64_t *out_idx, const T *logits, uint64_t *rng_state, size_t batch, size_t voc, size_t top_k,
+             float top_p, float temperature) {
+    llaisys::device::cpu::parallelFor(0, batch, 1, [&](size_t b0, size_t b1) {
+        thread_local Workspace ws;
+        ws.x.resize(voc);
+        ws.p.resize(voc);
+        ws.idx.resize(voc);
+        for (size_t b = b0; b < b1; ++b) {
+            llaisys::utils::convert_n(ws.x.data(), logits + b * voc, voc);
+            out_idx[b] = sample_row(ws, voc, rng_state[b], top_k, top_p, temperature);
+        }
+    });
+}
+} // namespace
+
+namespace llaisys::ops::cpu {
+void sample(int64_t *out_idx, const std::byte *logits, uint64_t *rng_state, llaisysDataType_t type, size_t batch,
+            size_t voc, size_t top_k, float top_p, float temperature) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return sample_(out_idx, reinterpret_cast<const float *>(logits), rng_state, batch, voc, top_k, top_p,
+                       temperature);
+    case LLAISYS_DTYPE_BF16:
+        return sample_(out_idx, reinterpret_cast<const llaisys::bf16_t *>(logits), rng_state, batch, voc, top_k,
+                       top_p, temperature);
+    case LLAISYS_DTYPE_F16:
+        return sample_(out_idx, reinterpret_cast<const llaisys::fp16_t *>(logits), rng_state, batch, voc, top_k,
+                       top_p, temperature);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+} // namespace llaisys::ops::cpu
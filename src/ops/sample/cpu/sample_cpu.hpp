@@ -0,0 +1,11 @@
+#pragma once
+#include "llaisys.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace llaisys::ops::cpu {
+// `batch` rows of `voc` contiguous logits of `type`; see ops::sample.
+void sample(int64_t *out_idx, const std::byte *logits, uint64_t *rng_state, llaisysDataType_t type, size_t batch,
+            size_t voc, size_t top_k, float top_p, float temperature);
+} // namespace llaisys::ops::cpu
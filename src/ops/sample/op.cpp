@@ -0,0 +1,40 @@
+#include "op.hpp"
+
+#include "../../core/llaisys_core.hpp"
+#include "../../utils.hpp"
+
+#include "cpu/sample_cpu.hpp"
+
+namespace llaisys::ops {
+void sample(tensor_t out_idx, tensor_t logits, tensor_t rng_state, size_t top_k, float top_p, float temperature) {
+    CHECK_SAME_DEVICE(out_idx, logits);
+    ASSERT(logits->ndim() == 2 && logits->isContiguous(), "Sample: logits must be a contiguous [batch, voc] matrix.");
+    const size_t batch = logits->shape()[0], voc = logits->shape()[1];
+    ASSERT(out_idx->dtype() == LLAISYS_DTYPE_I64 && out_idx->isContiguous(), "Sample: out_idx must be contiguous I64.");
+    ASSERT(rng_state->dtype() == LLAISYS_DTYPE_I64 && rng_state->isContiguous(),
+           "Sample: rng_state must be contiguous I64.");
+    ASSERT(rng_state->deviceType() == LLAISYS_DEVICE_CPU, "Sample: rng_state must be on the host.");
+    CHECK_ARGUMENT(out_idx->numel() == batch && rng_state->numel() == batch,
+                   "Sample: out_idx and rng_state need one entry per row.");
+    CHECK_ARGUMENT(voc > 0, "Sample: empty vocabulary.");
+    CHECK_ARGUMENT(top_p > 0.0f && top_p <= 1.0f, "Sample: top_p must be in (0, 1].");
+
+    if (logits->deviceType() == LLAISYS_DEVICE_CPU) {
+        return cpu::sample(reinterpret_cast<int64_t *>(out_idx->data()), logits->data(),
+                           reinterpret_cast<uint64_t *>(rng_state->data()), logits->dtype(), batch, voc, top_k, top_p,
+                           temperature);
+    }
+
+    llaisys::core::context().setDevice(logits->deviceType(), logits->deviceId());
+
+    switch (logits->deviceType()) {
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+} // namespace llaisys::ops
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "../../tensor/tensor.hpp"
+
+namespace llaisys::ops {
+// Draws out_idx[b] (I64 [batch]) from softmax(logits[b] / temperature)
+// restricted to the top_k largest logits (0: no limit) and then to the
+// smallest set of those holding top_p of their probability mass, as
+// HF transformers' samplers do. rng_state (host I64 [batch]) is one generator
+// per row, seeded by the caller and advanced by every draw, so a sequence's
+// samples do not depend on what it is batched with. top_k == 1 or
+// temperature <= 0 is greedy and draws nothing.
+void sample(tensor_t out_idx, tensor_t logits, tensor_t rng_state, size_t top_k, float top_p, float temperature);
+} // namespace llaisys::ops
@@ -0,0 +1,61 @@
+#include "self_attention_cpu.hpp"
+
+#include "../../../utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+namespace {
+template <typename T, typename TC>
+void quantize_kv_rows_(TC *codes, float *scales, const T *x, size_t nrows, size_t d) {
+    // the largest code magnitude
+    constexpr float QMAX = std::is_same_v<TC, int8_t> ? 127.0f : 448.0f;
+    for (size_t r = 0; r < nrows; ++r) {
+        const T *row = x + r * d;
+        float amax = 0.0f;
+        for (size_t i = 0; i < d; ++i) {
+            amax = std::max(amax, std::fabs(llaisys::utils::cast<float>(row[i])));
+        }
+        const float s = amax / QMAX;
+        const float inv = s > 0.0f ? 1.0f / s : 0.0f;
+        for (size_t i = 0; i < d; ++i) {
+            const float v = llaisys::utils::cast<float>(row[i]) * inv;
+            if constexpr (std::is_same_v<TC, int8_t>) {
+                codes[r * d + i] = static_cast<int8_t>(std::clamp(std::nearbyint(v), -QMAX, QMAX));
+            } else {
+                codes[r * d + i] = llaisys::utils::cast<TC>(v);
+            }
+        }
+        scales[r] = s;
+    }
+}
+
+template <typename T>
+void quantize_to(std::byte *codes, float *scales, const T *x, llaisysDataType_t code_type, size_t nrows, size_t d) {
+    switch (code_type) {
+    case LLAISYS_DTYPE_I8:
+        return quantize_kv_rows_(reinterpret_cast<int8_t *>(codes), scales, x, nrows, d);
+    case LLAISYS_DTYPE_F8:
+        return quantize_kv_rows_(reinterpret_cast<llaisys::fp8_t *>(codes), scales, x, nrows, d);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(code_type);
+    }
+}
+} // namespace
+
+namespace llaisys::ops::cpu {
+void quantize_kv_rows(std::byte *codes, float *scales, const std::byte *x, llaisysDataType_t type,
+                      llaisysDataType_t code_type, size_t nrows, size_t d) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return quantize_to(codes, scales, reinterpret_cast<const float *>(x), code_type, nrows, d);
+    case LLAISYS_DTYPE_BF16:
+        return quantize_to(codes, scales, reinterpret_cast<const llaisys::bf16_t *>(x), code_type, nrows, d);
+    case LLAISYS_DTYPE_F16:
+        return quantize_to(codes, scales, reinterpret_cast<const llaisys::fp16_t *>(x), code_type, nrows, d);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+} // namespace llaisys::ops::cpu
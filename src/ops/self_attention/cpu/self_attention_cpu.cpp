@@ -0,0 +1,527 @@
+#include "self_attention_cpu.hpp"
+
+#include "../../../device/cpu/cpu_thread_pool.hpp"
+#include "../../../utils.hpp"
+#include "../../../utils/simd.hpp"
+
+#include "../../linear/cpu/gemm.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// Flash-style attention: K/V are consumed in blocks of KV_BLOCK keys with an
+// online softmax. Each query row keeps its running max `m`, running sum `l`
+// and un-normalized output `acc`; a block's scores are computed, the row
+// state is rescaled by exp(m_old - m_new) once per block, and the block's
+// probabilities are folded into `acc`. The state lives in a per-thread
+// workspace and per row is one block of scores plus `acc`, however long the
+// context is.
+//
+// Prefill runs the same recurrence on Q_BLOCK x KV_BLOCK tiles: the scores
+// Q K^T and the update P V are small GEMMs on the linear micro-kernels. Key
+// tiles entirely above the causal diagonal are never visited; only the
+// tiles crossing it are masked element by element.
+//
+// K/V may be stored as I8/F8 codes with a scale per (token, head) row. Kernels
+// are templated on the stored type TK and dequantize a row (decode) or a tile
+// (prefill) into L1 right before using it, so a quantized cache is only ever
+// read at its own width.
+namespace {
+namespace simd = llaisys::utils::simd;
+namespace gemm = llaisys::ops::cpu::gemm;
+using llaisys::ops::cpu::ATTENTION_MAX_HEAD_DIM;
+
+constexpr size_t KV_BLOCK = 64;
+constexpr size_t Q_BLOCK = 64;
+// fewest keys per split of a decode row
+constexpr size_t SPLIT_MIN_KEYS = 512;
+
+// dot(x, y[0, n)) with x already widened
+template <typename T>
+float dot(const float *x, const T *y, size_t n) {
+    simd::vec_t acc = simd::zero();
+    size_t i = 0;
+    for (; i + simd::VL <= n; i += simd::VL) {
+        acc = simd::fmadd(simd::load(x + i), simd::load(y + i), acc);
+    }
+    float sum = simd::reduce_add(acc);
+    for (; i < n; ++i) {
+        sum += x[i] * llaisys::utils::cast<float>(y[i]);
+    }
+    return sum;
+}
+
+// acc[0, n) += p * y[0, n)
+template <typename T>
+void axpy(float *acc, float p, const T *y, size_t n) {
+    const simd::vec_t pv = simd::set1(p);
+    size_t i = 0;
+    for (; i + simd::VL <= n; i += simd::VL) {
+        simd::store(acc + i, simd::fmadd(pv, simd::load(y + i), simd::load(acc + i)));
+    }
+    for (; i < n; ++i) {
+        acc[i] += p * llaisys::utils::cast<float>(y[i]);
+    }
+}
+
+void scale_n(float *x, float a, size_t n) {
+    const simd::vec_t av = simd::set1(a);
+    size_t i = 0;
+    for (; i + simd::VL <= n; i += simd::VL) {
+        simd::store(x + i, simd::mul(simd::load(x + i), av));
+    }
+    for (; i < n; ++i) {
+        x[i] *= a;
+    }
+}
+
+// x[0, n) = exp(x - m); returns the sum
+float exp_sum(float *x, float m, size_t n) {
+    const simd::vec_t neg_m = simd::set1(-m);
+    simd::vec_t sv = simd::zero();
+    size_t i = 0;
+    for (; i + simd::VL <= n; i += simd::VL) {
+        const simd::vec_t e = simd::exp(simd::add(simd::load(x + i), neg_m));
+        simd::store(x + i, e);
+        sv = simd::add(sv, e);
+    }
+    float sum = simd::reduce_add(sv);
+    for (; i < n; ++i) {
+        x[i] = std::exp(x[i] - m);
+        sum += x[i];
+    }
+    return sum;
+}
+
+// quantized K/V storage: codes with a row scale
+template <typename T>
+constexpr bool IS_CODE = std::is_same_v<T, int8_t> || std::is_same_v<T, llaisys::fp8_t>;
+
+// Row src as float: src itself when T is float, else widened (codes
+// multiplied by their row scale s) into buf.
+template <typename T>
+const float *widen(float *buf, const T *src, float s, size_t n) {
+    if constexpr (std::is_same_v<T, float>) {
+        return src;
+    } else if constexpr (IS_CODE<T>) {
+        const simd::vec_t sv = simd::set1(s);
+        size_t i = 0;
+        for (; i + simd::VL <= n; i += simd::VL) {
+            simd::store(buf + i, simd::mul(simd::load(src + i), sv));
+        }
+        for (; i < n; ++i) {
+            buf[i] = s * llaisys::utils::cast<float>(src[i]);
+        }
+        return buf;
+    } else {
+        llaisys::utils::convert_n(buf, src, n);
+        return buf;
+    }
+}
+
+// The K (or V) rows of one KV head: row t at base + t * s0 or, when paged, at
+// row t % block of block table[t / block], blocks being block_stride apart.
+// Kernels walk keys in runs that do not cross a block, so the table is read
+// once per run rather than once per row. Codes have their row scales laid
+// out the same way (scale_s0, scale_block_stride); other types have none.
+template <typename T>
+struct Rows {
+    const T *base;
+    ptrdiff_t s0;
+    const int32_t *table;
+    size_t block;
+    ptrdiff_t block_stride;
+    const float *scale;
+    ptrdiff_t scale_s0, scale_block_stride;
+
+    const T *at(size_t t) const {
+        return table ? base + table[t / block] * block_stride + (t % block) * s0 : base + t * s0;
+    }
+    // scales of rows from t on, scale_s0 apart within a run; null unless codes
+    const float *scales_at(size_t t) const {
+        if constexpr (IS_CODE<T>) {
+            return table ? scale + table[t / block] * scale_block_stride + (t % block) * scale_s0 : scale + t * scale_s0;
+        } else {
+            return nullptr;
+        }
+    }
+    // row j of a run (rows = at(t), sc = scales_at(t)) as float, in buf unless T is float
+    const float *row(float *buf, const T *rows, const float *sc, size_t j, size_t n) const {
+        if constexpr (IS_CODE<T>) {
+            return widen(buf, rows + j * s0, sc[j * scale_s0], n);
+        } else {
+            return widen(buf, rows + j * s0, 1.0f, n);
+        }
+    }
+    // rows [t, t + run(t)) are s0 apart
+    size_t run(size_t t) const {
+        return table ? block - t % block : std::numeric_limits<size_t>::max();
+    }
+};
+
+// Partial attention state of the `group` heads of one query position over a
+// range of keys: un-normalized outputs acc[group][dv], then the running maxima
+// m[group] and sums l[group].
+size_t state_size(size_t group, size_t dv) {
+    return group * (dv + 2);
+}
+
+// One query position for the `group` heads sharing a KV head: folds keys
+// [t_begin, t_end) into a fresh `state`. Each K and V row is widened once and
+// reused from L1 by every head of the group, so the KV cache is streamed once
+// per group instead of once per head. q rows are q_s1 apart.
+template <typename T, typename TK>
+void attend_group(float *state, const T *q, ptrdiff_t q_s1, const Rows<TK> &k, const Rows<TK> &v,
+                  size_t group, size_t t_begin, size_t t_end, size_t dh, size_t dv, float scale) {
+    thread_local std::vector<float> work;
+    work.resize(group * (dh + KV_BLOCK));
+    float *qf = work.data();
+    float *p = qf + group * dh;
+    float *acc = state;
+    float *m = acc + group * dv;
+    float *l = m + group;
+    alignas(64) float row[ATTENTION_MAX_HEAD_DIM];
+    for (size_t g = 0; g < group; ++g) {
+        llaisys::utils::convert_n(qf + g * dh, q + g * q_s1, dh);
+        scale_n(qf + g * dh, scale, dh);
+        m[g] = -std::numeric_limits<float>::infinity();
+        l[g] = 0.0f;
+    }
+    std::fill(acc, acc + group * dv, 0.0f);
+
+    for (size_t t0 = t_begin, nb; t0 < t_end; t0 += nb) {
+        nb = std::min({KV_BLOCK, t_end - t0, k.run(t0)});
+        const TK *kb = k.at(t0);
+        const TK *vb = v.at(t0);
+        const float *ks = k.scales_at(t0);
+        const float *vs = v.scales_at(t0);
+        for (size_t j = 0; j < nb; ++j) {
+            const float *kr = k.row(row, kb, ks, j, dh);
+            for (size_t g = 0; g < group; ++g) {
+                p[g * KV_BLOCK + j] = dot(qf + g * dh, kr, dh);
+            }
+        }
+        for (size_t g = 0; g < group; ++g) {
+            float *pg = p + g * KV_BLOCK;
+            const float m_block = std::max(m[g], *std::max_element(pg, pg + nb));
+            if (m_block > m[g]) {
+                // the first block rescales nothing: l and acc are still zero
+                const float alpha = std::exp(m[g] - m_block);
+                l[g] *= alpha;
+                scale_n(acc + g * dv, alpha, dv);
+                m[g] = m_block;
+            }
+            l[g] += exp_sum(pg, m[g], nb);
+        }
+        for (size_t j = 0; j < nb; ++j) {
+            const float *vr = v.row(row, vb, vs, j, dv);
+            for (size_t g = 0; g < group; ++g) {
+                axpy(acc + g * dv, p[g * KV_BLOCK + j], vr, dv);
+            }
+        }
+    }
+}
+
+// out[g] = the normalized merge of `nsplit` partial states over disjoint key
+// ranges, `stride` floats apart: with M = max m_c, each split is weighted by
+// exp(m_c - M) (log-sum-exp), so no exponent overflows. Empty splits have
+// m_c = -inf and weigh nothing. Out rows are dv apart.
+template <typename T>
+void merge_states(T *out, const float *state, size_t nsplit, size_t stride, size_t group, size_t dv) {
+    alignas(64) float acc[ATTENTION_MAX_HEAD_DIM];
+    for (size_t g = 0; g < group; ++g) {
+        float m = -std::numeric_limits<float>::infinity();
+        for (size_t c = 0; c < nsplit; ++c) {
+            m = std::max(m, state[c * stride + group * dv + g]);
+        }
+        float l = 0.0f;
+        std::fill(acc, acc + dv, 0.0f);
+        for (size_t c = 0; c < nsplit; ++c) {
+            const float *part = state + c * stride;
+            const float w = std::exp(part[group * dv + g] - m);
+            l += w * part[group * dv + group + g];
+            axpy(acc, w, part + g * dv, dv);
+        }
+        scale_n(acc, 1.0f / l, dv);
+        llaisys::utils::convert_n(out + g * dv, acc, dv);
+    }
+}
+
+// Tile rows are (position, head) pairs for the `group` query heads sharing
+// one KV head: row i is query position first + i / group of head i % group,
+// so each K/V tile is packed once and reused by the whole group. q rows are
+// q_s0 (positions) and q_s1 (heads) apart; out rows ldo and dv. Quantized
+// tiles are dequantized into kt / vt first.
+template <typename T, typename TK>
+void attend_tile(T *out, size_t ldo, const T *q, ptrdiff_t q_s0, ptrdiff_t q_s1,
+                 const Rows<TK> &k, const Rows<TK> &v,
+                 size_t npos, size_t group, size_t first, size_t dh, size_t dv, float scale) {
+    const size_t nq = npos * group;
+    thread_local std::vector<float> work;
+    work.resize(nq * (dh + KV_BLOCK + dv + 2) + (IS_CODE<TK> ? KV_BLOCK * (dh + dv) : 0));
+    float *qf = work.data();
+    float *sc = qf + nq * dh;
+    float *acc = sc + nq * KV_BLOCK;
+    float *m = acc + nq * dv;
+    float *l = m + nq;
+    float *kt = l + nq;
+    float *vt = kt + KV_BLOCK * dh;
+    for (size_t i = 0; i < nq; ++i) {
+        llaisys::utils::convert_n(qf + i * dh, q + (i / group) * q_s0 + (i % group) * q_s1, dh);
+        scale_n(qf + i * dh, scale, dh);
+        m[i] = -std::numeric_limits<float>::infinity();
+        l[i] = 0.0f;
+    }
+    std::fill(acc, acc + nq * dv, 0.0f);
+
+    // keys [0, first + npos) are visible to at least the last position
+    const size_t end = first + npos;
+    for (size_t t0 = 0, nb; t0 < end; t0 += nb) {
+        nb = std::min({KV_BLOCK, end - t0, k.run(t0)});
+        if constexpr (IS_CODE<TK>) {
+            const TK *kb = k.at(t0);
+            const TK *vb = v.at(t0);
+            const float *ks = k.scales_at(t0);
+            const float *vs = v.scales_at(t0);
+            for (size_t j = 0; j < nb; ++j) {
+                k.row(kt + j * dh, kb, ks, j, dh);
+                v.row(vt + j * dv, vb, vs, j, dv);
+            }
+            gemm::gemm_tile(sc, KV_BLOCK, qf, dh, kt, dh, 1, nq, nb, dh, false);
+        } else {
+            gemm::gemm_tile(sc, KV_BLOCK, qf, dh, k.at(t0), k.s0, 1, nq, nb, dh, false);
+        }
+        for (size_t i = 0; i < nq; ++i) {
+            float *row = sc + i * KV_BLOCK;
+            // row i sees keys [0, first + i / group]
+            const size_t lim = first + i / group + 1;
+            const size_t vis = std::min(nb, lim > t0 ? lim - t0 : 0);
+            const float m_block = vis ? *std::max_element(row, row + vis) : m[i];
+            if (m_block > m[i]) {
+                const float alpha = std::exp(m[i] - m_block);
+                l[i] *= alpha;
+                scale_n(acc + i * dv, alpha, dv);
+                m[i] = m_block;
+            }
+            l[i] += exp_sum(row, m[i], vis);
+            std::fill(row + vis, row + nb, 0.0f);
+        }
+        if constexpr (IS_CODE<TK>) {
+            gemm::gemm_tile(acc, dv, sc, KV_BLOCK, vt, 1, dv, nq, dv, nb, true);
+        } else {
+            gemm::gemm_tile(acc, dv, sc, KV_BLOCK, v.at(t0), 1, v.s0, nq, dv, nb, true);
+        }
+    }
+    for (size_t i = 0; i < nq; ++i) {
+        scale_n(acc + i * dv, 1.0f / l[i], dv);
+        llaisys::utils::convert_n(out + (i / group) * ldo + (i % group) * dv, acc + i * dv, dv);
+    }
+}
+
+// Every (sequence, KV head, query block) is independent, and so is every
+// (sequence, KV head, decode position, key split), so a whole ragged batch is
+// one list of tasks on the pool. Under the causal mask the cost of a task
+// grows with the keys it visits, so tasks are handed out longest first and
+// the short ones fill in behind the long ones instead of leaving threads idle
+// at the end.
+//
+// Prefill tiles hold about Q_BLOCK rows, i.e. Q_BLOCK / group positions of all
+// the heads of a group. Below MR positions (decode) packing the K/V tiles
+// would cost more than the products, so each position reads K and V directly
+// with attend_group. Decode has only nkvhead rows per position, so when
+// threads would idle and the context is long, every row's keys are also split
+// into nsplit ranges (flash-decoding) whose partial states are merged
+// afterwards.
+struct Task {
+    size_t seq, kv_h;
+    size_t s0, npos; // query positions [s0, s0 + npos) of a tile; npos = 0 for a decode row at s0
+    size_t split, state;
+    size_t cost; // rows times keys visited
+};
+
+template <typename T, typename TK>
+void self_attention_(T *out, const T *q, const TK *k, const TK *v, const llaisys::ops::cpu::AttentionShape &sh,
+                     const llaisys::ops::cpu::AttentionSeq *seqs, size_t nseq,
+                     const llaisys::ops::cpu::KVPages *pages, const llaisys::ops::cpu::KVScales *scales,
+                     float scale) {
+    using llaisys::ops::cpu::AttentionSeq;
+    const size_t group = sh.nhead / sh.nkvhead;
+    const auto k_rows = [&](const AttentionSeq &sq, size_t kv_h) {
+        Rows<TK> r{k + sq.k_begin * sh.k_s0 + kv_h * sh.k_s1, sh.k_s0, nullptr, 0, 0, nullptr, 0, 0};
+        if (pages) {
+            r.table = sq.table;
+            r.block = pages->block_size;
+            r.block_stride = pages->k_block_stride;
+        }
+        if (scales) {
+            r.scale = scales->k + sq.k_begin * scales->k_s0 + kv_h * scales->k_s1;
+            r.scale_s0 = scales->k_s0;
+            r.scale_block_stride = scales->k_block_stride;
+        }
+        return r;
+    };
+    const auto v_rows = [&](const AttentionSeq &sq, size_t kv_h) {
+        Rows<TK> r{v + sq.k_begin * sh.v_s0 + kv_h * sh.v_s1, sh.v_s0, nullptr, 0, 0, nullptr, 0, 0};
+        if (pages) {
+            r.table = sq.table;
+            r.block = pages->block_size;
+            r.block_stride = pages->v_block_stride;
+        }
+        if (scales) {
+            r.scale = scales->v + sq.k_begin * scales->v_s0 + kv_h * scales->v_s1;
+            r.scale_s0 = scales->v_s0;
+            r.scale_block_stride = scales->v_block_stride;
+        }
+        return r;
+    };
+    auto &pool = llaisys::device::cpu::threadPool();
+
+    size_t ndecode = 0;
+    for (size_t b = 0; b < nseq; ++b) {
+        ndecode += seqs[b].seqlen < gemm::MR ? seqs[b].seqlen * sh.nkvhead : 0;
+    }
+    // owned by the calling thread: workers must go through the pointers
+    thread_local std::vector<Task> tasks;
+    thread_local std::vector<size_t> nsplits;
+    tasks.clear();
+    nsplits.assign(nseq, 0);
+    size_t nstate = 0;
+    for (size_t b = 0; b < nseq; ++b) {
+        const AttentionSeq &sq = seqs[b];
+        if (sq.seqlen == 0) {
+            continue;
+        }
+        // the queries are the last seqlen keys
+        const size_t q_start = sq.total_len - sq.seqlen;
+        if (sq.seqlen >= gemm::MR) {
+            const size_t bpos = std::max<size_t>(1, Q_BLOCK / group);
+            for (size_t s0 = 0; s0 < sq.seqlen; s0 += bpos) {
+                const size_t npos = std::min(bpos, sq.seqlen - s0);
+                for (size_t kv_h = 0; kv_h < sh.nkvhead; ++kv_h) {
+                    tasks.push_back({b, kv_h, s0, npos, 0, 0, npos * (q_start + s0 + npos)});
+                }
+            }
+            continue;
+        }
+        const size_t nsplit = std::max<size_t>(1, std::min((pool.size() + ndecode - 1) / ndecode,
+                                                           sq.total_len / SPLIT_MIN_KEYS));
+        nsplits[b] = nsplit;
+        for (size_t s = 0; s < sq.seqlen; ++s) {
+            for (size_t kv_h = 0; kv_h < sh.nkvhead; ++kv_h) {
+                for (size_t c = 0; c < nsplit; ++c) {
+                    tasks.push_back({b, kv_h, s, 0, c, nstate++, (q_start + s + 1) / nsplit});
+                }
+            }
+        }
+    }
+    // costliest first, ties in the order planned (std::stable_sort would
+    // allocate a buffer per call)
+    std::sort(tasks.begin(), tasks.end(), [](const Task &x, const Task &y) {
+        return x.cost != y.cost ? x.cost > y.cost
+                                : std::tie(x.seq, x.s0, x.kv_h, x.split) < std::tie(y.seq, y.s0, y.kv_h, y.split);
+    });
+
+    const size_t stride = state_size(group, sh.v_dim);
+    thread_local std::vector<float> workspace;
+    workspace.resize(nstate * stride);
+    float *states = workspace.data();
+    const Task *task_list = tasks.data();
+    const size_t *split_counts = nsplits.data();
+    const auto run_task = [&](size_t i) {
+        const Task &t = task_list[i];
+        const AttentionSeq &sq = seqs[t.seq];
+        const size_t q_start = sq.total_len - sq.seqlen;
+        const size_t h = t.kv_h * group;
+        const size_t row = sq.q_begin + t.s0;
+        if (t.npos > 0) {
+            attend_tile(out + (row * sh.nhead + h) * sh.v_dim, sh.nhead * sh.v_dim,
+                        q + row * sh.q_s0 + h * sh.q_s1, sh.q_s0, sh.q_s1,
+                        k_rows(sq, t.kv_h), v_rows(sq, t.kv_h),
+                        t.npos, group, q_start + t.s0, sh.head_dim, sh.v_dim, scale);
+            return;
+        }
+        const size_t nsplit = split_counts[t.seq];
+        const size_t len = q_start + t.s0 + 1;
+        const size_t chunk = (len + nsplit - 1) / nsplit;
+        attend_group(states + t.state * stride,
+                     q + row * sh.q_s0 + h * sh.q_s1, sh.q_s1,
+                     k_rows(sq, t.kv_h), v_rows(sq, t.kv_h),
+                     group, std::min(len, t.split * chunk), std::min(len, (t.split + 1) * chunk),
+                     sh.head_dim, sh.v_dim, scale);
+    };
+    // a std::function holds one reference in place, where the whole capture
+    // list would be allocated on every call
+    pool.run(tasks.size(), [&run_task](size_t i) { run_task(i); });
+    // decode states were numbered by (sequence, position, KV head, split)
+    size_t state = 0;
+    for (size_t b = 0; b < nseq; ++b) {
+        if (nsplits[b] == 0) {
+            continue;
+        }
+        for (size_t s = 0; s < seqs[b].seqlen; ++s) {
+            for (size_t kv_h = 0; kv_h < sh.nkvhead; ++kv_h, state += nsplits[b]) {
+                merge_states(out + ((seqs[b].q_begin + s) * sh.nhead + kv_h * group) * sh.v_dim,
+                             states + state * stride, nsplits[b], stride, group, sh.v_dim);
+            }
+        }
+    }
+}
+} // namespace
+
+namespace llaisys::ops::cpu {
+namespace {
+template <typename T>
+void dispatch_kv(T *out, const T *q, const std::byte *k, const std::byte *v, const AttentionShape &shape,
+                 const AttentionSeq *seqs, size_t nseq, const KVPages *pages, const KVScales *scales, float scale) {
+    if (!scales) {
+        return self_attention_(out, q, reinterpret_cast<const T *>(k), reinterpret_cast<const T *>(v),
+                               shape, seqs, nseq, pages, scales, scale);
+    }
+    switch (scales->type) {
+    case LLAISYS_DTYPE_I8:
+        return self_attention_(out, q, reinterpret_cast<const int8_t *>(k), reinterpret_cast<const int8_t *>(v),
+                               shape, seqs, nseq, pages, scales, scale);
+    case LLAISYS_DTYPE_F8:
+        return self_attention_(out, q, reinterpret_cast<const llaisys::fp8_t *>(k),
+                               reinterpret_cast<const llaisys::fp8_t *>(v), shape, seqs, nseq, pages, scales, scale);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(scales->type);
+    }
+}
+} // namespace
+
+void self_attention_varlen(std::byte *out, const std::byte *q, const std::byte *k, const std::byte *v,
+                           llaisysDataType_t type, const AttentionShape &shape, const AttentionSeq *seqs, size_t nseq,
+                           const KVPages *pages, const KVScales *scales, float scale) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return dispatch_kv(reinterpret_cast<float *>(out), reinterpret_cast<const float *>(q), k, v,
+                           shape, seqs, nseq, pages, scales, scale);
+    case LLAISYS_DTYPE_BF16:
+        return dispatch_kv(reinterpret_cast<llaisys::bf16_t *>(out), reinterpret_cast<const llaisys::bf16_t *>(q), k, v,
+                           shape, seqs, nseq, pages, scales, scale);
+    case LLAISYS_DTYPE_F16:
+        return dispatch_kv(reinterpret_cast<llaisys::fp16_t *>(out), reinterpret_cast<const llaisys::fp16_t *>(q), k, v,
+                           shape, seqs, nseq, pages, scales, scale);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+
+void self_attention(std::byte *out, const std::byte *q, const std::byte *k, const std::byte *v,
+                    llaisysDataType_t type, const AttentionShape &shape, const KVScales *scales, float scale) {
+    const AttentionSeq seq{0, shape.seqlen, 0, shape.total_len, nullptr};
+    self_attention_varlen(out, q, k, v, type, shape, &seq, 1, nullptr, scales, scale);
+}
+
+void self_attention_paged(std::byte *out, const std::byte *q, const std::byte *k, const std::byte *v,
+                          llaisysDataType_t type, const AttentionShape &shape, const KVPages &pages,
+                          const KVScales *scales, float scale) {
+    const AttentionSeq seq{0, shape.seqlen, 0, shape.total_len, pages.table};
+    self_attention_varlen(out, q, k, v, type, shape, &seq, 1, &pages, scales, scale);
+}
+} // namespace llaisys::ops::cpu
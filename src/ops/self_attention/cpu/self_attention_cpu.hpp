@@ -0,0 +1,77 @@
+#pragma once
+#include "llaisys.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace llaisys::ops::cpu {
+// Largest head dimension (of q/k and of v) the kernels keep on the stack.
+constexpr size_t ATTENTION_MAX_HEAD_DIM = 256;
+
+// Causal attention over `total_len` keys, of which the `seqlen` queries are
+// the last ones (a KV cache followed by the current tokens). Rows of q, k and
+// v are `head_dim` (`v_dim`) contiguous elements; the strides are in elements
+// per token (s0) and per head (s1), so heads may be views of a wider buffer.
+// out is contiguous [seqlen, nhead, v_dim].
+struct AttentionShape {
+    size_t seqlen, total_len;
+    size_t nhead, nkvhead;
+    size_t head_dim, v_dim;
+    ptrdiff_t q_s0, q_s1;
+    ptrdiff_t k_s0, k_s1;
+    ptrdiff_t v_s0, v_s1;
+};
+
+// Paged K/V: key t is row t % block_size of block table[t / block_size] of a
+// block pool, blocks k_block_stride (v_block_stride) elements apart. Inside a
+// block rows and heads follow the s0/s1 strides of AttentionShape.
+struct KVPages {
+    const int32_t *table;
+    size_t block_size;
+    ptrdiff_t k_block_stride, v_block_stride;
+};
+
+// Quantized K/V (QuantScheme::ROW_SCALE): k and v hold I8 or F8 codes and
+// row t of KV head h is scaled by k[t * k_s0 + h * k_s1] (v likewise), with
+// the blocks of paged scales k_block_stride (v_block_stride) floats apart.
+// Kernels dequantize rows as they stream them.
+struct KVScales {
+    llaisysDataType_t type;
+    const float *k, *v;
+    ptrdiff_t k_s0, k_s1, v_s0, v_s1;
+    ptrdiff_t k_block_stride, v_block_stride;
+};
+
+// `scales` is null unless k and v are quantized; out and q are of `type`.
+void self_attention(std::byte *out, const std::byte *q, const std::byte *k, const std::byte *v,
+                    llaisysDataType_t type, const AttentionShape &shape, const KVScales *scales, float scale);
+
+// self_attention with k and v the first blocks of their pools.
+void self_attention_paged(std::byte *out, const std::byte *q, const std::byte *k, const std::byte *v,
+                          llaisysDataType_t type, const AttentionShape &shape, const KVPages &pages,
+                          const KVScales *scales, float scale);
+
+// One sequence of a ragged batch: its `seqlen` queries are q/out rows
+// [q_begin, q_begin + seqlen) and the last of its `total_len` keys, which are
+// K/V rows [k_begin, k_begin + total_len) or, when paged, reached through its
+// own block `table` (k_begin then 0). Each sequence has its own causal mask.
+struct AttentionSeq {
+    size_t q_begin, seqlen;
+    size_t k_begin, total_len;
+    const int32_t *table;
+};
+
+// self_attention of every sequence of a batch in one pass over the thread
+// pool; `pages` (its table unused) is null unless K/V are paged. shape's
+// seqlen and total_len are unused.
+void self_attention_varlen(std::byte *out, const std::byte *q, const std::byte *k, const std::byte *v,
+                           llaisysDataType_t type, const AttentionShape &shape, const AttentionSeq *seqs, size_t nseq,
+                           const KVPages *pages, const KVScales *scales, float scale);
+
+// Quantizes `nrows` contiguous rows of `d` elements of x (of `type`) to
+// `code_type` codes (I8 or F8) with one F32 scale per row: max|row| / 127 for
+// I8, max|row| / 448 (the largest E4M3 value) for F8. All-zero rows get
+// scale 0.
+void quantize_kv_rows(std::byte *codes, float *scales, const std::byte *x, llaisysDataType_t type,
+                      llaisysDataType_t code_type, size_t nrows, size_t d);
+} // namespace llaisys::ops::cpu
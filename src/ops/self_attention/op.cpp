@@ -1,121 +1,261 @@
 #include "op.hpp"
+
+#include "../../core/llaisys_core.hpp"
 #include "../../utils.hpp"
-#include <cmath>
-#include <vector>
-#include <limits>
+
+#include "cpu/self_attention_cpu.hpp"
+
 #include <algorithm>
+#include <optional>
+#include <vector>
 
 namespace llaisys::ops {
+namespace {
+// Checks shared by the contiguous and paged forms; k and v are [.., nkvh, d]
+// with the rows of a head contiguous.
+cpu::AttentionShape attention_shape(tensor_t attn_val, tensor_t q, tensor_t k, tensor_t v, size_t total_len) {
+    CHECK_SAME_DEVICE(attn_val, q, k, v);
+    CHECK_SAME_DTYPE(attn_val->dtype(), q->dtype());
+    CHECK_SAME_DTYPE(k->dtype(), v->dtype());
+    CHECK_ARGUMENT(k->isQuantized() || k->dtype() == q->dtype(),
+                   "SelfAttention: k and v must be of the query type unless quantized.");
+    ASSERT(attn_val->ndim() == 3 && q->ndim() == 3, "SelfAttention: q and output must be [seq, head, dim].");
+    ASSERT(attn_val->isContiguous(), "SelfAttention: output must be contiguous.");
+    ASSERT(q->strides()[2] == 1 && k->strides()[k->ndim() - 1] == 1 && v->strides()[v->ndim() - 1] == 1,
+           "SelfAttention: head dimension must be contiguous.");
 
-template <typename T>
-void self_attention_cpu(tensor_t attn_val, tensor_t q, tensor_t k, tensor_t v, float scale) {
-    size_t seqlen = q->shape()[0];
-    size_t nhead = q->shape()[1];
-    size_t head_dim = q->shape()[2];
-    
-    size_t total_len = k->shape()[0];
-    size_t nkvhead = k->shape()[1];
-    size_t v_dim = v->shape()[2];
-    
-    size_t group_size = nhead / nkvhead;
-
-    // 计算当前 Q 在 K 中的起始偏移量 (假设 K 包含了 Q，且 Q 位于 K 的末尾)
-    // 这是 standard KV Cache 的布局
-    size_t q_start_index = total_len - seqlen;
-
-    T* out_ptr = reinterpret_cast<T*>(attn_val->data());
-    const T* q_ptr = reinterpret_cast<const T*>(q->data());
-    const T* k_ptr = reinterpret_cast<const T*>(k->data());
-    const T* v_ptr = reinterpret_cast<const T*>(v->data());
-
-    // 预分配 scores 内存
-    std::vector<float> scores(total_len);
-
-    for (size_t s = 0; s < seqlen; ++s) {
-        for (size_t h = 0; h < nhead; ++h) {
-            size_t kv_h = h / group_size;
-            
-            const T* q_vec = q_ptr + (s * nhead + h) * head_dim;
-
-            float max_score = -std::numeric_limits<float>::infinity();
-
-            // --- 1. 计算 Attention Scores ---
-            for (size_t t = 0; t < total_len; ++t) {
-                const T* k_vec = k_ptr + (t * nkvhead + kv_h) * head_dim;
-
-                float dot = 0.0f;
-                for (size_t i = 0; i < head_dim; ++i) {
-                    dot += utils::cast<float>(q_vec[i]) * utils::cast<float>(k_vec[i]);
-                }
-                float score = dot * scale;
-
-                // --- 修正后的 Causal Masking ---
-                // s 是当前处理的 token 在 Q 中的下标 (0, 1, 2...)
-                // absolute_pos 是它在整个 K (历史+当前) 中的绝对下标
-                size_t absolute_pos = q_start_index + s;
-
-                // 我们只能看 absolute_pos 及其之前的内容
-                if (t > absolute_pos) {
-                    score = -std::numeric_limits<float>::infinity();
-                }
-
-                scores[t] = score;
-                if (score > max_score) max_score = score;
-            }
-
-            // --- 2. Softmax ---
-            float sum_exp = 0.0f;
-            for (size_t t = 0; t < total_len; ++t) {
-                if (scores[t] == -std::numeric_limits<float>::infinity()) {
-                    scores[t] = 0.0f; 
-                } else {
-                    float exp_val = std::exp(scores[t] - max_score);
-                    scores[t] = exp_val;
-                    sum_exp += exp_val;
-                }
-            }
-            
-            float inv_sum = 1.0f / (sum_exp + 1e-6f);
-            for (size_t t = 0; t < total_len; ++t) {
-                scores[t] *= inv_sum;
-            }
-
-            // --- 3. Weighted Sum ---
-            T* out_vec = out_ptr + (s * nhead + h) * v_dim;
-            
-            std::vector<float> acc(v_dim, 0.0f);
-
-            for (size_t t = 0; t < total_len; ++t) {
-                float prob = scores[t];
-                if (prob < 1e-9f) continue;
-
-                const T* v_vec = v_ptr + (t * nkvhead + kv_h) * v_dim;
-                for (size_t i = 0; i < v_dim; ++i) {
-                    acc[i] += prob * utils::cast<float>(v_vec[i]);
-                }
-            }
-
-            for (size_t i = 0; i < v_dim; ++i) {
-                out_vec[i] = utils::cast<T>(acc[i]);
-            }
-        }
+    const size_t kd = k->ndim();
+    cpu::AttentionShape shape{q->shape()[0], total_len,
+                              q->shape()[1], k->shape()[kd - 2],
+                              q->shape()[2], v->shape()[kd - 1],
+                              q->strides()[0], q->strides()[1],
+                              k->strides()[kd - 3], k->strides()[kd - 2],
+                              v->strides()[kd - 3], v->strides()[kd - 2]};
+    CHECK_ARGUMENT(shape.nkvhead > 0 && shape.nhead % shape.nkvhead == 0,
+                   "SelfAttention: query heads must be a multiple of kv heads.");
+    CHECK_ARGUMENT(k->shape()[kd - 1] == shape.head_dim, "SelfAttention: q and k must share the head dimension.");
+    CHECK_ARGUMENT(v->ndim() == kd && v->shape()[kd - 2] == shape.nkvhead,
+                   "SelfAttention: k and v must have the same length and heads.");
+    CHECK_ARGUMENT(shape.total_len >= shape.seqlen, "SelfAttention: queries must be the last keys.");
+    CHECK_ARGUMENT(attn_val->shape()[0] == shape.seqlen && attn_val->shape()[1] == shape.nhead
+                       && attn_val->shape()[2] == shape.v_dim,
+                   "SelfAttention: output shape must be [q.shape[0], q.shape[1], v.shape[-1]].");
+    CHECK_ARGUMENT(shape.head_dim <= cpu::ATTENTION_MAX_HEAD_DIM && shape.v_dim <= cpu::ATTENTION_MAX_HEAD_DIM,
+                   "SelfAttention: head dimension too large.");
+    return shape;
+}
+
+// The row scales of ROW_SCALE quantized k and v, or nothing for plain ones.
+std::optional<cpu::KVScales> kv_scales(tensor_t k, tensor_t v) {
+    CHECK_ARGUMENT(k->quant().scheme == v->quant().scheme, "SelfAttention: k and v must be quantized alike.");
+    if (!k->isQuantized()) {
+        return std::nullopt;
+    }
+    ASSERT(k->quant().scheme == QuantScheme::ROW_SCALE, "SelfAttention: unsupported K/V quantization.");
+    ASSERT(k->dtype() == LLAISYS_DTYPE_I8 || k->dtype() == LLAISYS_DTYPE_F8,
+           "SelfAttention: quantized K/V must be I8 or F8 codes.");
+    const size_t kd = k->ndim();
+    for (const tensor_t &x : {k, v}) {
+        const tensor_t &s = x->quant().scales;
+        ASSERT(s && s->dtype() == LLAISYS_DTYPE_F32, "SelfAttention: K/V scales must be F32.");
+        CHECK_SAME_DEVICE(x, s);
+        CHECK_ARGUMENT(s->ndim() == kd - 1
+                           && std::equal(s->shape().begin(), s->shape().end(), x->shape().begin()),
+                       "SelfAttention: K/V scales must be shaped like the codes without the last dimension.");
     }
+    const tensor_t &ks = k->quant().scales;
+    const tensor_t &vs = v->quant().scales;
+    return cpu::KVScales{k->dtype(),
+                         reinterpret_cast<const float *>(ks->data()), reinterpret_cast<const float *>(vs->data()),
+                         ks->strides()[kd - 3], ks->strides()[kd - 2], vs->strides()[kd - 3], vs->strides()[kd - 2],
+                         ks->strides()[0], vs->strides()[0]};
 }
+} // namespace
 
 void self_attention(tensor_t attn_val, tensor_t q, tensor_t k, tensor_t v, float scale) {
-    switch (q->dtype()) {
-        case LLAISYS_DTYPE_F32:
-            self_attention_cpu<float>(attn_val, q, k, v, scale);
-            break;
-        case LLAISYS_DTYPE_F16:
-            self_attention_cpu<fp16_t>(attn_val, q, k, v, scale);
-            break;
-        case LLAISYS_DTYPE_BF16:
-            self_attention_cpu<bf16_t>(attn_val, q, k, v, scale);
-            break;
-        default:
-            break;
+    ASSERT(k->ndim() == 3 && v->ndim() == 3, "SelfAttention: k and v must be [seq, head, dim].");
+    CHECK_ARGUMENT(v->shape()[0] == k->shape()[0], "SelfAttention: k and v must have the same length and heads.");
+    const cpu::AttentionShape shape = attention_shape(attn_val, q, k, v, k->shape()[0]);
+    const std::optional<cpu::KVScales> scales = kv_scales(k, v);
+
+    // always support cpu calculation
+    if (attn_val->deviceType() == LLAISYS_DEVICE_CPU) {
+        return cpu::self_attention(attn_val->data(), q->data(), k->data(), v->data(), attn_val->dtype(), shape,
+                                   scales ? &*scales : nullptr, scale);
+    }
+
+    llaisys::core::context().setDevice(attn_val->deviceType(), attn_val->deviceId());
+
+    switch (attn_val->deviceType()) {
+    case LLAISYS_DEVICE_CPU:
+        return cpu::self_attention(attn_val->data(), q->data(), k->data(), v->data(), attn_val->dtype(), shape,
+                                   scales ? &*scales : nullptr, scale);
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+
+void self_attention_paged(tensor_t attn_val, tensor_t q, tensor_t k_cache, tensor_t v_cache,
+                          tensor_t block_table, size_t total_len, float scale) {
+    ASSERT(k_cache->ndim() == 4 && v_cache->ndim() == 4,
+           "SelfAttentionPaged: caches must be [num_blocks, block_size, head, dim].");
+    CHECK_ARGUMENT(v_cache->shape()[0] == k_cache->shape()[0] && v_cache->shape()[1] == k_cache->shape()[1],
+                   "SelfAttentionPaged: k and v caches must have the same blocks.");
+    ASSERT(block_table->ndim() == 1 && block_table->dtype() == LLAISYS_DTYPE_I32 && block_table->isContiguous(),
+           "SelfAttentionPaged: block table must be a contiguous I32 vector.");
+    ASSERT(block_table->deviceType() == LLAISYS_DEVICE_CPU, "SelfAttentionPaged: block table must be on the host.");
+    const cpu::AttentionShape shape = attention_shape(attn_val, q, k_cache, v_cache, total_len);
+    const std::optional<cpu::KVScales> scales = kv_scales(k_cache, v_cache);
+
+    const size_t num_blocks = k_cache->shape()[0];
+    const cpu::KVPages pages{reinterpret_cast<const int32_t *>(block_table->data()), k_cache->shape()[1],
+                             k_cache->strides()[0], v_cache->strides()[0]};
+    CHECK_ARGUMENT(pages.block_size > 0 && block_table->shape()[0] * pages.block_size >= total_len,
+                   "SelfAttentionPaged: block table too short for total_len.");
+    for (size_t b = 0; b < (total_len + pages.block_size - 1) / pages.block_size; ++b) {
+        CHECK_ARGUMENT(pages.table[b] >= 0 && static_cast<size_t>(pages.table[b]) < num_blocks,
+                       "SelfAttentionPaged: block id out of range.");
+    }
+
+    if (attn_val->deviceType() == LLAISYS_DEVICE_CPU) {
+        return cpu::self_attention_paged(attn_val->data(), q->data(), k_cache->data(), v_cache->data(),
+                                         attn_val->dtype(), shape, pages, scales ? &*scales : nullptr, scale);
+    }
+
+    llaisys::core::context().setDevice(attn_val->deviceType(), attn_val->deviceId());
+
+    switch (attn_val->deviceType()) {
+    case LLAISYS_DEVICE_CPU:
+        return cpu::self_attention_paged(attn_val->data(), q->data(), k_cache->data(), v_cache->data(),
+                                         attn_val->dtype(), shape, pages, scales ? &*scales : nullptr, scale);
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+
+void self_attention_varlen(tensor_t attn_val, tensor_t q, tensor_t k, tensor_t v,
+                           tensor_t cu_seqlens_q, tensor_t cu_seqlens_k, float scale) {
+    ASSERT(k->ndim() == 3 && v->ndim() == 3, "SelfAttentionVarlen: k and v must be [tokens, head, dim].");
+    CHECK_ARGUMENT(v->shape()[0] == k->shape()[0], "SelfAttentionVarlen: k and v must have the same length and heads.");
+    for (const tensor_t &cu : {cu_seqlens_q, cu_seqlens_k}) {
+        ASSERT(cu->ndim() == 1 && cu->dtype() == LLAISYS_DTYPE_I32 && cu->isContiguous(),
+               "SelfAttentionVarlen: cu_seqlens must be contiguous I32 vectors.");
+        ASSERT(cu->deviceType() == LLAISYS_DEVICE_CPU, "SelfAttentionVarlen: cu_seqlens must be on the host.");
+    }
+    CHECK_ARGUMENT(cu_seqlens_q->shape()[0] == cu_seqlens_k->shape()[0] && cu_seqlens_q->shape()[0] > 0,
+                   "SelfAttentionVarlen: cu_seqlens_q and cu_seqlens_k must both be [batch + 1].");
+    const cpu::AttentionShape shape = attention_shape(attn_val, q, k, v, k->shape()[0]);
+    const std::optional<cpu::KVScales> scales = kv_scales(k, v);
+
+    const int32_t *cu_q = reinterpret_cast<const int32_t *>(cu_seqlens_q->data());
+    const int32_t *cu_k = reinterpret_cast<const int32_t *>(cu_seqlens_k->data());
+    const size_t batch = cu_seqlens_q->shape()[0] - 1;
+    CHECK_ARGUMENT(cu_q[0] == 0 && cu_k[0] == 0 && static_cast<size_t>(cu_q[batch]) == shape.seqlen
+                       && static_cast<size_t>(cu_k[batch]) == shape.total_len,
+                   "SelfAttentionVarlen: cu_seqlens must run from 0 to the q and k lengths.");
+    std::vector<cpu::AttentionSeq> seqs(batch);
+    for (size_t b = 0; b < batch; ++b) {
+        CHECK_ARGUMENT(cu_q[b + 1] >= cu_q[b] && cu_k[b + 1] - cu_k[b] >= cu_q[b + 1] - cu_q[b],
+                       "SelfAttentionVarlen: each sequence needs at least as many keys as queries.");
+        seqs[b] = {static_cast<size_t>(cu_q[b]), static_cast<size_t>(cu_q[b + 1] - cu_q[b]),
+                   static_cast<size_t>(cu_k[b]), static_cast<size_t>(cu_k[b + 1] - cu_k[b]), nullptr};
+    }
+
+    if (attn_val->deviceType() == LLAISYS_DEVICE_CPU) {
+        return cpu::self_attention_varlen(attn_val->data(), q->data(), k->data(), v->data(), attn_val->dtype(), shape,
+                                          seqs.data(), batch, nullptr, scales ? &*scales : nullptr, scale);
+    }
+
+    llaisys::core::context().setDevice(attn_val->deviceType(), attn_val->deviceId());
+
+    switch (attn_val->deviceType()) {
+    case LLAISYS_DEVICE_CPU:
+        return cpu::self_attention_varlen(attn_val->data(), q->data(), k->data(), v->data(), attn_val->dtype(), shape,
+                                          seqs.data(), batch, nullptr, scales ? &*scales : nullptr, scale);
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
     }
 }
 
-} // namespace llaisys::ops
\ No newline at end of file
+void self_attention_paged_varlen(tensor_t attn_val, tensor_t q, tensor_t k_cache, tensor_t v_cache,
+                                 tensor_t cu_seqlens_q, tensor_t seq_lens_k, tensor_t block_tables, float scale) {
+    ASSERT(k_cache->ndim() == 4 && v_cache->ndim() == 4,
+           "SelfAttentionPagedVarlen: caches must be [num_blocks, block_size, head, dim].");
+    CHECK_ARGUMENT(v_cache->shape()[0] == k_cache->shape()[0] && v_cache->shape()[1] == k_cache->shape()[1],
+                   "SelfAttentionPagedVarlen: k and v caches must have the same blocks.");
+    for (const tensor_t &t : {cu_seqlens_q, seq_lens_k, block_tables}) {
+        ASSERT(t->dtype() == LLAISYS_DTYPE_I32 && t->isContiguous(),
+               "SelfAttentionPagedVarlen: cu_seqlens_q, seq_lens_k and block_tables must be contiguous I32.");
+        ASSERT(t->deviceType() == LLAISYS_DEVICE_CPU, "SelfAttentionPagedVarlen: batch metadata must be on the host.");
+    }
+    ASSERT(cu_seqlens_q->ndim() == 1 && seq_lens_k->ndim() == 1 && block_tables->ndim() == 2,
+           "SelfAttentionPagedVarlen: cu_seqlens_q and seq_lens_k are vectors, block_tables a matrix.");
+    const size_t batch = seq_lens_k->shape()[0];
+    CHECK_ARGUMENT(cu_seqlens_q->shape()[0] == batch + 1 && block_tables->shape()[0] == batch,
+                   "SelfAttentionPagedVarlen: cu_seqlens_q must be [batch + 1] and block_tables [batch, max_blocks].");
+    // total_len only bounds the queries here; each sequence has its own
+    const cpu::AttentionShape shape = attention_shape(attn_val, q, k_cache, v_cache, q->shape()[0]);
+    const std::optional<cpu::KVScales> scales = kv_scales(k_cache, v_cache);
+
+    const size_t num_blocks = k_cache->shape()[0], max_blocks = block_tables->shape()[1];
+    const cpu::KVPages pages{nullptr, k_cache->shape()[1], k_cache->strides()[0], v_cache->strides()[0]};
+    const int32_t *cu_q = reinterpret_cast<const int32_t *>(cu_seqlens_q->data());
+    const int32_t *lens = reinterpret_cast<const int32_t *>(seq_lens_k->data());
+    const int32_t *tables = reinterpret_cast<const int32_t *>(block_tables->data());
+    CHECK_ARGUMENT(pages.block_size > 0 && cu_q[0] == 0 && static_cast<size_t>(cu_q[batch]) == shape.seqlen,
+                   "SelfAttentionPagedVarlen: cu_seqlens_q must run from 0 to the q length.");
+    // runs in every layer of every decode step: the descriptors reuse a scratch that only grows
+    thread_local std::vector<cpu::AttentionSeq> seqs;
+    seqs.resize(std::max(seqs.size(), batch));
+    for (size_t b = 0; b < batch; ++b) {
+        CHECK_ARGUMENT(cu_q[b + 1] >= cu_q[b] && lens[b] >= cu_q[b + 1] - cu_q[b],
+                       "SelfAttentionPagedVarlen: each sequence needs at least as many keys as queries.");
+        const size_t nblock = (static_cast<size_t>(lens[b]) + pages.block_size - 1) / pages.block_size;
+        CHECK_ARGUMENT(nblock <= max_blocks, "SelfAttentionPagedVarlen: block table too short for seq_lens_k.");
+        const int32_t *table = tables + b * max_blocks;
+        for (size_t i = 0; i < nblock; ++i) {
+            CHECK_ARGUMENT(table[i] >= 0 && static_cast<size_t>(table[i]) < num_blocks,
+                           "SelfAttentionPagedVarlen: block id out of range.");
+        }
+        seqs[b] = {static_cast<size_t>(cu_q[b]), static_cast<size_t>(cu_q[b + 1] - cu_q[b]),
+                   0, static_cast<size_t>(lens[b]), table};
+    }
+
+    if (attn_val->deviceType() == LLAISYS_DEVICE_CPU) {
+        return cpu::self_attention_varlen(attn_val->data(), q->data(), k_cache->data(), v_cache->data(),
+                                          attn_val->dtype(), shape, seqs.data(), batch, &pages,
+                                          scales ? &*scales : nullptr, scale);
+    }
+
+    llaisys::core::context().setDevice(attn_val->deviceType(), attn_val->deviceId());
+
+    switch (attn_val->deviceType()) {
+    case LLAISYS_DEVICE_CPU:
+        return cpu::self_attention_varlen(attn_val->data(), q->data(), k_cache->data(), v_cache->data(),
+                                          attn_val->dtype(), shape, seqs.data(), batch, &pages,
+                                          scales ? &*scales : nullptr, scale);
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+} // namespace llaisys::ops
@@ -3,5 +3,26 @@
 #include "../../tensor/tensor.hpp"
 
 namespace llaisys::ops {
+// k and v are of q's type, or both I8/F8 codes tagged QuantScheme::ROW_SCALE
+// (one F32 scale per token and head).
 void self_attention(tensor_t attn_val, tensor_t q, tensor_t k, tensor_t v, float scale);
-}
+// self_attention over the first `total_len` keys of a paged KV cache: k_cache and
+// v_cache are block pools [num_blocks, block_size, nkvh, d] and key t lives in
+// block block_table[t / block_size] (I32).
+void self_attention_paged(tensor_t attn_val, tensor_t q, tensor_t k_cache, tensor_t v_cache,
+                          tensor_t block_table, size_t total_len, float scale);
+// self_attention of a ragged batch packed without padding: sequence b has
+// queries q[cu_seqlens_q[b], cu_seqlens_q[b + 1]) and keys/values
+// k, v[cu_seqlens_k[b], cu_seqlens_k[b + 1]), its queries being its last keys
+// under its own causal mask. cu_seqlens_* are host I32 vectors [batch + 1]
+// starting at 0.
+void self_attention_varlen(tensor_t attn_val, tensor_t q, tensor_t k, tensor_t v,
+                           tensor_t cu_seqlens_q, tensor_t cu_seqlens_k, float scale);
+// self_attention_varlen over a paged KV cache, e.g. one decode step of a
+// continuous batch: sequence b has queries q[cu_seqlens_q[b],
+// cu_seqlens_q[b + 1]), the last of its seq_lens_k[b] keys, which live in the
+// blocks listed by row b of block_tables. cu_seqlens_q [batch + 1],
+// seq_lens_k [batch] and block_tables [batch, max_blocks] are host I32.
+void self_attention_paged_varlen(tensor_t attn_val, tensor_t q, tensor_t k_cache, tensor_t v_cache,
+                                 tensor_t cu_seqlens_q, tensor_t seq_lens_k, tensor_t block_tables, float scale);
+} // namespace llaisys::ops
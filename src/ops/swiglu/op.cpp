@@ -1,5 +1,6 @@
 #include "op.hpp"
 #include "../../utils.hpp"
+#include <algorithm>
 #include <cmath> // 用于 std::exp
 
 namespace llaisys::ops {
@@ -15,23 +16,29 @@ void swiglu_cpu(tensor_t out, tensor_t gate, tensor_t up) {
     const T* gate_ptr = reinterpret_cast<const T*>(gate->data());
     const T* up_ptr = reinterpret_cast<const T*>(up->data());
 
-    // 3. 逐元素计算
-    for (size_t i = 0; i < n; ++i) {
-        // 读取并转为 float
-        float g = utils::cast<float>(gate_ptr[i]); // Gate 值
-        float u = utils::cast<float>(up_ptr[i]);   // Up 值
-
-        // --- 计算 SiLU ---
-        // SiLU(g) = g / (1 + exp(-g))
-        float sigmoid = 1.0f / (1.0f + std::exp(-g));
-        float silu = g * sigmoid;
-
-        // --- 计算 SwiGLU ---
-        // result = up * SiLU(gate)
-        float res = u * silu;
-
+    // 3. 逐元素计算, widening/narrowing a tile at a time
+    constexpr size_t TILE = 256;
+    float g_tile[TILE];
+    float u_tile[TILE];
+    for (size_t i0 = 0; i0 < n; i0 += TILE) {
+        size_t len = std::min(TILE, n - i0);
+        utils::convert_n(g_tile, gate_ptr + i0, len);
+        utils::convert_n(u_tile, up_ptr + i0, len);
+        for (size_t i = 0; i < len; ++i) {
+            float g = g_tile[i]; // Gate 值
+            float u = u_tile[i]; // Up 值
+
+            // --- 计算 SiLU ---
+            // SiLU(g) = g / (1 + exp(-g))
+            float sigmoid = 1.0f / (1.0f + std::exp(-g));
+            float silu = g * sigmoid;
+
+            // --- 计算 SwiGLU ---
+            // result = up * SiLU(gate)
+            g_tile[i] = u * silu;
+        }
         // 存回结果
-        out_ptr[i] = utils::cast<T>(res);
+        utils::convert_n(out_ptr + i0, g_tile, len);
     }
 }
 
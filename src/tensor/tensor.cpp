@@ -76,6 +76,18 @@ size_t Tensor::elementSize() const {
     return utils::dsize(_meta.dtype);
 }
 
+TensorLayout Tensor::layout() const {
+    return _meta.layout;
+}
+
+const TensorQuant &Tensor::quant() const {
+    return _meta.quant;
+}
+
+bool Tensor::isQuantized() const {
+    return _meta.quant.scheme != QuantScheme::NONE;
+}
+
 std::string Tensor::info() const {
     std::stringstream ss;
 
@@ -89,6 +101,18 @@ std::string Tensor::info() const {
         ss << s << " ";
     }
     ss << "] dtype=" << this->dtype();
+    if (this->layout() == TensorLayout::LINEAR_PACKED) {
+        ss << " layout=linear_packed";
+    } else if (this->layout() == TensorLayout::NIBBLE_PACKED) {
+        ss << " layout=nibble_packed";
+    }
+    if (this->quant().scheme == QuantScheme::INT8_CHANNEL) {
+        ss << " quant=int8_channel";
+    } else if (this->quant().scheme == QuantScheme::Q4_GROUP) {
+        ss << " quant=q4_group" << this->quant().group_size << (this->quant().zeros ? "_zp" : "");
+    } else if (this->quant().scheme == QuantScheme::ROW_SCALE) {
+        ss << " quant=row_scale";
+    }
 
     return ss.str();
 }
@@ -97,7 +121,7 @@ template <typename T>
 void print_data(const T *data, const std::vector<size_t> &shape, const std::vector<ptrdiff_t> &strides, size_t dim) {
     if (dim == shape.size() - 1) {
         for (size_t i = 0; i < shape[dim]; i++) {
-            if constexpr (std::is_same_v<T, bf16_t> || std::is_same_v<T, fp16_t>) {
+            if constexpr (std::is_same_v<T, bf16_t> || std::is_same_v<T, fp16_t> || std::is_same_v<T, fp8_t>) {
                 std::cout << utils::cast<float>(data[i * strides[dim]]) << " ";
             } else {
                 std::cout << data[i * strides[dim]] << " ";
@@ -133,6 +157,8 @@ void debug_print(const std::byte *data, const std::vector<size_t> &shape, const
         return print_data(reinterpret_cast<const uint32_t *>(data), shape, strides, 0);
     case LLAISYS_DTYPE_U64:
         return print_data(reinterpret_cast<const uint64_t *>(data), shape, strides, 0);
+    case LLAISYS_DTYPE_F8:
+        return print_data(reinterpret_cast<const fp8_t *>(data), shape, strides, 0);
     case LLAISYS_DTYPE_F16:
         return print_data(reinterpret_cast<const fp16_t *>(data), shape, strides, 0);
     case LLAISYS_DTYPE_F32:
@@ -150,6 +176,9 @@ void Tensor::debug() const {
     core::context().setDevice(this->deviceType(), this->deviceId());
     core::context().runtime().api()->device_synchronize();
     std::cout << this->info() << std::endl;
+    if (this->layout() != TensorLayout::STRIDED) {
+        return;
+    }
     if (this->deviceType() == LLAISYS_DEVICE_CPU) {
         debug_print(this->data(), this->shape(), this->strides(), this->dtype());
     } else {
@@ -164,6 +193,9 @@ void Tensor::debug() const {
 }
 
 bool Tensor::isContiguous() const {
+    if (this->layout() != TensorLayout::STRIDED) {
+        return false;
+    }
     const auto &shape = this->shape();
     const auto &strides = this->strides();
     int ndim = this->ndim();
@@ -191,6 +223,8 @@ bool Tensor::isContiguous() const {
 
 tensor_t Tensor::permute(const std::vector<size_t> &order) const {
     size_t n = this->ndim();
+    CHECK_ARGUMENT(this->layout() == TensorLayout::STRIDED, "permute: tensor has a packed layout");
+    CHECK_ARGUMENT(!this->isQuantized(), "permute: tensor is quantized");
     
     // 1. 安全检查：输入的维度顺序必须和原维度数量一致
     if (order.size() != n) {
@@ -248,8 +282,30 @@ tensor_t Tensor::view(const std::vector<size_t> &shape) const {
     return std::shared_ptr<Tensor>(new Tensor(new_meta, this->_storage, this->_offset));
 }
 
+tensor_t Tensor::withLayout(TensorLayout layout, const std::vector<size_t> &shape) const {
+    CHECK_ARGUMENT(this->isContiguous(), "withLayout: tensor must be contiguous");
+    // strides are kept row-major for reference only, packed kernels do their own addressing
+    size_t ndim = shape.size();
+    std::vector<ptrdiff_t> strides(ndim);
+    size_t stride = 1;
+    for (size_t i = 1; i <= ndim; i++) {
+        strides[ndim - i] = stride;
+        stride *= shape[ndim - i];
+    }
+    TensorMeta meta{this->dtype(), shape, strides, layout, this->quant()};
+    return std::shared_ptr<Tensor>(new Tensor(meta, this->_storage, this->_offset));
+}
+
+tensor_t Tensor::withQuant(TensorQuant quant) const {
+    TensorMeta meta = _meta;
+    meta.quant = std::move(quant);
+    return std::shared_ptr<Tensor>(new Tensor(meta, this->_storage, this->_offset));
+}
+
 tensor_t Tensor::slice(size_t dim, size_t start, size_t end) const {
     // 1. 合法性检查
+    CHECK_ARGUMENT(this->layout() == TensorLayout::STRIDED, "slice: tensor has a packed layout");
+    CHECK_ARGUMENT(!this->isQuantized(), "slice: tensor is quantized");
     if (dim >= this->ndim()) {
         throw std::out_of_range("slice: dimension out of range");
     }
@@ -273,6 +329,7 @@ tensor_t Tensor::slice(size_t dim, size_t start, size_t end) const {
 }
 
 void Tensor::load(const void *src) {
+    CHECK_ARGUMENT(this->layout() == TensorLayout::STRIDED, "load: tensor has a packed layout");
     // 1. 设置当前的设备环境，防止把数据拷错地方
     core::context().setDevice(this->deviceType(), this->deviceId());
 
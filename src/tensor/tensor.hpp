@@ -6,10 +6,40 @@ namespace llaisys {
 class Tensor;
 using tensor_t = std::shared_ptr<Tensor>;   // 一个指向 Tensor 的智能指针
 
+// How elements are laid out in storage. Anything other than STRIDED is a
+// kernel-native layout produced once (e.g. at model load) and consumed by the
+// matching op; shape stays logical and strides do not describe the data.
+enum class TensorLayout {
+    STRIDED,       // addressed through shape/strides
+    LINEAR_PACKED, // [N, K] linear weight in GEMM B panels, see ops::linear_pack_weight
+    NIBBLE_PACKED, // [N, K] 4-bit codes, two per byte, see ops::linear_quantize_q4
+};
+
+// Quantized storage (weights, KV cache). The tensor's own storage holds the codes
+// (dtype is the code type) and the dequantization parameters ride along here.
+enum class QuantScheme {
+    NONE,
+    INT8_CHANNEL, // I8 codes, w[n, k] = scales[n] * q[n, k], scales is F32 [N]
+    Q4_GROUP,     // NIBBLE_PACKED U8 codes, w[n, k] = scales[n, g] * (q[n, k] - zeros[n, g]),
+                  // g = k / group_size, scales is F16 [N, K / group_size], zeros U8 of the
+                  // same shape or null for a fixed zero of 8
+    ROW_SCALE,    // I8 or F8 (E4M3) codes of K/V cache rows, x[..., i] = scales[...] * q[..., i],
+                  // scales is F32 shaped like the codes without their last dimension
+};
+
+struct TensorQuant {
+    QuantScheme scheme = QuantScheme::NONE;
+    tensor_t scales;
+    tensor_t zeros;
+    size_t group_size = 0;
+};
+
 struct TensorMeta {
     llaisysDataType_t dtype;    // 数据类型，比如 float32
     std::vector<size_t> shape;  // 形状，比如 [2, 3, 4] 表示 2×3×4 的张量
     std::vector<ptrdiff_t> strides;  // 步长，比如 [12, 4, 1] 表示在内存中每个元素的偏移量
+    TensorLayout layout = TensorLayout::STRIDED;
+    TensorQuant quant;
 };
 
 class Tensor {
@@ -37,6 +67,9 @@ public:
     int deviceId() const;
     size_t numel() const;
     size_t elementSize() const;
+    TensorLayout layout() const;
+    const TensorQuant &quant() const;
+    bool isQuantized() const;
 
     std::string info() const;
     void debug() const;
@@ -47,6 +80,10 @@ public:
     tensor_t permute(const std::vector<size_t> &order) const;
     tensor_t slice(size_t dim, size_t start, size_t end) const;
     tensor_t view(const std::vector<size_t> &shape) const;
+    // Reinterpret this contiguous buffer as a tensor of logical `shape` stored in `layout`.
+    tensor_t withLayout(TensorLayout layout, const std::vector<size_t> &shape) const;
+    // The same codes tagged with quantization parameters.
+    tensor_t withQuant(TensorQuant quant) const;
 
     // Load data from host memory
     void load(const void *src);
@@ -1,3 +1,4 @@
 #pragma once
 #include "utils/check.hpp"
 #include "utils/types.hpp"
+#include "utils/convert.hpp"
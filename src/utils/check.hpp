@@ -1,6 +1,16 @@
+#pragma once
 #include <iostream>
 #include <stdexcept>
 
+namespace llaisys::utils {
+// Whether every one of `rest` equals `first`, compared in place (a braced
+// list would copy them, e.g. every shape vector of a CHECK_SAME_SHAPE).
+template <typename T, typename... Ts>
+bool all_equal(const T &first, const Ts &...rest) {
+    return ((first == rest) && ...);
+}
+} // namespace llaisys::utils
+
 #define EXCEPTION_LOCATION_MSG \
     " from " << __func__ << " at " << __FILE__ << ":" << __LINE__ << "."
 
@@ -43,13 +53,11 @@
         throw std::runtime_error("Unimplemented function");                                   \
     } while (0)
 
-#define CHECK_SAME(ERR, FIRST, ...)                \
-    do {                                           \
-        for (const auto &arg___ : {__VA_ARGS__}) { \
-            if (FIRST != arg___) {                 \
-                { ERR; }                           \
-            }                                      \
-        }                                          \
+#define CHECK_SAME(ERR, FIRST, ...)                             \
+    do {                                                        \
+        if (!::llaisys::utils::all_equal(FIRST, __VA_ARGS__)) { \
+            { ERR; }                                            \
+        }                                                       \
     } while (0)
 
 #define EXCEPTION_SHAPE_MISMATCH                                                       \
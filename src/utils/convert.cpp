@@ -0,0 +1,46 @@
+#include "convert.hpp"
+
+#include "simd.hpp"
+
+namespace llaisys::utils {
+namespace {
+template <typename TD, typename TS>
+void convert_(TD *dst, const TS *src, size_t n) {
+    size_t i = 0;
+    if constexpr (simd::VL > 1) {
+        for (; i + 4 * simd::VL <= n; i += 4 * simd::VL) {
+            simd::vec_t v0 = simd::load(src + i);
+            simd::vec_t v1 = simd::load(src + i + simd::VL);
+            simd::vec_t v2 = simd::load(src + i + 2 * simd::VL);
+            simd::vec_t v3 = simd::load(src + i + 3 * simd::VL);
+            simd::store(dst + i, v0);
+            simd::store(dst + i + simd::VL, v1);
+            simd::store(dst + i + 2 * simd::VL, v2);
+            simd::store(dst + i + 3 * simd::VL, v3);
+        }
+        for (; i + simd::VL <= n; i += simd::VL) {
+            simd::store(dst + i, simd::load(src + i));
+        }
+    }
+    for (; i < n; ++i) {
+        dst[i] = cast<TD>(src[i]);
+    }
+}
+} // namespace
+
+void convert_n(float *dst, const bf16_t *src, size_t n) {
+    convert_(dst, src, n);
+}
+
+void convert_n(float *dst, const fp16_t *src, size_t n) {
+    convert_(dst, src, n);
+}
+
+void convert_n(bf16_t *dst, const float *src, size_t n) {
+    convert_(dst, src, n);
+}
+
+void convert_n(fp16_t *dst, const float *src, size_t n) {
+    convert_(dst, src, n);
+}
+} // namespace llaisys::utils
@@ -0,0 +1,26 @@
+#pragma once
+#include "types.hpp"
+
+#include <algorithm>
+#include <cstddef>
+
+// Bulk conversion between float and the 16-bit float types.
+//
+// Kernels widen whole rows/tiles of bf16/fp16 into float buffers once,
+// compute in float, and narrow the results back in one call instead of going
+// through utils::cast per element. The vector path (AVX-512 or AVX2 + F16C)
+// is chosen when this library is built; results match utils::cast bit for
+// bit (round to nearest even).
+namespace llaisys::utils {
+void convert_n(float *dst, const bf16_t *src, size_t n);
+void convert_n(float *dst, const fp16_t *src, size_t n);
+void convert_n(bf16_t *dst, const float *src, size_t n);
+void convert_n(fp16_t *dst, const float *src, size_t n);
+
+// Lets kernels templated on the element type call convert_n unconditionally.
+inline void convert_n(float *dst, const float *src, size_t n) {
+    if (dst != src) {
+        std::copy_n(src, n, dst);
+    }
+}
+} // namespace llaisys::utils
@@ -0,0 +1,216 @@
+#pragma once
+#include "../utils.hpp"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+// llaisys.h defines `__C`, which the intrinsic headers use as a parameter name.
+#pragma push_macro("__C")
+#undef __C
+#include <immintrin.h>
+#pragma pop_macro("__C")
+#endif
+
+// Thin wrappers over the widest float vector the build targets. Kernels are
+// written once against `vec_t` and `VL`; the scalar fallback (VL == 1) keeps
+// every kernel buildable on compilers/targets without AVX2.
+namespace llaisys::utils::simd {
+#if defined(__AVX512F__)
+using vec_t = __m512;
+constexpr size_t VL = 16;
+// Full-mask maskz forms are used for widening: the unmasked intrinsics start
+// from _mm512_undefined_*() and trip -Wmaybe-uninitialized on GCC 12.
+constexpr __mmask16 ALL = 0xFFFF;
+
+inline vec_t zero() { return _mm512_setzero_ps(); }
+inline vec_t set1(float x) { return _mm512_set1_ps(x); }
+inline vec_t load(const float *p) { return _mm512_loadu_ps(p); }
+inline vec_t load(const bf16_t *p) {
+    __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    return _mm512_castsi512_ps(_mm512_maskz_slli_epi32(ALL, _mm512_maskz_cvtepu16_epi32(ALL, h), 16));
+}
+inline vec_t load(const fp16_t *p) {
+    return _mm512_maskz_cvtph_ps(ALL, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+}
+inline vec_t load(const int8_t *p) {
+    return _mm512_maskz_cvtepi32_ps(ALL, _mm512_maskz_cvtepi8_epi32(ALL, _mm_loadu_si128(reinterpret_cast<const __m128i *>(p))));
+}
+// E4M3 as in utils::_f8_to_f32: sign and exponent/mantissa moved under a
+// float's, then rebiased by one multiply.
+inline vec_t load(const fp8_t *p) {
+    const __m512i x = _mm512_maskz_cvtepu8_epi32(ALL, _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+    const __m512i bits = _mm512_or_si512(_mm512_maskz_slli_epi32(ALL, _mm512_and_si512(x, _mm512_set1_epi32(0x80)), 24),
+                                         _mm512_maskz_slli_epi32(ALL, _mm512_and_si512(x, _mm512_set1_epi32(0x7F)), 20));
+    return _mm512_mul_ps(_mm512_castsi512_ps(bits), _mm512_set1_ps(0x1p120f));
+}
+// 32 4-bit codes from 16 bytes: byte j holds code j in its low nibble and
+// code j + 16 in its high nibble. out[] receives codes 0..31 in order.
+inline void load_q4x32(const uint8_t *p, vec_t out[32 / VL]) {
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    const __m128i m = _mm_set1_epi8(0x0F);
+    const __m128i lo = _mm_and_si128(b, m);
+    const __m128i hi = _mm_and_si128(_mm_srli_epi16(b, 4), m);
+    out[0] = _mm512_maskz_cvtepi32_ps(ALL, _mm512_maskz_cvtepu8_epi32(ALL, lo));
+    out[1] = _mm512_maskz_cvtepi32_ps(ALL, _mm512_maskz_cvtepu8_epi32(ALL, hi));
+}
+inline void store(float *p, vec_t v) { _mm512_storeu_ps(p, v); }
+// Narrowing stores round to nearest even, bit for bit like utils::cast.
+// (AVX512-BF16's vcvtneps2bf16 is not used here: it flushes subnormal inputs
+// to zero and is no faster for a store-bound conversion.)
+inline void store(bf16_t *p, vec_t v) {
+    __m512i b = _mm512_castps_si512(v);
+    __m512i lsb = _mm512_and_si512(_mm512_maskz_srli_epi32(ALL, b, 16), _mm512_set1_epi32(1));
+    b = _mm512_maskz_srli_epi32(ALL, _mm512_add_epi32(b, _mm512_add_epi32(lsb, _mm512_set1_epi32(0x7FFF))), 16);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), _mm512_maskz_cvtepi32_epi16(ALL, b));
+}
+inline void store(fp16_t *p, vec_t v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), _mm512_maskz_cvtps_ph(ALL, v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+}
+inline vec_t add(vec_t a, vec_t b) { return _mm512_add_ps(a, b); }
+inline vec_t mul(vec_t a, vec_t b) { return _mm512_mul_ps(a, b); }
+inline vec_t fmadd(vec_t a, vec_t b, vec_t c) { return _mm512_fmadd_ps(a, b, c); }
+inline vec_t max(vec_t a, vec_t b) { return _mm512_maskz_max_ps(ALL, a, b); }
+// exp(x) by 2^n * p(r) with |r| <= ln2 / 2 and a degree-6 polynomial
+// (about 2 ulp). Very negative inputs, including -inf, return 0.
+inline vec_t exp(vec_t x) {
+    x = _mm512_maskz_min_ps(ALL, _mm512_maskz_max_ps(ALL, x, _mm512_set1_ps(-1000.0f)), _mm512_set1_ps(88.72f));
+    const vec_t n = _mm512_maskz_roundscale_ps(ALL, _mm512_mul_ps(x, _mm512_set1_ps(1.44269504f)),
+                                               _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    vec_t r = _mm512_fnmadd_ps(n, _mm512_set1_ps(0.693145752f), x);
+    r = _mm512_fnmadd_ps(n, _mm512_set1_ps(1.42860677e-6f), r);
+    vec_t p = _mm512_set1_ps(1.38888889e-3f);
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(8.33333333e-3f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(4.16666667e-2f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.66666667e-1f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(0.5f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.0f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.0f));
+    return _mm512_maskz_scalef_ps(ALL, p, n);
+}
+inline float reduce_add(vec_t v) {
+    __m256 lo = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xFF, _mm512_castps_pd(v), 0));
+    __m256 hi = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xFF, _mm512_castps_pd(v), 1));
+    __m256 h = _mm256_add_ps(lo, hi);
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(h), _mm256_extractf128_ps(h, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+inline float reduce_max(vec_t v) {
+    __m256 lo = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xFF, _mm512_castps_pd(v), 0));
+    __m256 hi = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xFF, _mm512_castps_pd(v), 1));
+    __m256 h = _mm256_max_ps(lo, hi);
+    __m128 s = _mm_max_ps(_mm256_castps256_ps128(h), _mm256_extractf128_ps(h, 1));
+    s = _mm_max_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_max_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+#elif defined(__AVX2__)
+using vec_t = __m256;
+constexpr size_t VL = 8;
+
+inline vec_t zero() { return _mm256_setzero_ps(); }
+inline vec_t set1(float x) { return _mm256_set1_ps(x); }
+inline vec_t load(const float *p) { return _mm256_loadu_ps(p); }
+inline vec_t load(const bf16_t *p) {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16));
+}
+inline vec_t load(const fp16_t *p) {
+    return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+}
+inline vec_t load(const int8_t *p) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p))));
+}
+inline vec_t load(const fp8_t *p) {
+    const __m256i x = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+    const __m256i bits = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0x80)), 24),
+                                         _mm256_slli_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0x7F)), 20));
+    return _mm256_mul_ps(_mm256_castsi256_ps(bits), _mm256_set1_ps(0x1p120f));
+}
+inline void load_q4x32(const uint8_t *p, vec_t out[32 / VL]) {
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    const __m128i m = _mm_set1_epi8(0x0F);
+    const __m128i lo = _mm_and_si128(b, m);
+    const __m128i hi = _mm_and_si128(_mm_srli_epi16(b, 4), m);
+    out[0] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(lo));
+    out[1] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)));
+    out[2] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(hi));
+    out[3] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)));
+}
+inline void store(float *p, vec_t v) { _mm256_storeu_ps(p, v); }
+inline void store(bf16_t *p, vec_t v) {
+    __m256i b = _mm256_castps_si256(v);
+    __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(b, 16), _mm256_set1_epi32(1));
+    b = _mm256_srli_epi32(_mm256_add_epi32(b, _mm256_add_epi32(lsb, _mm256_set1_epi32(0x7FFF))), 16);
+    // packus works per 128-bit lane; gather the two low halves
+    b = _mm256_permute4x64_epi64(_mm256_packus_epi32(b, b), 0x08);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm256_castsi256_si128(b));
+}
+inline void store(fp16_t *p, vec_t v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+}
+inline vec_t add(vec_t a, vec_t b) { return _mm256_add_ps(a, b); }
+inline vec_t mul(vec_t a, vec_t b) { return _mm256_mul_ps(a, b); }
+inline vec_t fmadd(vec_t a, vec_t b, vec_t c) { return _mm256_fmadd_ps(a, b, c); }
+inline vec_t max(vec_t a, vec_t b) { return _mm256_max_ps(a, b); }
+// Same reduction as the AVX-512 version; 2^n is built in the exponent field,
+// so inputs are clamped to the normal range (exp(-87.3) ~ 1e-38, not 0).
+inline vec_t exp(vec_t x) {
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-87.3f)), _mm256_set1_ps(88.72f));
+    const vec_t n = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504f)),
+                                    _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    vec_t r = _mm256_fnmadd_ps(n, _mm256_set1_ps(0.693145752f), x);
+    r = _mm256_fnmadd_ps(n, _mm256_set1_ps(1.42860677e-6f), r);
+    vec_t p = _mm256_set1_ps(1.38888889e-3f);
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(8.33333333e-3f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(4.16666667e-2f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.66666667e-1f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(0.5f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.0f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.0f));
+    const __m256i e = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(p, _mm256_castsi256_ps(e));
+}
+inline float reduce_add(vec_t v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+inline float reduce_max(vec_t v) {
+    __m128 s = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_max_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_max_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+#else
+using vec_t = float;
+constexpr size_t VL = 1;
+
+inline vec_t zero() { return 0.0f; }
+inline vec_t set1(float x) { return x; }
+inline vec_t load(const float *p) { return *p; }
+inline vec_t load(const bf16_t *p) { return _bf16_to_f32(*p); }
+inline vec_t load(const fp16_t *p) { return _f16_to_f32(*p); }
+inline vec_t load(const int8_t *p) { return static_cast<float>(*p); }
+inline vec_t load(const fp8_t *p) { return _f8_to_f32(*p); }
+inline void load_q4x32(const uint8_t *p, vec_t out[32 / VL]) {
+    for (size_t j = 0; j < 16; ++j) {
+        out[j] = static_cast<float>(p[j] & 0x0F);
+        out[j + 16] = static_cast<float>(p[j] >> 4);
+    }
+}
+inline void store(float *p, vec_t v) { *p = v; }
+inline void store(bf16_t *p, vec_t v) { *p = _f32_to_bf16(v); }
+inline void store(fp16_t *p, vec_t v) { *p = _f32_to_f16(v); }
+inline vec_t add(vec_t a, vec_t b) { return a + b; }
+inline vec_t mul(vec_t a, vec_t b) { return a * b; }
+inline vec_t fmadd(vec_t a, vec_t b, vec_t c) { return a * b + c; }
+inline vec_t max(vec_t a, vec_t b) { return a > b ? a : b; }
+inline vec_t exp(vec_t x) { return std::exp(x); }
+inline float reduce_add(vec_t v) { return v; }
+inline float reduce_max(vec_t v) { return v; }
+#endif
+} // namespace llaisys::utils::simd
@@ -1,8 +1,27 @@
 #include "types.hpp"
 
+#include <cmath>
 #include <cstring>
 
+#if defined(__F16C__)
+// llaisys.h defines `__C`, which the intrinsic headers use as a parameter name.
+#pragma push_macro("__C")
+#undef __C
+#include <immintrin.h>
+#pragma pop_macro("__C")
+#endif
+
 namespace llaisys::utils {
+#if defined(__F16C__)
+// F16C converts in hardware, subnormals included.
+float _f16_to_f32(fp16_t val) {
+    return _cvtsh_ss(val._v);
+}
+
+fp16_t _f32_to_f16(float val) {
+    return fp16_t{static_cast<uint16_t>(_cvtss_sh(val, _MM_FROUND_TO_NEAREST_INT))};
+}
+#else
 float _f16_to_f32(fp16_t val) {
     uint16_t h = val._v;
     uint32_t sign = (h & 0x8000) << 16;
@@ -37,31 +56,32 @@ float _f16_to_f32(fp16_t val) {
     return result;
 }
 
+// Round to nearest even, like the hardware conversion: the magnitude is
+// scaled so the float adder performs the rounding at the half-precision
+// mantissa position, for normals and subnormals alike.
 fp16_t _f32_to_f16(float val) {
-    uint32_t f32;
-    memcpy(&f32, &val, sizeof(f32));               // Read the bits of the float32
-    uint16_t sign = (f32 >> 16) & 0x8000;          // Extract the sign bit
-    int32_t exponent = ((f32 >> 23) & 0xFF) - 127; // Extract and de-bias the exponent
-    uint32_t mantissa = f32 & 0x7FFFFF;            // Extract the mantissa (fraction part)
-
-    if (exponent >= 16) { // Special cases for Inf and NaN
-        // NaN
-        if (exponent == 128 && mantissa != 0) {
-            return fp16_t{static_cast<uint16_t>(sign | 0x7E00)};
-        }
-        // Infinity
-        return fp16_t{static_cast<uint16_t>(sign | 0x7C00)};
-    } else if (exponent >= -14) { // Normalized case
-        return fp16_t{(uint16_t)(sign | ((exponent + 15) << 10) | (mantissa >> 13))};
-    } else if (exponent >= -24) {
-        mantissa |= 0x800000; // Add implicit leading 1
-        mantissa >>= (-14 - exponent);
-        return fp16_t{(uint16_t)(sign | (mantissa >> 13))};
-    } else {
-        // Too small for subnormal: return signed zero
-        return fp16_t{(uint16_t)sign};
+    uint32_t w;
+    memcpy(&w, &val, sizeof(w));
+    const uint32_t shl1_w = w + w;
+    const uint32_t sign = w & 0x80000000u;
+
+    float base = (std::fabs(val) * 0x1.0p+112f) * 0x1.0p-110f;
+    uint32_t bias = shl1_w & 0xFF000000u;
+    if (bias < 0x71000000u) {
+        bias = 0x71000000u;
     }
+    uint32_t bias_bits = (bias >> 1) + 0x07800000u;
+    float bias_f;
+    memcpy(&bias_f, &bias_bits, sizeof(bias_f));
+    base = bias_f + base;
+
+    uint32_t bits;
+    memcpy(&bits, &base, sizeof(bits));
+    const uint32_t nonsign = ((bits >> 13) & 0x00007C00u) + (bits & 0x00000FFFu);
+    // NaN stays a (quiet) NaN
+    return fp16_t{static_cast<uint16_t>((sign >> 16) | (shl1_w > 0xFF000000u ? 0x7E00u : nonsign))};
 }
+#endif
 
 float _bf16_to_f32(bf16_t val) {
     uint32_t bits32 = static_cast<uint32_t>(val._v) << 16;
@@ -82,4 +102,36 @@ bf16_t _f32_to_bf16(float val) {
 
     return bf16_t{bf16_bits};
 }
+
+// The code's exponent and mantissa are placed under a float's and the result
+// rebiased by 2^(127 - 7); subnormal codes become float denormals that the
+// same product scales to their exact value. (The NaN codes, never produced by
+// _f32_to_f8, read as +-480.)
+float _f8_to_f32(fp8_t val) {
+    const uint32_t bits = (static_cast<uint32_t>(val._v & 0x80) << 24) | (static_cast<uint32_t>(val._v & 0x7F) << 20);
+    float out;
+    std::memcpy(&out, &bits, sizeof(out));
+    return out * 0x1p120f;
+}
+
+fp8_t _f32_to_f8(float val) {
+    const uint8_t sign = std::signbit(val) ? 0x80 : 0x00;
+    const float a = std::fabs(val);
+    if (std::isnan(a)) {
+        return fp8_t{0};
+    }
+    if (a >= 448.0f) {
+        return fp8_t{static_cast<uint8_t>(sign | 0x7E)};
+    }
+    if (a < 0x1p-6f) {
+        // subnormals are multiples of 2^-9; 8 * 2^-9 is the smallest normal
+        return fp8_t{static_cast<uint8_t>(sign | static_cast<uint8_t>(std::nearbyint(a * 0x1p9f)))};
+    }
+    uint32_t bits;
+    std::memcpy(&bits, &a, sizeof(bits));
+    // round to nearest even at the third mantissa bit; a carry bumps the exponent
+    bits += 0x7FFFF + ((bits >> 20) & 1);
+    const uint32_t exponent = (bits >> 23) - (127 - 7);
+    return fp8_t{static_cast<uint8_t>(sign | (exponent << 3) | ((bits >> 20) & 0x7))};
+}
 } // namespace llaisys::utils
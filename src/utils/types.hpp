@@ -1,3 +1,4 @@
+#pragma once
 #include "llaisys.h"
 
 #include <iostream>
@@ -14,6 +15,13 @@ struct CustomBFloat16 {
 };
 typedef struct CustomBFloat16 bf16_t;
 
+// OCP FP8 E4M3 ("e4m3fn"): 1 sign, 4 exponent (bias 7) and 3 mantissa bits,
+// no infinities, largest finite value 448.
+struct CustomFloat8 {
+    uint8_t _v;
+};
+typedef struct CustomFloat8 fp8_t;
+
 namespace utils {
 inline size_t dsize(llaisysDataType_t dtype) {
     switch (dtype) {
@@ -113,6 +121,10 @@ fp16_t _f32_to_f16(float val);
 float _bf16_to_f32(bf16_t val);
 bf16_t _f32_to_bf16(float val);
 
+float _f8_to_f32(fp8_t val);
+// Round to nearest even, saturating to +-448 (NaN maps to 0).
+fp8_t _f32_to_f8(float val);
+
 template <typename TypeTo, typename TypeFrom>
 TypeTo cast(TypeFrom val) {
     if constexpr (std::is_same<TypeTo, TypeFrom>::value) {
@@ -133,6 +145,10 @@ TypeTo cast(TypeFrom val) {
         return _bf16_to_f32(val);
     } else if constexpr (std::is_same<TypeFrom, bf16_t>::value && !std::is_same<TypeTo, float>::value) {
         return static_cast<TypeTo>(_bf16_to_f32(val));
+    } else if constexpr (std::is_same<TypeTo, fp8_t>::value) {
+        return _f32_to_f8(static_cast<float>(val));
+    } else if constexpr (std::is_same<TypeFrom, fp8_t>::value) {
+        return static_cast<TypeTo>(_f8_to_f32(val));
     } else {
         return static_cast<TypeTo>(val);
     }
@@ -3,9 +3,12 @@ import os
 
 parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
 sys.path.insert(0, parent_dir)
+# several threads even on small machines, so the parallel paths (and the
+# scratch their workers share) are exercised; read when the pool starts
+os.environ.setdefault("LLAISYS_NUM_THREADS", str(max(4, os.cpu_count() or 1)))
 import llaisys
 import torch
-from test_utils import random_tensor, check_equal, benchmark
+from test_utils import random_tensor, zero_tensor, check_equal, benchmark
 
 
 def torch_linear(out, x, w, bias):
@@ -22,10 +25,18 @@ def test_op_linear(
     rtol=1e-5,
     device_name="cpu",
     profile=False,
+    peak_gflops=None,
+    mem_bw=None,
+    packed=False,
 ):
-    print(f"   out {out_shape}, x {x_shape}, w {w_shape}, bias {use_bias}, dtype <{dtype_name}>")
+    print(
+        f"   out {out_shape}, x {x_shape}, w {w_shape}, bias {use_bias}, dtype <{dtype_name}>"
+        + (", packed weight" if packed else "")
+    )
     x, x_ = random_tensor(x_shape, dtype_name, device_name, scale=0.1)
     w, w_ = random_tensor(w_shape, dtype_name, device_name, scale=0.01)
+    if packed:
+        w_ = llaisys.Ops.linear_pack_weight(w_)
 
     bias, bias_ = None, None
     if use_bias:
@@ -38,11 +49,290 @@ def test_op_linear(
     assert check_equal(out_, out, atol=atol, rtol=rtol)
 
     if profile:
-        benchmark(
+        torch_time, llaisys_time = benchmark(
             lambda: torch_linear(out, x, w, bias),
             lambda: llaisys.Ops.linear(out_, x_, w_, bias_),
             device_name,
         )
+        report_throughput(
+            x_shape[0], w_shape[0], w_shape[1], x.element_size(),
+            torch_time, llaisys_time, peak_gflops, mem_bw,
+        )
+
+
+def test_op_linear_fused_qkv(
+    seqlen,
+    hs,
+    nh,
+    nkvh,
+    dh,
+    dtype_name="f32",
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+):
+    """Q/K/V weights fused into one linear; heads come back as views of its output."""
+    print(f"   seq {seqlen}, hs {hs}, nh {nh}, nkvh {nkvh}, dh {dh}, fused qkv, dtype <{dtype_name}>")
+    x, x_ = random_tensor((seqlen, hs), dtype_name, device_name, scale=0.1)
+    parts = []
+    for nheads in (nh, nkvh, nkvh):
+        w, w_ = random_tensor((nheads * dh, hs), dtype_name, device_name, scale=0.01)
+        b, b_ = random_tensor((nheads * dh,), dtype_name, device_name)
+        parts.append((w, w_, b, b_))
+    w_qkv_ = llaisys.Ops.linear_concat([p[1] for p in parts])
+    b_qkv_ = llaisys.Ops.linear_concat([p[3] for p in parts])
+
+    qkv, qkv_ = random_tensor((seqlen, (nh + 2 * nkvh) * dh), dtype_name, device_name)
+    llaisys.Ops.linear(qkv_, x_, w_qkv_, b_qkv_)
+    heads_ = qkv_.view(seqlen, nh + 2 * nkvh, dh)
+    bounds = (0, nh, nh + nkvh, nh + 2 * nkvh)
+    for i, (w, _, b, _) in enumerate(parts):
+        expected = torch.nn.functional.linear(x, w, b).view(seqlen, -1, dh)
+        assert check_equal(heads_.slice(1, bounds[i], bounds[i + 1]), expected, atol=atol, rtol=rtol)
+
+
+def test_op_linear_epilogue(
+    out_shape,
+    x_shape,
+    w_shape,
+    activation,
+    residual_mode,
+    dtype_name="f32",
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+):
+    """Bias, activation and residual applied while storing the linear output.
+
+    residual_mode: None, "separate" (residual is its own tensor) or "inplace"
+    (out already holds the residual stream and is accumulated into).
+    """
+    print(
+        f"   out {out_shape}, x {x_shape}, w {w_shape}, activation {activation.name}, "
+        f"residual {residual_mode}, dtype <{dtype_name}>"
+    )
+    x, x_ = random_tensor(x_shape, dtype_name, device_name, scale=0.1)
+    w, w_ = random_tensor(w_shape, dtype_name, device_name, scale=0.1)
+    bias, bias_ = random_tensor((w_shape[0],), dtype_name, device_name)
+    res, res_ = random_tensor(out_shape, dtype_name, device_name)
+
+    # the epilogue sees float accumulators, so the reference never rounds in between
+    y = torch.nn.functional.linear(x.float(), w.float(), bias.float())
+    if activation == llaisys.Activation.RELU:
+        y = torch.relu(y)
+    elif activation == llaisys.Activation.SILU:
+        y = torch.nn.functional.silu(y)
+    elif activation == llaisys.Activation.GELU:
+        y = torch.nn.functional.gelu(y, approximate="tanh")
+    if residual_mode is not None:
+        y = y + res.float()
+    expected = y.to(x.dtype)
+
+    if residual_mode == "inplace":
+        out_ = res_
+    else:
+        out_ = random_tensor(out_shape, dtype_name, device_name)[1]
+    llaisys.Ops.linear(
+        out_, x_, w_, bias_,
+        residual=res_ if residual_mode is not None else None,
+        activation=activation,
+    )
+    assert check_equal(out_, expected, atol=atol, rtol=rtol)
+
+
+def test_op_linear_swiglu(
+    seqlen,
+    hs,
+    di,
+    dtype_name="f32",
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+    profile=False,
+    packed=False,
+):
+    """Gate and up projections stacked into one weight, SwiGLU applied in the epilogue."""
+    print(
+        f"   seq {seqlen}, hs {hs}, intermediate {di}, fused gate/up + swiglu, dtype <{dtype_name}>"
+        + (", packed weight" if packed else "")
+    )
+    x, x_ = random_tensor((seqlen, hs), dtype_name, device_name, scale=0.1)
+    w_gate, w_gate_ = random_tensor((di, hs), dtype_name, device_name, scale=0.1)
+    w_up, w_up_ = random_tensor((di, hs), dtype_name, device_name, scale=0.1)
+    w_gate_up_ = llaisys.Ops.linear_stack_gate_up(w_gate_, w_up_)
+    if packed:
+        w_gate_up_ = llaisys.Ops.linear_pack_weight(w_gate_up_)
+
+    def torch_mlp(out):
+        # rounded to the working dtype in between, as the unfused ops would
+        gate = torch.nn.functional.linear(x, w_gate).float()
+        up = torch.nn.functional.linear(x, w_up).float()
+        out.copy_(torch.nn.functional.silu(gate) * up)
+
+    out, out_ = random_tensor((seqlen, di), dtype_name, device_name)
+    torch_mlp(out)
+    llaisys.Ops.linear_swiglu(out_, x_, w_gate_up_)
+
+    assert check_equal(out_, out, atol=atol, rtol=rtol)
+
+    if profile:
+        benchmark(
+            lambda: torch_mlp(out),
+            lambda: llaisys.Ops.linear_swiglu(out_, x_, w_gate_up_),
+            device_name,
+        )
+
+
+def to_torch(llaisys_tensor, like):
+    result = torch.empty_like(like)
+    api = llaisys.RuntimeAPI(llaisys_tensor.device_type())
+    api.memcpy_sync(
+        result.data_ptr(),
+        llaisys_tensor.data_ptr(),
+        result.numel() * result.element_size(),
+        llaisys.MemcpyKind.D2D,
+    )
+    return result
+
+
+def test_op_linear_quantized(
+    out_shape,
+    x_shape,
+    w_shape,
+    use_bias=True,
+    quant="int8",
+    max_extra_err=1e-2,
+    device_name="cpu",
+    profile=False,
+):
+    """Quantized-weight linear against the BF16 path, both scored against an f32 reference."""
+    print(f"   out {out_shape}, x {x_shape}, w {w_shape}, bias {use_bias}, {quant} weight vs bf16")
+    x, x_ = random_tensor(x_shape, "bf16", device_name, scale=0.1)
+    w, w_ = random_tensor(w_shape, "bf16", device_name, scale=0.01, bias=-0.005)
+    if quant == "int8":
+        wq_ = llaisys.Ops.linear_quantize_int8(w_)
+    else:
+        # e.g. "q4_g128" or "q4_g32_zp"
+        parts = quant.split("_")
+        mode = llaisys.Q4Mode.ZERO_POINT if "zp" in parts else llaisys.Q4Mode.SYMMETRIC
+        wq_ = llaisys.Ops.linear_quantize_q4(w_, int(parts[1][1:]), mode)
+
+    bias, bias_ = None, None
+    if use_bias:
+        bias, bias_ = random_tensor((w_shape[0],), "bf16", device_name)
+
+    ref = torch.nn.functional.linear(x.float(), w.float(), bias.float() if use_bias else None)
+    out, out_ = random_tensor(out_shape, "bf16", device_name)
+    llaisys.Ops.linear(out_, x_, w_, bias_)
+    bf16_err = ((to_torch(out_, out).float() - ref).norm() / ref.norm()).item()
+    llaisys.Ops.linear(out_, x_, wq_, bias_)
+    quant_err = ((to_torch(out_, out).float() - ref).norm() / ref.norm()).item()
+    print(f"        relative error: bf16 {bf16_err:.2e}, {quant} {quant_err:.2e}")
+    assert quant_err < bf16_err + max_extra_err
+
+    if profile:
+        benchmark(
+            lambda: torch_linear(out, x, w, bias),
+            lambda: llaisys.Ops.linear(out_, x_, wq_, bias_),
+            device_name,
+        )
+
+
+def test_op_linear_topk(
+    m,
+    hs,
+    voc,
+    top_k,
+    weight_format="plain",
+    dtype_name="f32",
+    device_name="cpu",
+    profile=False,
+):
+    """Fused top-k of the product against a stable sort of the full linear output over the same weight."""
+    print(f"   x ({m}, {hs}), w ({voc}, {hs}), top_k {top_k}, {weight_format} weight, dtype <{dtype_name}>")
+    x, x_ = random_tensor((m, hs), dtype_name, device_name, scale=0.1)
+    w, w_ = random_tensor((voc, hs), dtype_name, device_name, scale=0.01)
+    if weight_format == "packed":
+        w_ = llaisys.Ops.linear_pack_weight(w_)
+    elif weight_format == "int8":
+        w_ = llaisys.Ops.linear_quantize_int8(w_)
+    elif weight_format == "q4":
+        w_ = llaisys.Ops.linear_quantize_q4(w_, 32)
+
+    out, out_ = random_tensor((m, voc), dtype_name, device_name)
+    llaisys.Ops.linear(out_, x_, w_)
+    # equal values rank by lowest column, as in the kernel
+    vals, order = torch.sort(to_torch(out_, out).float(), dim=-1, descending=True, stable=True)
+
+    idx, idx_ = zero_tensor((m, top_k), "i64", device_name)
+    val, val_ = zero_tensor((m, top_k), "f32", device_name)
+    llaisys.Ops.linear_topk(idx_, val_, x_, w_, top_k)
+    assert torch.equal(to_torch(idx_, idx), order[:, :top_k])
+    assert torch.equal(to_torch(val_, val), vals[:, :top_k])
+
+    if profile:
+        benchmark(
+            lambda: torch.topk(torch.nn.functional.linear(x, w), top_k, dim=-1),
+            lambda: llaisys.Ops.linear_topk(idx_, val_, x_, w_, top_k),
+            device_name,
+        )
+
+
+def test_op_linear_mixed_precision(
+    out_shape,
+    x_shape,
+    w_shape,
+    act_dtype="f32",
+    precision=llaisys.Precision.F32,
+    atol=1e-4,
+    rtol=1e-4,
+    device_name="cpu",
+    profile=False,
+):
+    """BF16 weights under F32 or BF16 activations with a given precision policy.
+
+    With Precision.BF16_DOT the activations are rounded to BF16 before the
+    products (on CPUs with native BF16 dot products; elsewhere the policy
+    computes like F32), so the reference rounds them too and the tolerance
+    must cover both.
+    """
+    print(f"   out {out_shape}, x {x_shape}, w {w_shape}, activations <{act_dtype}>, bf16 weight, {precision.name}")
+    x, x_ = random_tensor(x_shape, act_dtype, device_name, scale=0.1)
+    w, w_ = random_tensor(w_shape, "bf16", device_name, scale=0.01)
+    bias, bias_ = random_tensor((w_shape[0],), act_dtype, device_name)
+
+    x_ref = x.to(torch.bfloat16) if precision == llaisys.Precision.BF16_DOT else x
+    expected = torch.nn.functional.linear(x_ref.float(), w.float(), bias.float()).to(x.dtype)
+    out, out_ = random_tensor(out_shape, act_dtype, device_name)
+    llaisys.set_precision(precision)
+    try:
+        llaisys.Ops.linear(out_, x_, w_, bias_)
+        assert check_equal(out_, expected, atol=atol, rtol=rtol)
+        if profile:
+            w_f = w.to(x.dtype)
+            benchmark(
+                lambda: torch_linear(out, x, w_f, bias),
+                lambda: llaisys.Ops.linear(out_, x_, w_, bias_),
+                device_name,
+            )
+    finally:
+        llaisys.set_precision(llaisys.Precision.F32)
+
+
+def report_throughput(m, n, k, elem_size, torch_time, llaisys_time, peak_gflops=None, mem_bw=None):
+    flops = 2.0 * m * n * k
+    # minimum traffic: every operand read once, output written once
+    nbytes = (n * k + m * k + m * n + n) * elem_size
+    torch_gflops = flops / torch_time / 1e9
+    llaisys_gflops = flops / llaisys_time / 1e9
+    llaisys_gbps = nbytes / llaisys_time / 1e9
+    line = f"        Torch: {torch_gflops:.2f} GFLOP/s \n        LLAISYS: {llaisys_gflops:.2f} GFLOP/s"
+    if peak_gflops:
+        line += f" ({100.0 * llaisys_gflops / peak_gflops:.1f}% of peak)"
+    line += f", {llaisys_gbps:.2f} GB/s"
+    if mem_bw:
+        line += f" ({100.0 * llaisys_gbps / mem_bw:.1f}% of memory bandwidth)"
+    print(line)
 
 
 if __name__ == "__main__":
@@ -51,9 +341,25 @@ if __name__ == "__main__":
     parser = argparse.ArgumentParser()
     parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
     parser.add_argument("--profile", action="store_true")
+    parser.add_argument(
+        "--peak-gflops",
+        default=None,
+        type=float,
+        help="single-precision peak of the machine, used to report efficiency when profiling",
+    )
+    parser.add_argument(
+        "--mem-bw",
+        default=None,
+        type=float,
+        help="memory bandwidth of the machine in GB/s, used to report the roofline fraction of decode shapes",
+    )
     args = parser.parse_args()
     testShapes = [
         ((2, 3), (2, 4), (3, 4), True),
+        # decode (GEMV) and a small prefill with ragged panels; K % 128 == 0
+        # so every weight format, Q4 included, runs both
+        ((1, 384), (1, 256), (384, 256), True),
+        ((33, 200), (33, 256), (200, 256), False),
         ((512, 4096), (512, 4096), (4096, 4096), True),
     ]
     testDtypePrec = [
@@ -62,9 +368,92 @@ if __name__ == "__main__":
         ("f16", 1e-3, 1e-3),
         ("bf16", 1e-2, 1e-2),
     ]
+    if args.profile:
+        # Qwen2-1.5B projections for a 512-token prefill
+        testShapes += [
+            ((512, 1536), (512, 1536), (1536, 1536), True),  # attn_q / attn_o
+            ((512, 256), (512, 1536), (256, 1536), True),  # attn_k / attn_v
+            ((512, 8960), (512, 1536), (8960, 1536), False),  # mlp_gate / mlp_up
+            ((512, 1536), (512, 8960), (1536, 8960), False),  # mlp_down
+        ]
+        # ... and for a single-token decode step (GEMV, memory bound)
+        testShapes += [
+            ((1, 1536), (1, 1536), (1536, 1536), True),
+            ((1, 8960), (1, 1536), (8960, 1536), False),
+            ((1, 1536), (1, 8960), (1536, 8960), False),
+            ((1, 151936), (1, 1536), (151936, 1536), False),  # lm_head
+        ]
     print(f"Testing Ops.linear on {args.device}")
     for shapes in testShapes:
         for dtype_name, atol, rtol in testDtypePrec:
-            test_op_linear(*shapes, dtype_name, atol, rtol, args.device, args.profile)
+            for packed in (False, True):
+                test_op_linear(
+                    *shapes, dtype_name, atol, rtol, args.device,
+                    args.profile, args.peak_gflops, args.mem_bw, packed,
+                )
+
+    print(f"Testing Ops.linear with fused QKV weights on {args.device}")
+    for dtype_name, atol, rtol in testDtypePrec:
+        test_op_linear_fused_qkv(5, 64, 4, 2, 16, dtype_name, atol, rtol, args.device)
+
+    print(f"Testing Ops.linear with fused epilogues on {args.device}")
+    for out_shape, x_shape, w_shape in [((1, 48), (1, 64), (48, 64)), ((9, 48), (9, 64), (48, 64))]:
+        for activation in (llaisys.Activation.NONE, llaisys.Activation.SILU, llaisys.Activation.GELU):
+            for residual_mode in (None, "separate", "inplace"):
+                if activation == llaisys.Activation.NONE and residual_mode is None:
+                    continue
+                for dtype_name, atol, rtol in testDtypePrec:
+                    test_op_linear_epilogue(
+                        out_shape, x_shape, w_shape, activation, residual_mode, dtype_name, atol, rtol, args.device
+                    )
+
+    print(f"Testing Ops.linear_swiglu on {args.device}")
+    testSwiGLUShapes = [(1, 64, 40), (7, 64, 100), (5, 128, 256)]
+    if args.profile:
+        testSwiGLUShapes += [(1, 1536, 8960), (512, 1536, 8960)]  # Qwen2-1.5B MLP
+    for seqlen, hs, di in testSwiGLUShapes:
+        for dtype_name, atol, rtol in testDtypePrec:
+            for packed in (False, True):
+                test_op_linear_swiglu(seqlen, hs, di, dtype_name, atol, rtol, args.device, args.profile, packed)
+
+    print(f"Testing Ops.linear mixed precision on {args.device}")
+    testMixedPrec = [
+        # activations, policy, atol, rtol
+        ("f32", llaisys.Precision.F32, 1e-4, 1e-4),
+        ("f32", llaisys.Precision.BF16_DOT, 1e-2, 1e-2),
+        ("bf16", llaisys.Precision.F32, 1e-2, 1e-2),
+        ("bf16", llaisys.Precision.BF16_DOT, 1e-2, 1e-2),
+    ]
+    for out_shape, x_shape, w_shape, _ in testShapes + [((33, 70), (33, 129), (70, 129), True)]:
+        for act_dtype, precision, atol, rtol in testMixedPrec:
+            test_op_linear_mixed_precision(
+                out_shape, x_shape, w_shape, act_dtype, precision, atol, rtol, args.device, args.profile
+            )
+
+    # quantization, extra relative error allowed on top of bf16 rounding
+    testQuant = [
+        ("int8", 1e-2),
+        ("q4_g32", 1.5e-1),
+        ("q4_g128", 1.5e-1),
+        ("q4_g128_zp", 1.5e-1),
+    ]
+    print(f"Testing Ops.linear with quantized weights on {args.device}")
+    for out_shape, x_shape, w_shape, use_bias in testShapes:
+        for quant, max_extra_err in testQuant:
+            if quant.startswith("q4") and w_shape[1] % 128 != 0:
+                continue
+            test_op_linear_quantized(
+                out_shape, x_shape, w_shape, use_bias, quant, max_extra_err, args.device, args.profile
+            )
+
+    print(f"Testing Ops.linear_topk on {args.device}")
+    # (m, hs, voc, top_k): vocabularies spanning several tiles, with ragged ends
+    testTopK = [(1, 64, 1000, 1), (1, 64, 5000, 50), (3, 64, 2100, 1), (7, 128, 3000, 8)]
+    if args.profile:
+        testTopK += [(1, 1536, 151936, 1), (1, 1536, 151936, 50)]  # Qwen2-1.5B lm_head
+    for m, hs, voc, top_k in testTopK:
+        for weight_format in ("plain", "packed", "int8", "q4"):
+            for dtype_name in ("f32", "bf16"):
+                test_op_linear_topk(m, hs, voc, top_k, weight_format, dtype_name, args.device, args.profile)
 
     print("\033[92mTest passed!\033[0m\n")
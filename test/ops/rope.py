@@ -59,6 +59,20 @@ def test_op_rope(
         )
 
 
+def test_op_rope_shift(shape, start_end, delta, dtype_name="f32", atol=1e-5, rtol=1e-5, device_name="cpu"):
+    print(f"   shape {shape} range {start_end} shift {delta} dtype <{dtype_name}>")
+    x, x_ = random_tensor(shape, dtype_name, device_name)
+    pos_ids, pos_ids_ = arrange_tensor(start_end[0], start_end[1], device_name)
+    theta = 10000.0
+    y, y_ = random_tensor(shape, dtype_name, device_name)
+    torch_rope(y, x, pos_ids + delta, theta)
+    # rotate at pos_ids, then re-base in place to pos_ids + delta
+    llaisys.Ops.rope(y_, x_, pos_ids_, theta)
+    llaisys.Ops.rope_shift(y_, y_, delta, theta)
+
+    assert check_equal(y_, y, atol=atol, rtol=rtol)
+
+
 if __name__ == "__main__":
     import argparse
 
@@ -79,5 +93,8 @@ if __name__ == "__main__":
     for shape, start_end in testShapes:
         for dtype_name, atol, rtol in testDtypePrec:
             test_op_rope(shape, start_end, dtype_name, atol, rtol, args.device, args.profile)
+    for shape, start_end in testShapes:
+        for dtype_name, atol, rtol in testDtypePrec:
+            test_op_rope_shift(shape, start_end, -start_end[0] // 2 - 1, dtype_name, atol, rtol, args.device)
 
     print("\033[92mTest passed!\033[0m\n")
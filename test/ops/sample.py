@@ -0,0 +1,108 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from test_utils import random_tensor, zero_tensor, benchmark
+
+
+def torch_sample_probs(logits, top_k, top_p, temperature):
+    # HF's order: temperature, then top-k, then top-p over what top-k kept;
+    # equal logits rank by index, as in the kernel
+    logits = logits.float() / temperature
+    _, order = torch.sort(logits, descending=True, stable=True, dim=-1)
+    if 0 < top_k < logits.shape[-1]:
+        order = order[..., :top_k]
+    sorted_probs = torch.softmax(logits.gather(-1, order), dim=-1)
+    if top_p < 1.0:
+        before = sorted_probs.cumsum(-1) - sorted_probs
+        sorted_probs = sorted_probs.masked_fill(before >= top_p, 0.0)
+        sorted_probs /= sorted_probs.sum(-1, keepdim=True)
+    return torch.zeros_like(logits).scatter(-1, order, sorted_probs)
+
+
+def rng_tensor(seeds):
+    # generator states are read on the host
+    states = torch.tensor(seeds, dtype=torch.int64)
+    _, states_ = zero_tensor((len(seeds),), "i64", "cpu")
+    api = llaisys.RuntimeAPI(llaisys.DeviceType.CPU)
+    api.memcpy_sync(states_.data_ptr(), states.data_ptr(), states.numel() * states.element_size(), llaisys.MemcpyKind.D2D)
+    return states_
+
+
+def test_op_sample(
+    voc,
+    top_k,
+    top_p,
+    temperature,
+    dtype_name="f32",
+    draws=20000,
+    device_name="cpu",
+    profile=False,
+):
+    print(f"   voc={voc} top_k={top_k} top_p={top_p} temperature={temperature} dtype <{dtype_name}>")
+    # one row of logits repeated: every row is an independent draw from it
+    row, _ = random_tensor((1, voc), dtype_name, device_name, scale=8.0, bias=-4.0)
+    logits, logits_ = zero_tensor((draws, voc), dtype_name, device_name)
+    logits.copy_(row.expand(draws, voc))
+    api = llaisys.RuntimeAPI(llaisys.DeviceType.CPU)
+    api.memcpy_sync(logits_.data_ptr(), logits.data_ptr(), logits.numel() * logits.element_size(), llaisys.MemcpyKind.D2D)
+    idx, idx_ = zero_tensor((draws,), "i64", device_name)
+    rng_ = rng_tensor(list(range(draws)))
+
+    llaisys.Ops.sample(idx_, logits_, rng_, top_k, top_p, temperature)
+    api.memcpy_sync(idx.data_ptr(), idx_.data_ptr(), idx.numel() * idx.element_size(), llaisys.MemcpyKind.D2D)
+
+    if top_k == 1 or temperature <= 0:
+        assert torch.all(idx == torch.argmax(row.float(), dim=-1))
+    else:
+        probs = torch_sample_probs(row[0], top_k, top_p, temperature).double()
+        freq = torch.bincount(idx, minlength=voc).double() / draws
+        assert freq[probs == 0].sum() == 0, "sampled outside the top-k / top-p support"
+        # within 5 standard deviations (and a couple of draws) of the exact distribution
+        std = (probs * (1 - probs) / draws).sqrt()
+        assert torch.all((freq - probs).abs() <= 5 * std + 2 / draws)
+
+    # a row's draw depends only on its own generator state
+    one_ = rng_tensor([7])
+    idx1, idx1_ = zero_tensor((1,), "i64", device_name)
+    llaisys.Ops.sample(idx1_, logits_.slice(0, 7, 8), one_, top_k, top_p, temperature)
+    api.memcpy_sync(idx1.data_ptr(), idx1_.data_ptr(), idx1.element_size(), llaisys.MemcpyKind.D2D)
+    assert idx1.item() == idx[7].item()
+
+    if profile:
+        row_ = logits_.slice(0, 0, 1)
+        benchmark(
+            lambda: torch.multinomial(torch_sample_probs(row, top_k, top_p, temperature), 1),
+            lambda: llaisys.Ops.sample(idx1_, row_, one_, top_k, top_p, temperature),
+            device_name,
+        )
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    # (voc, top_k, top_p, temperature)
+    testCases = [
+        (1000, 1, 1.0, 1.0),
+        (1000, 5, 1.0, 0.0),
+        (1000, 0, 1.0, 1.0),
+        (1000, 50, 1.0, 0.7),
+        (1000, 0, 0.9, 1.0),
+        (1000, 40, 0.8, 0.7),
+        (151936, 50, 0.8, 0.8),
+    ]
+    testDtype = ["f32", "f16", "bf16"]
+    print(f"Testing Ops.sample on {args.device}")
+    for voc, top_k, top_p, temperature in testCases:
+        for dtype_name in testDtype:
+            draws = 20000 if voc <= 1000 else 64
+            test_op_sample(voc, top_k, top_p, temperature, dtype_name, draws, args.device, args.profile)
+
+    print("\033[92mTest passed!\033[0m\n")
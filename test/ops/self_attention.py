@@ -39,13 +39,23 @@ def test_op_self_attention(
     rtol=1e-5,
     device_name="cpu",
     profile=False,
+    fused_qkv=False,
 ):
     print(
         f"   qlen={qlen} kvlen={kvlen} nh={nh} nkvh={nkvh} hd={hd} dtype <{dtype_name}>"
+        + (", q/k/v as views of one fused buffer" if fused_qkv else "")
     )
-    q, q_ = random_tensor((qlen, nh, hd), dtype_name, device_name)
-    k, k_ = random_tensor((kvlen, nkvh, hd), dtype_name, device_name)
-    v, v_ = random_tensor((kvlen, nkvh, hd), dtype_name, device_name)
+    if fused_qkv:
+        # heads of a fused QKV projection output, sliced without copies
+        assert qlen == kvlen
+        qkv, qkv_ = random_tensor((qlen, nh + 2 * nkvh, hd), dtype_name, device_name)
+        q, q_ = qkv[:, :nh], qkv_.slice(1, 0, nh)
+        k, k_ = qkv[:, nh : nh + nkvh], qkv_.slice(1, nh, nh + nkvh)
+        v, v_ = qkv[:, nh + nkvh :], qkv_.slice(1, nh + nkvh, nh + 2 * nkvh)
+    else:
+        q, q_ = random_tensor((qlen, nh, hd), dtype_name, device_name)
+        k, k_ = random_tensor((kvlen, nkvh, hd), dtype_name, device_name)
+        v, v_ = random_tensor((kvlen, nkvh, hd), dtype_name, device_name)
     scale = 1.0 / (hd**0.5)
 
     attn_val, attn_val_ = random_tensor((qlen, nh, hd), dtype_name, device_name)
@@ -72,6 +82,16 @@ if __name__ == "__main__":
         # qlen, kvlen, nh, nkvh, hd
         (2, 2, 1, 1, 4),
         (5, 11, 4, 2, 8),
+        # several KV blocks, so the online softmax rescales
+        (1, 300, 4, 2, 64),
+        (70, 70, 4, 2, 32),
+        # tiled prefill after a cache; the diagonal is not tile-aligned
+        (100, 230, 4, 2, 64),
+        # eight query heads per kv head, decode-sized and tiled
+        (3, 150, 8, 1, 32),
+        (40, 90, 8, 1, 32),
+        # long enough for split-KV decode on multi-core machines
+        (2, 1200, 4, 1, 64),
     ]
     testDtypePrec = [
         # type, atol, rtol
@@ -85,5 +105,9 @@ if __name__ == "__main__":
             test_op_self_attention(
                 *shape, dtype_name, atol, rtol, args.device, args.profile
             )
+    for dtype_name, atol, rtol in testDtypePrec:
+        test_op_self_attention(
+            7, 7, 4, 2, 8, dtype_name, atol, rtol, args.device, args.profile, fused_qkv=True
+        )
 
     print("\033[92mTest passed!\033[0m\n")
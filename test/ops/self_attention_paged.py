@@ -0,0 +1,295 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from test_utils import arrange_tensor, random_tensor, zero_tensor, check_equal, benchmark, llaisys_dtype, llaisys_device
+from self_attention import torch_self_attention
+from rope import torch_rope
+
+
+def block_table_tensor(table: torch.Tensor):
+    # block tables are read on the host
+    _, table_ = zero_tensor(tuple(table.shape), "i32", "cpu")
+    api = llaisys.RuntimeAPI(llaisys.DeviceType.CPU)
+    api.memcpy_sync(
+        table_.data_ptr(), table.data_ptr(), table.numel() * table.element_size(), llaisys.MemcpyKind.D2D
+    )
+    return table_
+
+
+def test_op_self_attention_paged(
+    qlen,
+    kvlen,
+    nh,
+    nkvh,
+    hd,
+    block_size,
+    dtype_name="f32",
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+    profile=False,
+):
+    print(
+        f"   qlen={qlen} kvlen={kvlen} nh={nh} nkvh={nkvh} hd={hd} block_size={block_size} dtype <{dtype_name}>"
+    )
+    nblock = (kvlen + block_size - 1) // block_size
+    num_blocks = 2 * nblock + 1
+    k_cache, k_cache_ = random_tensor((num_blocks, block_size, nkvh, hd), dtype_name, device_name)
+    v_cache, v_cache_ = random_tensor((num_blocks, block_size, nkvh, hd), dtype_name, device_name)
+    # scattered, out-of-order blocks
+    table = torch.randperm(num_blocks)[:nblock].to(torch.int32)
+    table_ = block_table_tensor(table)
+    k = k_cache[table.long()].reshape(-1, nkvh, hd)[:kvlen]
+    v = v_cache[table.long()].reshape(-1, nkvh, hd)[:kvlen]
+
+    q, q_ = random_tensor((qlen, nh, hd), dtype_name, device_name)
+    scale = 1.0 / (hd**0.5)
+    attn_val, attn_val_ = random_tensor((qlen, nh, hd), dtype_name, device_name)
+    torch_self_attention(attn_val, q, k, v, scale)
+    llaisys.Ops.self_attention_paged(attn_val_, q_, k_cache_, v_cache_, table_, kvlen, scale)
+    assert check_equal(attn_val_, attn_val, atol=atol, rtol=rtol)
+
+    if profile:
+        benchmark(
+            lambda: torch_self_attention(attn_val, q, k, v, scale),
+            lambda: llaisys.Ops.self_attention_paged(attn_val_, q_, k_cache_, v_cache_, table_, kvlen, scale),
+            device_name,
+        )
+
+
+def test_kv_cache(nlayer, nh, nkvh, hd, block_size, steps, dtype_name, atol, rtol, device_name, kv_dtype_name=None):
+    kv_dtype_name = kv_dtype_name or dtype_name
+    print(
+        f"   KVCache nlayer={nlayer} block_size={block_size} steps={steps} dtype <{dtype_name}> kv_dtype <{kv_dtype_name}>"
+    )
+    num_blocks = 2 * ((sum(steps) + block_size - 1) // block_size) + 2
+    cache = llaisys.KVCache(
+        llaisys_dtype(dtype_name), nlayer, nkvh, hd, block_size, num_blocks, kv_dtype=llaisys_dtype(kv_dtype_name)
+    )
+    seqs = [cache.add_sequence(), cache.add_sequence()]
+    history = {(s, l): ([], []) for s in seqs for l in range(nlayer)}
+    scale = 1.0 / (hd**0.5)
+    for n in steps:
+        for seq in seqs:
+            pos = cache.extend(seq, n)
+            for layer in range(nlayer):
+                k, k_ = random_tensor((n, nkvh, hd), dtype_name, device_name)
+                v, v_ = random_tensor((n, nkvh, hd), dtype_name, device_name)
+                q, q_ = random_tensor((n, nh, hd), dtype_name, device_name)
+                cache.store(seq, layer, pos, k_, v_)
+                history[(seq, layer)][0].append(k)
+                history[(seq, layer)][1].append(v)
+
+                attn_val, attn_val_ = random_tensor((n, nh, hd), dtype_name, device_name)
+                torch_self_attention(
+                    attn_val, q, torch.cat(history[(seq, layer)][0]), torch.cat(history[(seq, layer)][1]), scale
+                )
+                cache.attention(seq, layer, attn_val_, q_, scale)
+                assert check_equal(attn_val_, attn_val, atol=atol, rtol=rtol)
+            assert cache.length(seq) == pos + n
+    used = num_blocks - cache.num_free_blocks()
+    cache.remove_sequence(seqs[0])
+    assert num_blocks - cache.num_free_blocks() == used // 2
+
+
+def test_kv_cache_rollback(nh, nkvh, hd, block_size, steps, dtype_name, atol, rtol, device_name):
+    # steps: (tokens appended, tokens then rolled back), as in speculative decoding
+    print(f"   KVCache rollback block_size={block_size} steps={steps} dtype <{dtype_name}>")
+    num_blocks = (sum(n for n, _ in steps) + block_size - 1) // block_size + 1
+    cache = llaisys.KVCache(llaisys_dtype(dtype_name), 1, nkvh, hd, block_size, num_blocks)
+    seq = cache.add_sequence()
+    keys, values = [], []
+    scale = 1.0 / (hd**0.5)
+    for n, rejected in steps:
+        pos = cache.extend(seq, n)
+        k, k_ = random_tensor((n, nkvh, hd), dtype_name, device_name)
+        v, v_ = random_tensor((n, nkvh, hd), dtype_name, device_name)
+        cache.store(seq, 0, pos, k_, v_)
+        cache.truncate(seq, pos + n - rejected)
+        keys.append(k[: n - rejected])
+        values.append(v[: n - rejected])
+        length = pos + n - rejected
+        assert cache.length(seq) == length
+        assert cache.num_free_blocks() == num_blocks - (length + block_size - 1) // block_size
+
+        q, q_ = random_tensor((1, nh, hd), dtype_name, device_name)
+        attn_val, attn_val_ = random_tensor((1, nh, hd), dtype_name, device_name)
+        torch_self_attention(attn_val, q, torch.cat(keys), torch.cat(values), scale)
+        cache.attention(seq, 0, attn_val_, q_, scale)
+        assert check_equal(attn_val_, attn_val, atol=atol, rtol=rtol)
+
+
+def test_kv_cache_streaming(nh, nkvh, hd, block_size, sink, window, steps, dtype_name, atol, rtol, device_name):
+    print(f"   KVCache streaming sink={sink} window={window} steps={len(steps)} dtype <{dtype_name}>")
+    theta = 10000.0
+    scale = 1.0 / (hd**0.5)
+    # the pool only ever holds the sinks, the window and the block being filled
+    num_blocks = (sink + window) // block_size + 1
+    cache = llaisys.KVCache(llaisys_dtype(dtype_name), 1, nkvh, hd, block_size, num_blocks)
+    seq = cache.add_streaming_sequence(sink, window, theta)
+    keys, values = [], []
+    for n in steps:
+        pos = cache.extend(seq, n)
+        length = cache.length(seq)
+        assert pos + n == length <= sink + window
+        k, k_ = random_tensor((n, nkvh, hd), dtype_name, device_name)
+        v, v_ = random_tensor((n, nkvh, hd), dtype_name, device_name)
+        q, q_ = random_tensor((n, nh, hd), dtype_name, device_name)
+        keys.append(k)
+        values.append(v)
+        pos_ids, pos_ids_ = arrange_tensor(pos, pos + n, device_name)
+        k_rot, k_rot_ = random_tensor((n, nkvh, hd), dtype_name, device_name)
+        llaisys.Ops.rope(k_rot_, k_, pos_ids_, theta)
+        cache.store(seq, 0, pos, k_rot_, v_)
+        attn_val, attn_val_ = random_tensor((n, nh, hd), dtype_name, device_name)
+        cache.attention(seq, 0, attn_val_, q_, scale)
+
+        # the sinks and the last length - sink tokens, rotated at their positions in the cache
+        all_k, all_v = torch.cat(keys), torch.cat(values)
+        kept = torch.cat([torch.arange(min(sink, length)), torch.arange(len(all_k) - length + sink, len(all_k))])
+        assert cache.evicted(seq) + length == len(all_k)
+        k_ref = torch.empty((length, nkvh, hd), dtype=all_k.dtype, device=all_k.device)
+        torch_rope(k_ref, all_k[kept], torch.arange(length, device=all_k.device), theta)
+        torch_self_attention(attn_val, q, k_ref, all_v[kept], scale)
+        assert check_equal(attn_val_, attn_val, atol=atol, rtol=rtol)
+
+
+def test_prefix_cache(nh, nkvh, hd, block_size, dtype_name, atol, rtol, device_name):
+    print(f"   KVCache prefix cache block_size={block_size} dtype <{dtype_name}>")
+    scale = 1.0 / (hd**0.5)
+    cache = llaisys.KVCache(llaisys_dtype(dtype_name), 1, nkvh, hd, block_size, 16)
+    # K/V of a token are random but fixed per (prefix, token), as a model's would be
+    kv = {}
+
+    def token_kv(tokens, i):
+        key = tuple(tokens[: i + 1])
+        if key not in kv:
+            kv[key] = (random_tensor((1, nkvh, hd), dtype_name, device_name), random_tensor((1, nkvh, hd), dtype_name, device_name))
+        return kv[key]
+
+    def request(tokens, expect_cached):
+        seq, cached = cache.add_sequence_with_prefix(tokens)
+        assert cached == expect_cached, (cached, expect_cached)
+        pos = cache.extend(seq, len(tokens) - cached)
+        for i in range(pos, len(tokens)):
+            (_, k_), (_, v_) = token_kv(tokens, i)
+            cache.store(seq, 0, i, k_, v_)
+        n = len(tokens) - cached
+        q, q_ = random_tensor((n, nh, hd), dtype_name, device_name)
+        attn_val, attn_val_ = random_tensor((n, nh, hd), dtype_name, device_name)
+        cache.attention(seq, 0, attn_val_, q_, scale)
+        k = torch.cat([token_kv(tokens, i)[0][0] for i in range(len(tokens))])
+        v = torch.cat([token_kv(tokens, i)[1][0] for i in range(len(tokens))])
+        torch_self_attention(attn_val, q, k, v, scale)
+        assert check_equal(attn_val_, attn_val, atol=atol, rtol=rtol)
+        cache.commit_prefix(seq, tokens)
+        return seq
+
+    system = list(range(1, 2 * block_size + 3))
+    cache.remove_sequence(request(system + [50, 51], 0))
+    # the two full system blocks are reused, the rest is prefilled
+    seq = request(system + [60, 61, 62], 2 * block_size)
+    # a prompt diverging inside the second block splits the tree there
+    cache.remove_sequence(request(system[: block_size + 1] + [70] * block_size, block_size))
+    # a prompt that is entirely cached still prefills its last token
+    request(system[: 2 * block_size], block_size)
+    cache.remove_sequence(seq)
+    # 13 blocks with 12 free: a least recently used prefix block is evicted instead of failing
+    request(list(range(100, 100 + 13 * block_size)), 0)
+    assert cache.prefix_blocks() == 15 and cache.num_free_blocks() == 0
+
+
+def test_kv_cache_quant(qlen, kvlen, nh, nkvh, hd, block_size, kv_dtype_name, device_name, profile=False):
+    """Error of an I8/F8 cache against the bf16 cache holding the same K/V, and both timed."""
+    print(f"   KVCache quality qlen={qlen} kvlen={kvlen} kv_dtype <{kv_dtype_name}> vs <bf16>")
+    num_blocks = (kvlen + block_size - 1) // block_size
+    k, k_ = random_tensor((kvlen, nkvh, hd), "bf16", device_name)
+    v, v_ = random_tensor((kvlen, nkvh, hd), "bf16", device_name)
+    q, q_ = random_tensor((qlen, nh, hd), "bf16", device_name)
+    scale = 1.0 / (hd**0.5)
+    caches = []
+    for kv_dtype in ("bf16", kv_dtype_name):
+        cache = llaisys.KVCache(
+            llaisys.DataType.BF16, 1, nkvh, hd, block_size, num_blocks, kv_dtype=llaisys_dtype(kv_dtype)
+        )
+        seq = cache.add_sequence()
+        cache.store(seq, 0, cache.extend(seq, kvlen), k_, v_)
+        attn_val, attn_val_ = random_tensor((qlen, nh, hd), "bf16", device_name)
+        cache.attention(seq, 0, attn_val_, q_, scale)
+        caches.append((cache, seq, attn_val_))
+
+    # reference in f32 over the same bf16 inputs
+    ref = torch.empty((qlen, nh, hd), dtype=torch.float32, device=q.device)
+    torch_self_attention(ref, q.float(), k.float(), v.float(), scale)
+    api = llaisys.RuntimeAPI(llaisys_device(device_name))
+    errs = []
+    for name, (_, _, attn_val_) in zip(("bf16", kv_dtype_name), caches):
+        got = torch.empty((qlen, nh, hd), dtype=torch.bfloat16, device=q.device)
+        api.memcpy_sync(got.data_ptr(), attn_val_.data_ptr(), got.numel() * got.element_size(), llaisys.MemcpyKind.D2D)
+        err = (got.float() - ref).abs()
+        errs.append(err.max().item())
+        print(f"      <{name}> cache: max err {errs[-1]:.4f}, mean err {err.mean().item():.5f}")
+    assert errs[1] < (0.05 if kv_dtype_name == "i8" else 0.1)
+
+    if profile:
+        (bf16_cache, bf16_seq, out_bf16), (q_cache, q_seq, out_q) = caches
+        print(f"      Torch: <bf16> cache, LLAISYS: <{kv_dtype_name}> cache")
+        benchmark(
+            lambda: bf16_cache.attention(bf16_seq, 0, out_bf16, q_, scale),
+            lambda: q_cache.attention(q_seq, 0, out_q, q_, scale),
+            device_name,
+        )
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testShapes = [
+        # qlen, kvlen, nh, nkvh, hd, block_size
+        (1, 37, 4, 2, 16, 16),
+        (5, 200, 4, 2, 32, 16),
+        # prefill tiles cut by blocks that are not multiples of 64
+        (70, 230, 4, 2, 32, 48),
+        (100, 300, 4, 1, 64, 64),
+    ]
+    testDtypePrec = [
+        # type, atol, rtol
+        ("f32", 1e-5, 1e-5),
+        ("f16", 1e-3, 1e-3),
+        ("bf16", 1e-2, 1e-2),
+    ]
+    print(f"Testing Ops.self_attention_paged on {args.device}")
+    for shape in testShapes:
+        for dtype_name, atol, rtol in testDtypePrec:
+            test_op_self_attention_paged(
+                *shape, dtype_name, atol, rtol, args.device, args.profile
+            )
+    for dtype_name, atol, rtol in testDtypePrec:
+        test_kv_cache(2, 4, 2, 32, 16, [20, 1, 1, 33, 1], dtype_name, atol, rtol, args.device)
+    for dtype_name, atol, rtol in testDtypePrec:
+        # rollbacks within a block, across a block boundary and of a whole chunk
+        test_kv_cache_rollback(4, 2, 32, 16, [(20, 0), (5, 3), (9, 1), (6, 6), (17, 12)], dtype_name, atol, rtol, args.device)
+    # window keys are re-rotated (and rounded) up to window / block_size times
+    for dtype_name, atol, rtol in [("f32", 1e-4, 1e-4), ("f16", 2e-3, 2e-3), ("bf16", 2e-2, 2e-2)]:
+        # a 20-token prompt then decode well past sink + window, with a chunk landing mid-block
+        test_kv_cache_streaming(4, 2, 32, 16, 16, 48, [20] + [1] * 40 + [17] + [1] * 30, dtype_name, atol, rtol, args.device)
+    for dtype_name, atol, rtol in testDtypePrec:
+        test_prefix_cache(4, 2, 32, 16, dtype_name, atol, rtol, args.device)
+    # quantized caches: K/V rows carry their own scale, so only a loose bound applies
+    for dtype_name in ["f32", "bf16"]:
+        for kv_dtype_name, tol in [("i8", 5e-2), ("f8", 1e-1)]:
+            test_kv_cache(2, 4, 2, 32, 16, [20, 1, 1, 33, 1], dtype_name, tol, tol, args.device, kv_dtype_name)
+    for kv_dtype_name in ["i8", "f8"]:
+        # prefill and long-context decode; the benchmark compares against the bf16 cache
+        test_kv_cache_quant(128, 2048, 12, 2, 128, 64, kv_dtype_name, args.device, args.profile)
+        test_kv_cache_quant(1, 8192, 12, 2, 128, 64, kv_dtype_name, args.device, args.profile)
+
+    print("\033[92mTest passed!\033[0m\n")
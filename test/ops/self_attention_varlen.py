@@ -0,0 +1,150 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from test_utils import random_tensor, zero_tensor, check_equal, benchmark
+from self_attention import torch_self_attention
+from self_attention_paged import block_table_tensor
+
+
+def cu_seqlens_tensor(lens):
+    # offsets are read on the host
+    cu = torch.tensor([0] + lens, dtype=torch.int32).cumsum(0, dtype=torch.int32)
+    _, cu_ = zero_tensor((len(lens) + 1,), "i32", "cpu")
+    api = llaisys.RuntimeAPI(llaisys.DeviceType.CPU)
+    api.memcpy_sync(cu_.data_ptr(), cu.data_ptr(), cu.numel() * cu.element_size(), llaisys.MemcpyKind.D2D)
+    return cu, cu_
+
+
+def test_op_self_attention_varlen(
+    seqs,
+    nh,
+    nkvh,
+    hd,
+    dtype_name="f32",
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+    profile=False,
+):
+    print(f"   seqs(qlen, kvlen)={seqs} nh={nh} nkvh={nkvh} hd={hd} dtype <{dtype_name}>")
+    qlens = [s[0] for s in seqs]
+    kvlens = [s[1] for s in seqs]
+    cu_q, cu_q_ = cu_seqlens_tensor(qlens)
+    cu_k, cu_k_ = cu_seqlens_tensor(kvlens)
+    q, q_ = random_tensor((sum(qlens), nh, hd), dtype_name, device_name)
+    k, k_ = random_tensor((sum(kvlens), nkvh, hd), dtype_name, device_name)
+    v, v_ = random_tensor((sum(kvlens), nkvh, hd), dtype_name, device_name)
+    scale = 1.0 / (hd**0.5)
+    attn_val, attn_val_ = random_tensor((sum(qlens), nh, hd), dtype_name, device_name)
+
+    def torch_varlen():
+        # every sequence on its own, with its own causal mask
+        for b in range(len(seqs)):
+            qs, ks = slice(int(cu_q[b]), int(cu_q[b + 1])), slice(int(cu_k[b]), int(cu_k[b + 1]))
+            if qlens[b] > 0:
+                torch_self_attention(attn_val[qs], q[qs], k[ks], v[ks], scale)
+
+    torch_varlen()
+    llaisys.Ops.self_attention_varlen(attn_val_, q_, k_, v_, cu_q_, cu_k_, scale)
+    assert check_equal(attn_val_, attn_val, atol=atol, rtol=rtol)
+
+    if profile:
+        benchmark(
+            torch_varlen,
+            lambda: llaisys.Ops.self_attention_varlen(attn_val_, q_, k_, v_, cu_q_, cu_k_, scale),
+            device_name,
+        )
+
+
+def test_op_self_attention_paged_varlen(
+    seqs,
+    nh,
+    nkvh,
+    hd,
+    block_size,
+    dtype_name="f32",
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+    profile=False,
+):
+    print(f"   paged seqs(qlen, kvlen)={seqs} nh={nh} nkvh={nkvh} hd={hd} block_size={block_size} dtype <{dtype_name}>")
+    qlens = [s[0] for s in seqs]
+    kvlens = [s[1] for s in seqs]
+    nblocks = [(n + block_size - 1) // block_size for n in kvlens]
+    num_blocks = sum(nblocks) + 3
+    k_cache, k_cache_ = random_tensor((num_blocks, block_size, nkvh, hd), dtype_name, device_name)
+    v_cache, v_cache_ = random_tensor((num_blocks, block_size, nkvh, hd), dtype_name, device_name)
+    # every sequence gets its own scattered blocks; rows are padded with -1
+    perm = torch.randperm(num_blocks).to(torch.int32)
+    tables = torch.full((len(seqs), max(nblocks)), -1, dtype=torch.int32)
+    used = 0
+    for b, n in enumerate(nblocks):
+        tables[b, :n] = perm[used : used + n]
+        used += n
+    tables_ = block_table_tensor(tables)
+    lens_ = block_table_tensor(torch.tensor(kvlens, dtype=torch.int32))
+    cu_q, cu_q_ = cu_seqlens_tensor(qlens)
+
+    q, q_ = random_tensor((sum(qlens), nh, hd), dtype_name, device_name)
+    scale = 1.0 / (hd**0.5)
+    attn_val, attn_val_ = random_tensor((sum(qlens), nh, hd), dtype_name, device_name)
+
+    def torch_paged_varlen():
+        for b in range(len(seqs)):
+            qs = slice(int(cu_q[b]), int(cu_q[b + 1]))
+            table = tables[b, : nblocks[b]].long()
+            k = k_cache[table].reshape(-1, nkvh, hd)[: kvlens[b]]
+            v = v_cache[table].reshape(-1, nkvh, hd)[: kvlens[b]]
+            if qlens[b] > 0:
+                torch_self_attention(attn_val[qs], q[qs], k, v, scale)
+
+    def llaisys_paged_varlen():
+        llaisys.Ops.self_attention_paged_varlen(attn_val_, q_, k_cache_, v_cache_, cu_q_, lens_, tables_, scale)
+
+    torch_paged_varlen()
+    llaisys_paged_varlen()
+    assert check_equal(attn_val_, attn_val, atol=atol, rtol=rtol)
+
+    if profile:
+        benchmark(torch_paged_varlen, llaisys_paged_varlen, device_name)
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testShapes = [
+        # [(qlen, kvlen), ...], nh, nkvh, hd
+        ([(2, 5)], 4, 2, 8),
+        # decode rows, a short prefill, a prefill over history and an idle sequence in one batch
+        ([(1, 37), (7, 7), (1, 1), (70, 200), (0, 10)], 4, 2, 32),
+        # a prefill next to an empty sequence: no decode rows at all
+        ([(8, 8), (0, 4)], 4, 2, 16),
+        # decode batch with long, uneven contexts (split-KV per sequence)
+        ([(1, 1200), (1, 40), (1, 700), (2, 900)], 8, 2, 64),
+    ]
+    testDtypePrec = [
+        # type, atol, rtol
+        ("f32", 1e-5, 1e-5),
+        ("f16", 1e-3, 1e-3),
+        ("bf16", 1e-2, 1e-2),
+    ]
+    print(f"Testing Ops.self_attention_varlen on {args.device}")
+    for shape in testShapes:
+        for dtype_name, atol, rtol in testDtypePrec:
+            test_op_self_attention_varlen(*shape, dtype_name, atol, rtol, args.device, args.profile)
+    for dtype_name, atol, rtol in testDtypePrec:
+        # a continuous-batching step: decode rows next to a chunked prefill, over scattered blocks
+        test_op_self_attention_paged_varlen(
+            [(1, 37), (1, 1), (20, 60), (1, 300)], 4, 2, 32, 16, dtype_name, atol, rtol, args.device, args.profile
+        )
+
+    print("\033[92mTest passed!\033[0m\n")
@@ -54,8 +54,15 @@ def hf_infer(
     return outputs[0].tolist(), result
 
 
-def load_llaisys_model(model_path, device_name):
-    model = llaisys.models.Qwen2(model_path, llaisys_device(device_name))
+def load_llaisys_model(model_path, device_name, weight_format="dense", kv_dtype="model", sink=0, window=0):
+    model = llaisys.models.Qwen2(
+        model_path,
+        llaisys_device(device_name),
+        weight_format=llaisys.models.Qwen2WeightFormat[weight_format.upper()],
+        kv_dtype=None if kv_dtype == "model" else llaisys.DataType[kv_dtype.upper()],
+        sink=sink,
+        window=window,
+    )
     return model
 
 
@@ -89,6 +96,11 @@ if __name__ == "__main__":
     parser.add_argument("--top_k", default=50, type=int)
     parser.add_argument("--temperature", default=1.0, type=float)
     parser.add_argument("--test", action="store_true")
+    parser.add_argument("--weight_format", default="dense", choices=["dense", "int8", "q4"], type=str)
+    parser.add_argument("--kv_dtype", default="model", choices=["model", "i8", "f8"], type=str)
+    parser.add_argument("--sink", default=0, type=int, help="streaming KV cache: tokens kept at the front")
+    parser.add_argument("--window", default=0, type=int, help="streaming KV cache: most recent tokens kept (0: off)")
+    parser.add_argument("--speculative", default=0, type=int, help="also decode verifying this many n-gram proposals per step")
 
     args = parser.parse_args()
 
@@ -122,7 +134,7 @@ if __name__ == "__main__":
     print("\n")
     print(f"Time elapsed: {(end_time - start_time):.2f}s\n")
 
-    model = load_llaisys_model(model_path, args.device)
+    model = load_llaisys_model(model_path, args.device, args.weight_format, args.kv_dtype, args.sink, args.window)
     start_time = time.time()
     llaisys_tokens, llaisys_output = llaisys_infer(
         args.prompt,
@@ -147,3 +159,27 @@ if __name__ == "__main__":
     if args.test:
         assert llaisys_tokens == tokens
         print("\033[92mTest passed!\033[0m\n")
+
+    if args.speculative > 0:
+        inputs = tokenizer.encode(
+            tokenizer.apply_chat_template(
+                conversation=[{"role": "user", "content": args.prompt}],
+                add_generation_prompt=True,
+                tokenize=False,
+            )
+        )
+        # a fresh model, so neither run starts on the other's cached K/V
+        del model
+        gc.collect()
+        model = load_llaisys_model(model_path, args.device, args.weight_format, args.kv_dtype, args.sink, args.window)
+        spec_start = time.time()
+        spec_tokens, stats = model.generate_speculative(
+            inputs, max_new_tokens=args.max_steps, num_speculative=args.speculative
+        )
+        spec_time = time.time() - spec_start
+
+        print("\n=== Speculative (prompt lookup) ===\n")
+        print(f"Acceptance rate: {stats['acceptance_rate']:.2f}, tokens per forward: {stats['tokens_per_step']:.2f}")
+        print(f"Time elapsed: {spec_time:.2f}s, speedup {(end_time - start_time) / spec_time:.2f}x\n")
+        if args.test:
+            assert spec_tokens == llaisys_tokens
@@ -25,6 +25,10 @@ target("llaisys-utils")
     set_warnings("all", "error")
     if not is_plat("windows") then
         add_cxflags("-fPIC", "-Wno-unknown-pragmas")
+        -- bulk dtype conversions are vectorized for the host ISA (AVX2/AVX-512/F16C)
+        add_cxflags("-march=native")
+    else
+        add_cxflags("/arch:AVX2")
     end
 
     add_files("src/utils/*.cpp")
@@ -95,6 +99,36 @@ target("llaisys-ops")
     on_install(function (target) end)
 target_end()
 
+target("llaisys-kv-cache")
+    set_kind("static")
+    add_deps("llaisys-ops")
+
+    set_languages("cxx17")
+    set_warnings("all", "error")
+    if not is_plat("windows") then
+        add_cxflags("-fPIC", "-Wno-unknown-pragmas")
+    end
+
+    add_files("src/kv_cache/*.cpp")
+
+    on_install(function (target) end)
+target_end()
+
+target("llaisys-models")
+    set_kind("static")
+    add_deps("llaisys-kv-cache")
+
+    set_languages("cxx17")
+    set_warnings("all", "error")
+    if not is_plat("windows") then
+        add_cxflags("-fPIC", "-Wno-unknown-pragmas")
+    end
+
+    add_files("src/models/*/*.cpp")
+
+    on_install(function (target) end)
+target_end()
+
 target("llaisys")
     set_kind("shared")
     add_deps("llaisys-utils")
@@ -102,11 +136,17 @@ target("llaisys")
     add_deps("llaisys-core")
     add_deps("llaisys-tensor")
     add_deps("llaisys-ops")
+    add_deps("llaisys-kv-cache")
+    add_deps("llaisys-models")
 
     set_languages("cxx17")
     set_warnings("all", "error")
-    add_files("src/llaisys/*.cc")
+    add_files("src/llaisys/*.cc", "src/llaisys/models/*.cc")
     set_installdir(".")
+    if is_plat("linux") then
+        -- cpu thread pool
+        add_syslinks("pthread")
+    end
 
     
     after_install(function (target)
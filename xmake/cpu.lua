@@ -18,6 +18,10 @@ target("llaisys-ops-cpu")
     set_warnings("all", "error")
     if not is_plat("windows") then
         add_cxflags("-fPIC", "-Wno-unknown-pragmas")
+        -- SIMD kernels are selected at compile time from the host ISA (AVX2/AVX-512/F16C)
+        add_cxflags("-march=native")
+    else
+        add_cxflags("/arch:AVX2")
     end
 
     add_files("../src/ops/*/cpu/*.cpp")